@@ -0,0 +1,50 @@
+#ifndef LDCP_SDK_ANGULAR_ROI_H_
+#define LDCP_SDK_ANGULAR_ROI_H_
+
+#include "ldcp/data_types.h"
+
+#include <utility>
+
+namespace ldcp_sdk
+{
+
+// Angular windows a frame is decoded within. Windows are given in radians in
+// the ScanGeometry convention and run counter-clockwise from start to end,
+// so a window may wrap past +-pi, and one spanning 2*pi or more covers the
+// whole revolution. They are mapped to merged beam index intervals for the
+// current frame layout; beams outside every window are reported as 0. An
+// ROI without windows passes the whole frame.
+class AngularRoi
+{
+public:
+  typedef std::pair<int, int> BeamInterval;
+
+public:
+  AngularRoi();
+
+  void addWindow(double start_angle, double end_angle);
+  void clear();
+  bool isEmpty() const;
+
+  void update(angular_fov_t angular_fov, scan_resolution_t resolution);
+  void update(angular_fov_t angular_fov, int beam_count);
+
+  const std::vector<BeamInterval>& beamIntervals() const;
+  bool overlaps(int begin, int end) const;
+
+  void decodeBlock(const OobPacketHeader* oob_packet_header, int* ranges, int* intensities) const;
+  void decodeBlock(const OobPacketHeader* oob_packet_header, uint16_t* ranges, uint16_t* intensities) const;
+  void decodeBlock(const ScanBlock& scan_block, int* ranges, int* intensities) const;
+  void decodeBlock(const ScanBlock& scan_block, uint16_t* ranges, uint16_t* intensities) const;
+  void mask(ScanFrame& scan_frame);
+
+private:
+  std::vector<std::pair<double, double>> windows_;
+  angular_fov_t angular_fov_;
+  int beam_count_;
+  std::vector<BeamInterval> beam_intervals_;
+};
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef LDCP_SDK_BACKGROUND_MODEL_H_
+#define LDCP_SDK_BACKGROUND_MODEL_H_
+
+#include "ldcp/data_types.h"
+
+namespace ldcp_sdk
+{
+
+// Beams [begin, end) of a frame holding foreground, with the number of
+// foreground beams among them and their nearest and mean range.
+struct ForegroundSegment
+{
+  int begin;
+  int end;
+  int beam_count;
+  int min_range;
+  float mean_range;
+};
+
+// Per-beam range distribution of a fixed-mount sensor. The mean and
+// variance of every beam are averaged over the learning frames, then
+// follow the scene at the adaptation rate on beams classified as
+// background. A beam is foreground when its return is closer or farther
+// than the background by more than both the minimum difference and
+// sigma_factor standard deviations, so both arriving and departed objects
+// are reported, or when it returns where the background had none. Such
+// open beams are foreground for that frame and take the return as their
+// background.
+// Foreground beams separated by at most max_gap beams form one segment.
+class BackgroundModel
+{
+public:
+  BackgroundModel();
+
+  void setLearningFrames(int count);
+  void setAdaptationRates(float background_rate, float foreground_rate);
+  void setThreshold(int min_difference, float sigma_factor);
+  void setSegmentation(int min_beam_count, int max_gap);
+  void reset();
+
+  bool isLearned() const;
+  void process(const ScanFrame& scan_frame, std::vector<ForegroundSegment>& segments);
+  const std::vector<uint8_t>& foregroundMask() const;
+
+private:
+  void learn(const int* ranges);
+  void classify(const int* ranges);
+  void segment(const int* ranges, std::vector<ForegroundSegment>& segments);
+
+private:
+  int learning_frames_;
+  float background_rate_, foreground_rate_;
+  int min_difference_;
+  float sigma_factor_;
+  int min_beam_count_, max_gap_;
+
+  int beam_count_;
+  int frame_count_;
+  std::vector<float> means_;
+  std::vector<float> variances_;
+  std::vector<uint16_t> sample_counts_;
+  std::vector<uint8_t> foreground_mask_;
+};
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef LDCP_SDK_BLOCK_MONITOR_H_
+#define LDCP_SDK_BLOCK_MONITOR_H_
+
+#include "ldcp/device.h"
+#include "ldcp/protective_field.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ldcp_sdk
+{
+
+// Where a block lies in its frame. Angles are in radians in the ScanGeometry
+// convention; end_angle is the angle of the last beam of the block.
+struct BlockSpan
+{
+  int beam_offset;
+  int beam_count;
+  double start_angle;
+  double end_angle;
+};
+
+// Reads scan blocks from a device on its own thread and hands each one to
+// the registered callbacks as soon as it is decoded, without waiting for
+// the rest of the frame. If a protective field is set, it is evaluated on
+// every block and the field callback receives the zones currently violated
+// over the last revolution.
+//
+// The field callback is also called on faults: when reading a block fails
+// or times out, when a block is malformed, and while some block of the
+// revolution has not been seen recently. A fault is reported as a status
+// other than no_error with every zone violated, and the block passed along
+// is empty for read failures. The field callback runs outside the field
+// lock, so it may call setProtectiveField itself.
+//
+// The monitor consumes the same block queue as Device::readScanFrame, so
+// the two cannot be used on one device at the same time. Blocks are not
+// available while the device decodes through a DecodePipeline or receives
+// in busy-poll mode, which assembles whole frames on the polling thread.
+// Block callbacks are added before start().
+class BlockMonitor
+{
+public:
+  typedef std::function<void(const ScanBlock& scan_block, const BlockSpan& span)> BlockCallback;
+  typedef std::function<void(uint32_t violated_zones, error_t status, const ScanBlock& scan_block)> FieldCallback;
+
+public:
+  explicit BlockMonitor(Device& device);
+  ~BlockMonitor();
+
+  error_t addBlockCallback(BlockCallback callback);
+  void setProtectiveField(const ProtectiveField& field, FieldCallback callback);
+
+  void start();
+  void stop();
+
+private:
+  void monitorLoop();
+  void reportFault(error_t status, const ScanBlock& scan_block);
+
+private:
+  static const int FAULT_RETRY_INTERVAL = 100;
+
+private:
+  Device& device_;
+  std::vector<BlockCallback> block_callbacks_;
+
+  std::mutex field_mutex_;
+  ProtectiveField field_;
+  FieldCallback field_callback_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+}
+
+#endif
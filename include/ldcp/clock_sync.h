@@ -0,0 +1,81 @@
+#ifndef LDCP_SDK_CLOCK_SYNC_H_
+#define LDCP_SDK_CLOCK_SYNC_H_
+
+#include "ldcp/error.h"
+
+#include <cstdint>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace ldcp_sdk
+{
+
+// Estimates the mapping from the 32-bit device timestamp counter to host time
+// (nanoseconds of std::chrono::steady_clock) by periodically sampling the
+// device counter and fitting offset and drift over a sliding window.
+class ClockSync
+{
+public:
+  typedef std::function<error_t(uint32_t&)> SampleFunction;
+
+  static const int DEFAULT_INTERVAL = 1000;
+
+public:
+  ClockSync(SampleFunction sample_function);
+  ~ClockSync();
+
+  void start(int interval = DEFAULT_INTERVAL);
+  void stop();
+  bool isRunning() const;
+
+  error_t sample();
+  void reset();
+
+  bool isSynchronized() const;
+  int64_t toHostTime(uint32_t device_timestamp) const;
+  double tickPeriod() const;
+  int64_t roundTripTime() const;
+
+  static int64_t hostTime();
+
+private:
+  struct Sample
+  {
+    int64_t device_ticks;
+    int64_t host_time;
+    int64_t round_trip_time;
+  };
+
+  void addSample(uint32_t device_timestamp, int64_t host_time, int64_t round_trip_time);
+  void fit();
+
+private:
+  static const int WINDOW_SIZE = 32;
+  static const int WARM_UP_SAMPLES = 8;
+  static const int WARM_UP_INTERVAL = 100;
+  static const int64_t DISCONTINUITY_THRESHOLD = 50000000;
+
+private:
+  SampleFunction sample_function_;
+
+  std::thread thread_;
+  bool running_;
+  std::mutex thread_mutex_;
+  std::condition_variable thread_cv_;
+
+  mutable std::mutex estimate_mutex_;
+  std::deque<Sample> samples_;
+  uint32_t last_device_timestamp_;
+  bool synchronized_;
+  uint32_t reference_device_timestamp_;
+  double reference_host_time_;
+  double tick_period_;
+  int64_t round_trip_time_;
+};
+
+}
+
+#endif
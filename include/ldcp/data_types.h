@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <memory>
 
 namespace ldcp_sdk
@@ -21,6 +22,11 @@ enum angular_fov_t {
   ANGULAR_FOV_360DEG
 };
 
+enum oob_receive_mode_t {
+  OOB_RECEIVE_MODE_REACTOR,
+  OOB_RECEIVE_MODE_BUSY_POLL
+};
+
 enum {
   INTENSITY_WIDTH_8BIT,
   INTENSITY_WIDTH_16BIT
@@ -40,6 +46,7 @@ public:
   int block_count;
   int block_length;
   unsigned int timestamp;
+  int64_t host_timestamp;
   angular_fov_t angular_fov;
   std::vector<BlockData> layers;
 };
@@ -77,10 +84,88 @@ public:
   };
 
   unsigned int timestamp;
+  int64_t host_timestamp;
   angular_fov_t angular_fov;
+  std::vector<unsigned int> block_timestamps;
+  std::vector<int64_t> block_host_timestamps;
   std::vector<FrameData> layers;
 };
 
+// Caller-owned destination for Device::readScanFrame. ranges (and
+// intensities, if not null) must hold beam_capacity elements; the block
+// metadata arrays, if not null, must hold block_capacity elements. A null
+// intensities leaves them out of the frame, while a null ranges is rejected
+// with invalid_params before anything is read. The remaining fields describe
+// the frame that was written. With a decode
+// pipeline, frames are assembled by the pipeline and copied into the buffer
+// once.
+class ScanFrameBuffer
+{
+public:
+  ScanFrameBuffer()
+    : ranges(nullptr), intensities(nullptr), beam_capacity(0)
+    , block_timestamps(nullptr), block_host_timestamps(nullptr), block_capacity(0)
+    , timestamp(0), host_timestamp(0), angular_fov(ANGULAR_FOV_270DEG)
+    , beam_count(0), block_count(0)
+  {
+  }
+
+  uint16_t* ranges;
+  uint16_t* intensities;
+  size_t beam_capacity;
+  unsigned int* block_timestamps;
+  int64_t* block_host_timestamps;
+  size_t block_capacity;
+
+  unsigned int timestamp;
+  int64_t host_timestamp;
+  angular_fov_t angular_fov;
+  int beam_count;
+  int block_count;
+};
+
+// Out-of-band receive counters for one device. kernel_drops is read from
+// the receiving socket, which every device sending to the same local port
+// shares, so it counts datagrams lost on that port rather than for this
+// device alone. queue_drops counts packets this device lost in the SDK:
+// scan blocks evicted from the session queue plus packets evicted from its
+// decode stream's input queue. Frames the decode stream discards unread are
+// reported by DecodeStream::droppedFrames.
+class OobStatistics
+{
+public:
+  uint64_t packets_received;
+  int64_t receive_latency_mean;
+  int64_t receive_latency_max;
+  int64_t delivery_latency_mean;
+  int64_t delivery_latency_max;
+  uint64_t kernel_drops;
+  uint64_t queue_drops;
+  int receive_buffer_size;
+};
+
+struct Pose2D
+{
+  double x;
+  double y;
+  double theta;
+};
+
+struct Point2D
+{
+  double x;
+  double y;
+};
+
+class PointCloud
+{
+public:
+  int64_t host_timestamp;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<int> intensities;
+};
+
 }
 
 #endif
@@ -0,0 +1,126 @@
+#ifndef LDCP_SDK_DECODE_PIPELINE_H_
+#define LDCP_SDK_DECODE_PIPELINE_H_
+
+#include "ldcp/angular_roi.h"
+#include "ldcp/data_types.h"
+#include "ldcp/error.h"
+#include "ldcp/flight_recorder.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+class DecodePipeline;
+
+// Per-device state of a DecodePipeline. Raw OOB packets go in, verified and
+// assembled frames come out, decoded only within the stream's angular ROI.
+// At most one worker runs a stream at a time, so packets of a device are
+// processed in arrival order, and reach the stream's flight recorder in that
+// order once verified. A stream created without a pipeline decodes each
+// packet on the thread that submits it instead. Frames carry device
+// timestamps only; host timestamps are left to the reader.
+class DecodeStream : public std::enable_shared_from_this<DecodeStream>
+{
+public:
+  static const int INPUT_QUEUE_LENGTH = 64;
+  static const int OUTPUT_QUEUE_LENGTH = 4;
+  static const int DEFAULT_TIMEOUT = 3000;
+
+public:
+  DecodeStream();
+  explicit DecodeStream(DecodePipeline& pipeline);
+
+  void setAngularRoi(const AngularRoi& roi);
+  void setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder);
+  void submit(std::vector<uint8_t> oob_packet);
+  error_t readScanFrame(ScanFrame& scan_frame, int timeout = DEFAULT_TIMEOUT);
+
+  uint64_t corruptedPackets() const;
+  uint64_t droppedPackets() const;
+  uint64_t droppedFrames() const;
+
+private:
+  friend class DecodePipeline;
+
+  bool process();
+  void decodePacket(std::vector<uint8_t>& oob_packet);
+
+private:
+  static const int BATCH_SIZE = 8;
+
+private:
+  DecodePipeline* pipeline_;
+  int home_worker_;
+
+  std::mutex input_mutex_;
+  std::deque<std::vector<uint8_t>> input_queue_;
+  bool scheduled_;
+  std::vector<std::vector<uint8_t>> batch_;
+
+  std::mutex roi_mutex_;
+  AngularRoi roi_;
+  std::shared_ptr<FlightRecorder> flight_recorder_;
+
+  ScanFrame frame_;
+  int expected_block_index_;
+  int block_count_;
+  int block_length_;
+
+  std::mutex output_mutex_;
+  std::condition_variable output_cv_;
+  std::deque<ScanFrame> output_queue_;
+  std::vector<ScanFrame> spare_frames_;
+
+  std::atomic<uint64_t> corrupted_packets_;
+  std::atomic<uint64_t> dropped_packets_;
+  std::atomic<uint64_t> dropped_frames_;
+};
+
+// A pool of workers that verify, decode and assemble OOB packets for any
+// number of devices. Every worker owns a deque of ready streams; idle
+// workers steal from the others, so load spreads over all workers however
+// unevenly packets arrive. The pipeline must outlive its streams.
+class DecodePipeline
+{
+public:
+  explicit DecodePipeline(int worker_count = 0);
+  ~DecodePipeline();
+
+  std::shared_ptr<DecodeStream> createStream();
+
+  int workerCount() const;
+
+private:
+  friend class DecodeStream;
+
+  struct Worker
+  {
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<std::shared_ptr<DecodeStream>> ready_streams;
+  };
+
+  void schedule(std::shared_ptr<DecodeStream> stream, int worker_index);
+  std::shared_ptr<DecodeStream> take(int worker_index);
+  void workerLoop(int worker_index);
+
+private:
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<int> next_home_worker_;
+
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  std::atomic<int> pending_streams_;
+  bool running_;
+};
+
+}
+
+#endif
@@ -2,6 +2,11 @@
 #define LDCP_SDK_DEVICE_H_
 
 #include "ldcp/device_base.h"
+#include "ldcp/angular_roi.h"
+#include "ldcp/clock_sync.h"
+#include "ldcp/flight_recorder.h"
+#include "ldcp/decode_pipeline.h"
+#include "ldcp/raw_scan_frame.h"
 
 namespace ldcp_sdk
 {
@@ -16,6 +21,7 @@ public:
   Device(DeviceBase&& other);
 
   virtual error_t open();
+  virtual void close();
 
   error_t queryModel(std::string& model);
   error_t querySerial(std::string& serial);
@@ -27,13 +33,31 @@ public:
   error_t readTimestamp(uint32_t& timestamp);
   error_t resetTimestamp();
 
+  void startClockSync(int interval = ClockSync::DEFAULT_INTERVAL);
+  void stopClockSync();
+  bool isClockSynchronized() const;
+  int64_t toHostTime(uint32_t timestamp) const;
+
   error_t startMeasurement();
   error_t stopMeasurement();
   error_t startStreaming();
   error_t stopStreaming();
 
+  void setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout = 0);
+  void setOobReceiveBufferSize(int size);
+  error_t getOobStatistics(OobStatistics& statistics);
+
+  void setDecodePipeline(DecodePipeline* pipeline);
+  void setAngularRoi(const AngularRoi& roi);
+
+  void enableFlightRecorder(size_t capacity, int retention, const std::string& dump_directory = std::string());
+  error_t dumpFlightRecorder(const std::string& file_name);
+
   error_t readScanFrame(ScanFrame& scan_frame);
+  error_t readScanFrame(ScanFrameBuffer& buffer);
   error_t readScanBlock(ScanBlock& scan_block);
+  error_t readRawScanFrame(RawScanFrame& scan_frame);
+  error_t readRawScanBlock(RawScanBlock& scan_block);
 
   error_t getUserMacAddress(uint8_t address[]);
   error_t getNetworkAddress(in_addr_t& address);
@@ -64,6 +88,29 @@ public:
   error_t persistSettings();
 
   void rebootToBootloader();
+
+private:
+  int estimateOobReceiveBufferSize();
+  void applyHostTimestamps(ScanFrame& scan_frame);
+
+  template <class Destination>
+  error_t assembleScanFrame(Destination& destination);
+  void setDecodeStream(std::shared_ptr<DecodeStream> decode_stream);
+
+private:
+  static const int OOB_RECEIVE_BUFFER_DURATION = 250;
+
+private:
+  std::unique_ptr<ClockSync> clock_sync_;
+  std::shared_ptr<FlightRecorder> flight_recorder_;
+  std::shared_ptr<DecodeStream> decode_stream_;
+  DecodePipeline* decode_pipeline_;
+  oob_receive_mode_t oob_receive_mode_;
+  ScanFrame pipeline_frame_;
+  std::shared_ptr<const AngularRoi> roi_;
+  std::shared_ptr<const AngularRoi> frame_roi_source_;
+  AngularRoi frame_roi_;
+  int oob_receive_buffer_size_;
 };
 
 }
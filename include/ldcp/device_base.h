@@ -24,7 +24,7 @@ public:
 
   virtual error_t open();
   bool isOpened() const;
-  void close();
+  virtual void close();
 
   error_t queryOperationMode(std::string& mode);
   void reboot();
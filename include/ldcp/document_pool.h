@@ -0,0 +1,105 @@
+#ifndef LDCP_SDK_DOCUMENT_POOL_H_
+#define LDCP_SDK_DOCUMENT_POOL_H_
+
+#include <rapidjson/document.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+class DocumentPool;
+class DocumentArena;
+
+// A rapidjson document whose values live in an arena leased from a
+// DocumentPool. The arena goes back to the pool when the document is
+// destroyed or overwritten. A default-constructed document is meant as a
+// placeholder for a leased one to be moved into; it has its own heap
+// allocator, as does one created while every arena is leased.
+class PooledDocument : public rapidjson::Document
+{
+public:
+  PooledDocument();
+  PooledDocument(PooledDocument&& other);
+  ~PooledDocument();
+
+  PooledDocument& operator=(PooledDocument&& other);
+
+private:
+  friend class DocumentPool;
+
+  PooledDocument(DocumentPool* pool, DocumentArena* arena);
+
+  void release();
+
+  static AllocatorType* arenaAllocator(DocumentArena* arena);
+
+private:
+  DocumentPool* pool_;
+  DocumentArena* arena_;
+};
+
+// Per-session arenas for request, response and notification documents. Each
+// arena keeps a buffer grown to the largest document it has held, so once
+// the pool has warmed up documents are built, and parsed with parse(),
+// without touching the heap.
+class DocumentPool
+{
+public:
+  DocumentPool();
+  ~DocumentPool();
+
+  PooledDocument createDocument();
+  PooledDocument createRequest();
+
+  template<unsigned parse_flags, typename InputStream>
+  bool parse(InputStream& stream, PooledDocument& document);
+
+private:
+  friend class PooledDocument;
+
+  DocumentArena* acquire();
+  void release(DocumentArena* arena);
+
+private:
+  static const size_t ARENA_COUNT_MAX = 64;
+  static const size_t PARSE_STACK_CAPACITY = 1024;
+
+private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<DocumentArena>> arenas_;
+  std::vector<DocumentArena*> free_arenas_;
+};
+
+// Parses the stream into the document. rapidjson keeps its parse stacks on
+// the heap and frees them after every parse, so they are taken from an
+// arena of their own instead. Returns false, leaving the document null, on
+// a parse error.
+template<unsigned parse_flags, typename InputStream>
+bool DocumentPool::parse(InputStream& stream, PooledDocument& document)
+{
+  typedef rapidjson::Document::AllocatorType AllocatorType;
+  typedef rapidjson::GenericDocument<rapidjson::UTF8<>, AllocatorType, AllocatorType> Parser;
+
+  DocumentArena* arena = acquire();
+  bool parsed;
+  {
+    Parser parser(&document.GetAllocator(), PARSE_STACK_CAPACITY,
+                  arena ? PooledDocument::arenaAllocator(arena) : nullptr);
+    parser.template ParseStream<parse_flags>(stream);
+    parsed = !parser.HasParseError();
+    if (parsed)
+      static_cast<rapidjson::Value&>(document).Swap(parser);
+    else
+      document.SetNull();
+  }
+  if (arena)
+    release(arena);
+  return parsed;
+}
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef LDCP_SDK_FLIGHT_RECORDER_H_
+#define LDCP_SDK_FLIGHT_RECORDER_H_
+
+#include "ldcp/error.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+enum flight_record_t {
+  FLIGHT_RECORD_OOB_PACKET,
+  FLIGHT_RECORD_OOB_PACKET_CORRUPTED,
+  FLIGHT_RECORD_MESSAGE_RECEIVED,
+  FLIGHT_RECORD_MESSAGE_TRANSMITTED
+};
+
+// Keeps the most recent raw OOB packets and control messages of a device in
+// a fixed-size byte ring, so recording costs one copy and an uncontended
+// lock. A dump writes the records of the last retention period to a file:
+// an 8-byte "LDCPFREC" signature followed by records of int64 host time,
+// uint32 type, uint32 length and the raw bytes. When a dump directory is
+// set, a burst of CRC failures or a gap in the OOB block sequence dumps the
+// ring from a background thread, at most once per retention period.
+class FlightRecorder
+{
+public:
+  static const int DEFAULT_CRC_BURST_THRESHOLD = 5;
+
+public:
+  FlightRecorder(size_t capacity, int retention);
+  ~FlightRecorder();
+
+  void setDumpDirectory(const std::string& directory);
+  void setCrcBurstThreshold(int threshold);
+
+  void record(flight_record_t type, const uint8_t* data, size_t length);
+  void recordOobPacket(const uint8_t* data, size_t length, bool verified);
+
+  error_t dump(const std::string& file_name);
+  int anomalyDumpCount() const;
+
+private:
+  struct RecordHeader
+  {
+    int64_t time;
+    uint32_t type;
+    uint32_t length;
+  };
+
+  void write(int64_t time, flight_record_t type, const uint8_t* data, size_t length);
+  void copyIn(uint64_t position, const void* source, size_t length);
+  void copyOut(uint64_t position, void* destination, size_t length) const;
+  void detectAnomaly(int64_t time, const uint8_t* data, size_t length, bool verified);
+  void requestDump(const char* reason, int64_t time);
+  void dumpLoop();
+
+private:
+  static const int64_t CRC_BURST_WINDOW = 1000000000;
+
+private:
+  std::vector<uint8_t> ring_;
+  int64_t retention_;
+  uint64_t head_;
+  uint64_t tail_;
+  mutable std::mutex ring_mutex_;
+
+  std::mutex anomaly_mutex_;
+  int crc_burst_threshold_;
+  int crc_failures_;
+  int64_t crc_window_start_;
+  bool sequence_valid_;
+  uint16_t last_frame_index_;
+  int last_block_index_;
+  int last_block_count_;
+
+  std::string dump_directory_;
+  std::thread dump_thread_;
+  std::mutex dump_mutex_;
+  std::condition_variable dump_cv_;
+  bool running_;
+  const char* pending_reason_;
+  int64_t last_dump_time_;
+  std::atomic<int> anomaly_dumps_;
+};
+
+}
+
+#endif
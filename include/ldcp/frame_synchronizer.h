@@ -0,0 +1,70 @@
+#ifndef LDCP_SDK_FRAME_SYNCHRONIZER_H_
+#define LDCP_SDK_FRAME_SYNCHRONIZER_H_
+
+#include "ldcp/device.h"
+#include "ldcp/scan_geometry.h"
+
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ldcp_sdk
+{
+
+// Reads frames from several devices, converts each one into the common
+// vehicle frame on its own thread and merges sets of frames whose host
+// timestamps lie within the configured tolerance into one point cloud.
+class FrameSynchronizer
+{
+public:
+  typedef std::function<void(const PointCloud& merged_cloud)> MergedCloudCallback;
+
+  static const int64_t DEFAULT_TOLERANCE = 20000000;
+  static const int64_t DEFAULT_MAX_LATENCY = 200000000;
+
+public:
+  FrameSynchronizer();
+  ~FrameSynchronizer();
+
+  int addDevice(Device& device, const Pose2D& extrinsics);
+  void setTolerance(int64_t tolerance);
+  void setMaxLatency(int64_t max_latency);
+  void setMergedCloudCallback(MergedCloudCallback callback);
+
+  void start();
+  void stop();
+
+private:
+  struct Sensor
+  {
+    Device* device;
+    Pose2D extrinsics;
+    ScanGeometry geometry;
+    std::vector<float> cosines, sines;
+    std::deque<PointCloud> clouds;
+    std::thread thread;
+  };
+
+  void sensorLoop(Sensor& sensor);
+  void convert(Sensor& sensor, const ScanFrame& scan_frame, PointCloud& point_cloud);
+  bool collectSet(int64_t now, PointCloud& merged_cloud);
+
+private:
+  static const int QUEUE_LENGTH_MAX = 4;
+
+private:
+  std::vector<std::unique_ptr<Sensor>> sensors_;
+  int64_t tolerance_;
+  int64_t max_latency_;
+  MergedCloudCallback callback_;
+
+  std::atomic<bool> running_;
+  std::mutex queue_mutex_;
+  std::mutex callback_mutex_;
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef LDCP_SDK_LINE_EXTRACTOR_H_
+#define LDCP_SDK_LINE_EXTRACTOR_H_
+
+#include "ldcp/scan_segmenter.h"
+
+#include <utility>
+
+namespace ldcp_sdk
+{
+
+// A line x * cos(alpha) + y * sin(alpha) = rho, rho >= 0, in metres and
+// radians in the sensor frame, fitted by total least squares to the beams
+// [begin, end) (see ScanSegment for wrapped indices). The covariance of
+// (rho, alpha) follows from the range sigma of the extractor. The end points
+// are the first and last fitted points projected onto the line.
+struct LineFeature
+{
+  int begin;
+  int end;
+  int point_count;
+  float rho, alpha;
+  float rho_variance, alpha_variance, rho_alpha_covariance;
+  float start_x, start_y, end_x, end_y;
+};
+
+// The intersection of two consecutive lines of one segment, with the angle
+// between them in [0, pi / 2] and the indices of the lines.
+struct CornerFeature
+{
+  float x, y;
+  float angle;
+  int first_line;
+  int second_line;
+};
+
+// Extracts lines by split-and-merge on the segments of a frame. A run of
+// points is split at the point farthest from its chord while that distance
+// exceeds the split distance; neighbouring runs whose fits agree within the
+// merge tolerance are joined again. Fits use prefix sums, so each costs
+// constant time, and all buffers are kept between frames.
+class LineExtractor
+{
+public:
+  LineExtractor();
+
+  ScanSegmenter& segmenter();
+  void setSplitDistance(float distance);
+  void setMergeTolerance(float angle, float distance);
+  void setMinLineSize(int point_count, float length);
+  void setCornerThreshold(float min_angle, float max_distance);
+  void setRangeSigma(float sigma);
+
+  void process(const ScanFrame& scan_frame, std::vector<LineFeature>& lines,
+               std::vector<CornerFeature>& corners);
+
+private:
+  void collectPoints(const ScanFrame& scan_frame);
+  void computeSums();
+  void split(int first, int last);
+  void fit(int first, int last, LineFeature& line) const;
+  void detectCorner(const std::vector<LineFeature>& lines, int first_line, int second_line,
+                    int shared_point, std::vector<CornerFeature>& corners) const;
+
+private:
+  ScanSegmenter segmenter_;
+  float split_distance_;
+  float merge_angle_, merge_distance_;
+  int min_point_count_;
+  float min_length_;
+  float corner_angle_, corner_distance_;
+  float range_sigma_;
+
+  ScanGeometry geometry_;
+  std::vector<ScanSegment> segments_;
+  std::vector<float> xs_, ys_;
+  std::vector<int> beams_;
+  std::vector<double> sums_[5];
+  std::vector<std::pair<int, int>> runs_;
+  std::vector<std::pair<int, int>> stack_;
+};
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef LDCP_SDK_MOTION_DESKEW_H_
+#define LDCP_SDK_MOTION_DESKEW_H_
+
+#include "ldcp/scan_geometry.h"
+#include "ldcp/error.h"
+
+#include <functional>
+
+namespace ldcp_sdk
+{
+
+struct Velocity2D
+{
+  double vx;
+  double vy;
+  double omega;
+};
+
+// Removes the distortion caused by sensor motion during a revolution. Every
+// point is moved into the sensor frame at the time of the first block, using
+// either absolute poses or a constant velocity sampled at the frame start.
+// Times passed to callbacks are host timestamps in nanoseconds, or device
+// ticks scaled by the tick period when the frame has no host timestamps.
+class MotionDeskew
+{
+public:
+  typedef std::function<bool(int64_t time, Pose2D& pose)> PoseCallback;
+  typedef std::function<bool(int64_t time, Velocity2D& velocity)> VelocityCallback;
+
+public:
+  static void interpolatePointTimestamps(const ScanFrame& scan_frame, double tick_period,
+                                         std::vector<int64_t>& timestamps);
+
+public:
+  MotionDeskew();
+
+  void setPoseCallback(PoseCallback callback);
+  void setVelocityCallback(VelocityCallback callback);
+  void setTickPeriod(double tick_period);
+
+  error_t process(const ScanFrame& scan_frame, PointCloud& point_cloud);
+
+private:
+  static void blockTimes(const ScanFrame& scan_frame, double tick_period, std::vector<int64_t>& times);
+
+  bool computeBlockTransforms(const std::vector<int64_t>& times);
+
+private:
+  PoseCallback pose_callback_;
+  VelocityCallback velocity_callback_;
+  double tick_period_;
+
+  ScanGeometry geometry_;
+  std::vector<int64_t> block_times_;
+  std::vector<float> transform_cos_, transform_sin_, transform_x_, transform_y_;
+};
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef LDCP_SDK_OCCUPANCY_GRID_H_
+#define LDCP_SDK_OCCUPANCY_GRID_H_
+
+#include "ldcp/error.h"
+#include "ldcp/scan_geometry.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+struct OccupancyTile;
+
+// An immutable view of an OccupancyGrid. It shares the grid's tiles, so
+// taking one copies a pointer per tile, and the grid copies a tile before
+// its next update while a snapshot still holds it. Coordinates are in
+// metres in the map frame.
+class OccupancyGridSnapshot
+{
+public:
+  OccupancyGridSnapshot();
+
+  double resolution() const;
+  bool isEmpty() const;
+
+  float probability(double x, double y) const;
+  void exportCells(std::vector<int8_t>& cells, int& width, int& height,
+                   double& origin_x, double& origin_y) const;
+
+private:
+  friend class OccupancyGrid;
+
+  double resolution_;
+  int tile_origin_x_, tile_origin_y_;
+  int tile_columns_, tile_rows_;
+  std::vector<std::shared_ptr<const OccupancyTile>> tiles_;
+};
+
+// Log-odds occupancy grid built from frames taken at known sensor poses.
+// Cells are 16-bit fixed-point log-odds in square tiles that are allocated
+// the first time a frame touches them. Each frame updates the tiles around
+// the sensor by projecting every cell onto the beam through its centre,
+// which marks it occupied or free exactly once per frame and runs as one
+// vectorized pass per tile row. The tiles are grouped into angular sectors
+// around the sensor that the workers claim one at a time, so no two workers
+// touch the same tile. The calling thread is one of the workers.
+class OccupancyGrid
+{
+public:
+  static const int TILE_SIZE = 64;
+
+public:
+  explicit OccupancyGrid(double resolution = 0.05, int worker_count = 0);
+  ~OccupancyGrid();
+
+  void setHitProbabilities(float hit, float miss);
+  void setProbabilityLimits(float min_probability, float max_probability);
+  void setMaxRange(float range);
+  void clear();
+
+  error_t update(const ScanFrame& scan_frame, const Pose2D& pose);
+  void snapshot(OccupancyGridSnapshot& snapshot);
+
+  double resolution() const;
+  int tileCount();
+
+private:
+  struct Worker
+  {
+    std::thread thread;
+    std::vector<int16_t> deltas;
+  };
+
+  void reserveTiles(int min_x, int min_y, int max_x, int max_y);
+  void processSectors(std::vector<int16_t>& deltas);
+  void updateTile(int tile_index, std::vector<int16_t>& deltas);
+  void workerLoop(int worker_index);
+
+private:
+  double resolution_;
+  int16_t hit_update_, miss_update_;
+  int16_t min_log_odds_, max_log_odds_;
+  float max_range_;
+
+  std::mutex mutex_;
+  int tile_origin_x_, tile_origin_y_;
+  int tile_columns_, tile_rows_;
+  std::vector<std::shared_ptr<OccupancyTile>> tiles_;
+
+  ScanGeometry geometry_;
+  std::vector<float> ranges_;
+  double sensor_x_, sensor_y_;
+  float sensor_cos_, sensor_sin_;
+  std::vector<int> sector_offsets_;
+  std::vector<int> sector_tiles_;
+  std::vector<int> tile_sectors_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex job_mutex_;
+  std::condition_variable job_cv_, done_cv_;
+  uint64_t generation_;
+  int busy_workers_;
+  bool running_;
+  std::atomic<int> next_sector_;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef LDCP_SDK_OOB_RECEIVER_H_
+#define LDCP_SDK_OOB_RECEIVER_H_
+
+#include "ldcp/error.h"
+#include "ldcp/location.h"
+#include "ldcp/data_types.h"
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+// A UDP socket bound once per local endpoint and shared by every transport
+// whose device targets that endpoint. Datagrams are drained in batches and
+// dispatched to the transport registered for the sender's address and port.
+// In busy-poll mode a dedicated thread spins on the non-blocking socket
+// instead of waiting in the asio reactor. The mode, and the busy-poll
+// timeout, are fixed by whichever transport first acquires the endpoint;
+// acquiring it with others fails with invalid_params rather than silently
+// sharing a socket in the wrong mode. The socket receive buffer is sized to
+// the sum of the sizes requested by the registered transports.
+class OobReceiver
+{
+public:
+  typedef std::function<void(uint8_t* data, size_t length)> PacketCallback;
+
+public:
+  static std::shared_ptr<OobReceiver> acquire(const NetworkLocation& local_location,
+                                              oob_receive_mode_t mode, int busy_poll_timeout,
+                                              error_t& result);
+
+public:
+  ~OobReceiver();
+
+  void registerSender(const NetworkLocation& sender_location, PacketCallback callback,
+                      int receive_buffer_size = 0);
+  void unregisterSender(const NetworkLocation& sender_location);
+  void getStatistics(const NetworkLocation& sender_location, OobStatistics& statistics);
+
+private:
+  struct Sender
+  {
+    PacketCallback callback;
+    int receive_buffer_size;
+    uint64_t packets_received;
+    int64_t receive_latency_sum, receive_latency_max;
+    int64_t delivery_latency_sum, delivery_latency_max;
+  };
+
+  OobReceiver();
+
+  error_t open(const NetworkLocation& local_location, oob_receive_mode_t mode, int busy_poll_timeout);
+  void updateReceiveBufferSize();
+  void waitForPackets();
+  int receivePackets();
+  void dispatchPacket(in_addr_t address, in_port_t port, uint8_t* data, size_t length,
+                      int64_t arrival_time, int64_t wakeup_time);
+
+  static uint64_t senderKey(in_addr_t address, in_port_t port);
+  static int64_t realTime();
+
+private:
+  static const int BATCH_SIZE = 16;
+  static const int PACKET_LENGTH_MAX = 65535;
+  static const int CONTROL_LENGTH_MAX = 64;
+
+private:
+  asio::io_service io_service_;
+  asio::ip::udp::socket socket_;
+  std::thread thread_;
+  oob_receive_mode_t mode_;
+  int busy_poll_timeout_;
+  std::atomic<bool> polling_;
+
+  std::vector<uint8_t> receive_buffer_;
+  std::vector<uint8_t> control_buffer_;
+
+  std::mutex senders_mutex_;
+  std::unordered_map<uint64_t, Sender> senders_;
+  uint32_t kernel_drops_;
+};
+
+}
+
+#endif
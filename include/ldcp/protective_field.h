@@ -0,0 +1,59 @@
+#ifndef LDCP_SDK_PROTECTIVE_FIELD_H_
+#define LDCP_SDK_PROTECTIVE_FIELD_H_
+
+#include "ldcp/data_types.h"
+#include "ldcp/error.h"
+
+namespace ldcp_sdk
+{
+
+// Polygon zones, in metres in the sensor frame, checked block by block. For
+// every beam each zone is reduced to the span of ranges between the first
+// and the last crossing of the beam with the polygon, so evaluating a block
+// costs two compares per beam and zone. Along a beam a non-convex zone is
+// taken as its outer span, which errs on the side of reporting a violation.
+// A zone is violated by a block when at least min_beam_count beams fall in
+// it, and stays violated until the block at the same index is clear again.
+// The result of a block expires once two revolutions' worth of other blocks
+// have been evaluated without it; isComplete() tells whether every block of
+// the revolution is current.
+class ProtectiveField
+{
+public:
+  static const int ZONE_COUNT_MAX = 32;
+
+public:
+  ProtectiveField();
+
+  int addZone(const std::vector<Point2D>& polygon);
+  void clearZones();
+  int zoneCount() const;
+  void setMinBeamCount(int count);
+
+  void update(angular_fov_t angular_fov, int beam_count);
+
+  error_t evaluate(const ScanBlock& scan_block);
+  uint32_t violatedZones() const;
+  uint32_t zoneMask() const;
+  bool isComplete() const;
+  void reset();
+
+private:
+  void computeThresholds(const std::vector<Point2D>& polygon, int* near_thresholds, int* far_thresholds);
+
+private:
+  std::vector<std::vector<Point2D>> zones_;
+  int min_beam_count_;
+
+  angular_fov_t angular_fov_;
+  int beam_count_;
+  std::vector<int> near_thresholds_;
+  std::vector<int> far_thresholds_;
+  std::vector<uint32_t> block_violations_;
+  std::vector<uint64_t> block_sequences_;
+  uint64_t sequence_;
+};
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LDCP_SDK_RAW_SCAN_FRAME_H_
+#define LDCP_SDK_RAW_SCAN_FRAME_H_
+
+#include "ldcp/data_types.h"
+
+#include <memory>
+
+namespace ldcp_sdk
+{
+
+// A verified OOB packet kept in its wire format. Copies share the packet
+// through a reference count, and nothing is widened until a field or a
+// range of beams is asked for.
+class RawScanBlock
+{
+public:
+  typedef std::shared_ptr<const std::vector<uint8_t>> PacketPointer;
+
+public:
+  int64_t host_timestamp;
+
+public:
+  RawScanBlock();
+  explicit RawScanBlock(PacketPointer oob_packet);
+
+  bool isValid() const;
+
+  int blockIndex() const;
+  int blockCount() const;
+  int blockLength() const;
+  unsigned int timestamp() const;
+  angular_fov_t angularFov() const;
+  int intensityWidth() const;
+
+  int range(int index) const;
+  int intensity(int index) const;
+  void decodeRanges(int begin, int end, int* ranges) const;
+  void decodeIntensities(int begin, int end, int* intensities) const;
+  void decode(ScanBlock& scan_block) const;
+
+private:
+  const OobPacketHeader* header() const;
+  const uint16_t* ranges() const;
+
+private:
+  PacketPointer oob_packet_;
+};
+
+// The blocks of one frame, in block order. Beam indices run over the whole
+// frame and are mapped to the block that holds them on access.
+class RawScanFrame
+{
+public:
+  std::vector<RawScanBlock> blocks;
+  int64_t host_timestamp;
+
+public:
+  RawScanFrame();
+
+  int beamCount() const;
+  unsigned int timestamp() const;
+  angular_fov_t angularFov() const;
+
+  int range(int beam_index) const;
+  int intensity(int beam_index) const;
+  void decodeRanges(int begin, int end, int* ranges) const;
+  void decodeIntensities(int begin, int end, int* intensities) const;
+  void decode(ScanFrame& scan_frame) const;
+};
+
+}
+
+#endif
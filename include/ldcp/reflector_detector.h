@@ -0,0 +1,79 @@
+#ifndef LDCP_SDK_REFLECTOR_DETECTOR_H_
+#define LDCP_SDK_REFLECTOR_DETECTOR_H_
+
+#include "ldcp/scan_geometry.h"
+
+namespace ldcp_sdk
+{
+
+// A retro-reflector seen on beams [begin, end), with indices as in
+// ScanSegment. beam_index is the intensity-weighted centre of the run, in
+// beams, and angle, range, x and y locate the reflector centre in radians
+// and metres in the sensor frame. width is the distance between the first
+// and last return of the run.
+struct Reflector
+{
+  int begin;
+  int end;
+  float beam_index;
+  float angle;
+  float range;
+  float x, y;
+  float width;
+  int peak_intensity;
+};
+
+// Finds runs of consecutive beams whose intensity reaches the threshold.
+// One vectorized pass marks the qualifying beams, then zero stretches of
+// the mask are skipped a word at a time while the runs are collected. A
+// range jump inside a run splits it. Beams are weighted by how far their
+// intensity exceeds the threshold, which gives the centre to a fraction of
+// a beam. For cylindrical reflectors the radius is added to the range so
+// the centre of the cylinder is reported.
+//
+// Intensities are compared as the device reports them, so the threshold is
+// in the units of its intensity width. The default of 200 is meant for
+// INTENSITY_WIDTH_8BIT; a device sending INTENSITY_WIDTH_16BIT needs a
+// threshold on the 0-65535 scale, e.g. 200 * 257 for the same level.
+class ReflectorDetector
+{
+public:
+  ReflectorDetector();
+
+  void setIntensityThreshold(int threshold);
+  void setBeamCountLimits(int min_beam_count, int max_beam_count);
+  void setWidthLimits(float min_width, float max_width);
+  void setMaxRangeJump(int jump);
+  void setReflectorRadius(float radius);
+
+  void process(const ScanFrame& scan_frame, std::vector<Reflector>& reflectors);
+
+private:
+  struct Run
+  {
+    int begin;
+    int end;
+    double weight_sum;
+    double index_sum;
+    double range_sum;
+    int peak_intensity;
+  };
+
+  void collectRuns(const int* ranges, const int* intensities, int beam_count);
+  bool finish(const Run& run, const int* ranges, int beam_count, Reflector& reflector) const;
+
+private:
+  int threshold_;
+  int min_beam_count_, max_beam_count_;
+  float min_width_, max_width_;
+  int max_range_jump_;
+  float radius_;
+
+  ScanGeometry geometry_;
+  std::vector<uint8_t> mask_;
+  std::vector<Run> runs_;
+};
+
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef LDCP_SDK_SCAN_FILTER_H_
+#define LDCP_SDK_SCAN_FILTER_H_
+
+#include "ldcp/data_types.h"
+
+namespace ldcp_sdk
+{
+
+// Host-side filter chain for the ranges of a frame. Range limits, intensity
+// limits and the shadow test decide per beam whether it is kept; the median
+// then smooths the kept ranges over a window of 3 or 5 beams, ignoring
+// removed neighbours. All stages run fused, tile by tile, in branch-free
+// loops the compiler vectorizes. Removed beams get range and intensity 0.
+// A beam is a shadow (mixed pixel) when the segment to a neighbour is seen
+// at less than the shadow angle from the beam direction.
+class ScanFilter
+{
+public:
+  ScanFilter();
+
+  void setRangeLimits(int min_range, int max_range);
+  void setIntensityLimits(int min_intensity, int max_intensity);
+  void setShadowAngle(double min_angle);
+  void setMedianWindow(int window);
+
+  void apply(ScanFrame& scan_frame);
+  void apply(int* ranges, int* intensities, int beam_count, double angle_increment);
+
+private:
+  static const int TILE_LENGTH = 1024;
+
+private:
+  int min_range_, max_range_;
+  int min_intensity_, max_intensity_;
+  double shadow_angle_;
+  int median_window_;
+  std::vector<int> scratch_;
+};
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef LDCP_SDK_SCAN_FRAME_CODEC_H_
+#define LDCP_SDK_SCAN_FRAME_CODEC_H_
+
+#include "ldcp/data_types.h"
+#include "ldcp/error.h"
+
+namespace ldcp_sdk
+{
+
+// Lossless compact encoding of scan frames. Ranges are delta-coded against
+// the beam LANE_COUNT positions earlier, zigzag-mapped and bit-packed in
+// chunks of CHUNK_LENGTH values with one bit width per chunk; intensities
+// are bit-packed the same way without the delta step. Values of a chunk are
+// interleaved across LANE_COUNT lanes so that every encode and decode loop
+// runs over contiguous lanes and vectorizes. The encoding is little-endian.
+// decode() rejects truncated data and channels longer than BEAM_COUNT_MAX,
+// a full revolution at the highest resolution.
+class ScanFrameCodec
+{
+public:
+  static const int LANE_COUNT = 8;
+  static const int CHUNK_LENGTH = 128;
+  static const int BEAM_COUNT_MAX = 120000;
+
+public:
+  void encode(const ScanFrame& scan_frame, std::vector<uint8_t>& data);
+  error_t decode(const uint8_t* data, size_t length, ScanFrame& scan_frame);
+
+private:
+  void encodeChannel(const std::vector<int>& values, bool delta, std::vector<uint8_t>& data);
+  bool decodeChannel(const uint8_t*& data, const uint8_t* end, bool delta, std::vector<int>& values);
+
+private:
+  std::vector<uint32_t> residuals_;
+  std::vector<uint32_t> words_;
+};
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef LDCP_SDK_SCAN_GEOMETRY_H_
+#define LDCP_SDK_SCAN_GEOMETRY_H_
+
+#include "ldcp/data_types.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static const double PI = 3.14159265358979323846;
+
+// Beam angle tables for a frame layout. Beam i of a frame with N beams points
+// at startAngle() + i * fieldOfView() / N radians, counter-clockwise, with 0
+// along the sensor's forward axis. Ranges are in millimetres and point
+// clouds in metres.
+class ScanGeometry
+{
+public:
+  static constexpr float RANGE_SCALE = 0.001f;
+
+public:
+  static double fieldOfView(angular_fov_t angular_fov);
+  static double startAngle(angular_fov_t angular_fov);
+  static int beamCount(scan_resolution_t resolution, angular_fov_t angular_fov);
+  static float fastAtan2(float y, float x);
+
+public:
+  ScanGeometry();
+
+  void update(angular_fov_t angular_fov, int beam_count);
+
+  angular_fov_t angularFov() const;
+  int beamCount() const;
+  double angleIncrement() const;
+  double angle(int beam_index) const;
+  int beamIndex(double angle) const;
+  int beamIndex(float y, float x, int decimation = 1) const;
+
+  const float* cosines() const;
+  const float* sines() const;
+
+  void toPointCloud(const ScanFrame& scan_frame, PointCloud& point_cloud);
+
+private:
+  angular_fov_t angular_fov_;
+  int beam_count_;
+  float start_angle_;
+  float inverse_increment_;
+  std::vector<float> cosines_;
+  std::vector<float> sines_;
+};
+
+// Polynomial atan2 built on an 11th-order minimax fit of atan on [0, 1].
+// Its error stays within 2e-6 radians, under 4% of the beam spacing at
+// 120K, so a bearing lands on the right beam or, next to a beam boundary,
+// its neighbour. It has no branches or calls, so loops that look up beams
+// by bearing still vectorize.
+inline float ScanGeometry::fastAtan2(float y, float x)
+{
+  float ax = std::fabs(x), ay = std::fabs(y);
+  float num = std::min(ax, ay), den = std::max(ax, ay);
+  float a = num / std::max(den, FLT_MIN);
+  float s = a * a;
+  float r = (((((-0.0117191357f * s + 0.0526473515f) * s - 0.116426482f) * s + 0.193540376f) * s -
+              0.332622828f) * s + 0.999977219f) * a;
+  r = (ay > ax) ? 1.57079637f - r : r;
+  r = (x < 0) ? 3.14159274f - r : r;
+  return (y < 0) ? -r : r;
+}
+
+// Beam, or group of decimation beams, that the bearing of (x, y) falls on,
+// or -1 outside the field of view. Built on fastAtan2 and free of branches
+// for the same loops.
+inline int ScanGeometry::beamIndex(float y, float x, int decimation) const
+{
+  const int count = (beam_count_ + decimation - 1) / decimation;
+  const int wrap = (angular_fov_ == ANGULAR_FOV_360DEG) ? count : 0;
+  const float scale = inverse_increment_ / decimation;
+  // Biased by the count so the value stays positive and truncation rounds
+  // down.
+  const float offset = (0.5f - start_angle_ * inverse_increment_) / decimation + count;
+  int index = (int)(fastAtan2(y, x) * scale + offset) - count;
+  index += (index < 0) ? wrap : 0;
+  index -= (index >= count) ? wrap : 0;
+  return (index >= 0 && index < count) ? index : -1;
+}
+
+}
+
+#endif
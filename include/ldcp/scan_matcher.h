@@ -0,0 +1,90 @@
+#ifndef LDCP_SDK_SCAN_MATCHER_H_
+#define LDCP_SDK_SCAN_MATCHER_H_
+
+#include "ldcp/device.h"
+#include "ldcp/scan_geometry.h"
+
+namespace ldcp_sdk
+{
+
+// Pose of a frame in the frame before it, in metres and radians, with the
+// covariance of (x, y, theta) in row-major order. residual is the RMS
+// point-to-line distance of the final fit. valid is false for the first
+// frame and when too few correspondences were found.
+struct ScanMatch
+{
+  Pose2D pose;
+  double covariance[9];
+  int correspondence_count;
+  double residual;
+  bool valid;
+};
+
+// Incremental scan-to-scan odometry. Every frame is reduced to a pyramid of
+// levels, each keeping the nearest return out of every 4 points of the level
+// below, until a level has few enough points for an exhaustive search.
+// Points are paired with the previous frame by projecting them onto its
+// beams, so no search structure is built. Matching starts from the motion
+// of the last frame, runs a correlative search over the search window on
+// the coarsest level and refines the pose level by level with point-to-line
+// Gauss-Newton iterations. pose() accumulates the matched motion.
+class ScanMatcher
+{
+public:
+  static const int LEVEL_COUNT_MAX = 6;
+
+public:
+  ScanMatcher();
+
+  void setLevelCount(int count);
+  void setSearchWindow(double linear, double angular, double linear_step);
+  void setMaxCorrespondenceDistance(float distance);
+  void setNormalRadius(float radius);
+  void setMaxIterations(int count);
+  void reset();
+
+  error_t process(const ScanFrame& scan_frame, ScanMatch& match);
+  error_t process(Device& device, ScanMatch& match);
+
+  const Pose2D& pose() const;
+
+private:
+  struct Level
+  {
+    int decimation;
+    std::vector<float> x, y;
+    std::vector<float> normal_x, normal_y;
+    std::vector<uint8_t> valid;
+    std::vector<uint8_t> normal_valid;
+  };
+
+  void buildLevels(const ScanFrame& scan_frame, std::vector<Level>& levels);
+  void computeNormals(Level& level, bool closed, float increment);
+  void project(const Level& reference, const Level& current, const Pose2D& pose);
+  void correlativeSearch(const Level& reference, const Level& current, Pose2D& pose);
+  int refine(const Level& reference, const Level& current, float max_distance, Pose2D& pose,
+             double hessian[9], double& residual_sum);
+
+private:
+  int level_count_;
+  double search_linear_, search_angular_, search_step_;
+  float max_distance_;
+  int max_iterations_;
+  float normal_radius_;
+
+  ScanGeometry geometry_;
+  std::vector<Level> reference_;
+  std::vector<Level> current_;
+  int built_level_count_;
+  std::vector<double> sums_;
+  std::vector<float> projected_x_, projected_y_;
+  std::vector<int> indices_;
+  bool has_reference_;
+  Pose2D motion_;
+  Pose2D pose_;
+  ScanFrame frame_;
+};
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef LDCP_SDK_SCAN_SEGMENTER_H_
+#define LDCP_SDK_SCAN_SEGMENTER_H_
+
+#include "ldcp/scan_geometry.h"
+
+namespace ldcp_sdk
+{
+
+// A run of consecutive beams taken to lie on one object. Beam indices are
+// [begin, end); a segment that wraps around a 360 degree frame has end
+// beyond the beam count and its indices are taken modulo the beam count. A
+// closed contour around the sensor is one segment with end - begin equal
+// to the beam count. Coordinates are in metres in the sensor frame.
+struct ScanSegment
+{
+  int begin;
+  int end;
+  int point_count;
+  float centroid_x, centroid_y;
+  float min_x, min_y, max_x, max_y;
+  float first_x, first_y, last_x, last_y;
+};
+
+// Splits a frame into segments in one pass over the beams. Two neighbouring
+// returns belong to one segment when their distance is below the adaptive
+// breakpoint threshold r * sin(d) / sin(lambda - d) + 3 * sigma, where r is
+// the range of the earlier return and d the angle between the two beams.
+// Up to max_gap dropouts may sit inside a segment. On 360 degree frames
+// the last and first segments are merged when they meet across the seam.
+class ScanSegmenter
+{
+public:
+  ScanSegmenter();
+
+  void setBreakpointThreshold(double lambda, double sigma);
+  void setMinPointCount(int count);
+  void setMaxGap(int gap);
+
+  void process(const ScanFrame& scan_frame, std::vector<ScanSegment>& segments);
+
+private:
+  bool connected(int previous_range, int gap, float distance_squared) const;
+
+private:
+  double lambda_;
+  double sigma_;
+  int min_point_count_;
+  int max_gap_;
+
+  ScanGeometry geometry_;
+  float neighbour_ratio_;
+};
+
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include "ldcp/location.h"
 #include "ldcp/transport.h"
+#include "ldcp/document_pool.h"
+#include "ldcp/decode_pipeline.h"
 
 #include <rapidjson/document.h>
 
@@ -18,23 +20,29 @@ public:
   Session();
 
   void setTimeout(int timeout);
+  int timeout() const;
 
   error_t open(const Location& location);
   void close();
   bool isOpened() const;
 
-  rapidjson::Document createEmptyRequestObject();
-  void executeCommand(rapidjson::Document request);
-  error_t executeCommand(rapidjson::Document request, rapidjson::Document& response);
+  PooledDocument createEmptyRequestObject();
+  void executeCommand(PooledDocument request);
+  error_t executeCommand(PooledDocument request, PooledDocument& response);
 
+  void setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout);
+  void setOobReceiveBufferSize(int size);
+  void setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder);
+  void setDecodeStream(std::shared_ptr<DecodeStream> decode_stream);
   error_t enableOobTransport(const Location& location);
+  error_t getOobStatistics(OobStatistics& statistics);
 
-  error_t pollForScanBlock(rapidjson::Document& notification,
+  error_t pollForScanBlock(PooledDocument& notification,
                            std::vector<uint8_t>& oob_data);
 
 private:
-  void onMessageReceived(rapidjson::Document message);
-  void onOobPacketReceived(std::vector<uint8_t> oob_packet);
+  void onMessageReceived(PooledDocument message);
+  void onOobPacketReceived(std::vector<uint8_t> oob_packet, bool verified);
 
 private:
   static const int DEFAULT_TIMEOUT = 3000;
@@ -42,20 +50,27 @@ private:
 
 private:
   int timeout_;
+  oob_receive_mode_t oob_receive_mode_;
+  int busy_poll_timeout_;
+  int oob_receive_buffer_size_;
+  std::shared_ptr<FlightRecorder> flight_recorder_;
+  std::shared_ptr<DecodeStream> decode_stream_;
 
+  DocumentPool document_pool_;
   std::unique_ptr<Transport> transport_;
 
   int id_;
   std::mutex command_mutex_;
 
-  std::deque<rapidjson::Document> response_queue_;
+  std::deque<PooledDocument> response_queue_;
   std::mutex response_queue_mutex_;
   std::condition_variable response_queue_cv_;
 
-  std::deque<rapidjson::Document> scan_block_queue_primary_;
+  std::deque<PooledDocument> scan_block_queue_primary_;
   std::deque<std::vector<uint8_t>> scan_block_queue_oob_;
   std::mutex scan_block_queue_mutex_;
   std::condition_variable scan_block_queue_cv_;
+  uint64_t scan_block_queue_drops_;
 };
 
 }
@@ -0,0 +1,82 @@
+#ifndef LDCP_SDK_SHM_FRAME_RING_H_
+#define LDCP_SDK_SHM_FRAME_RING_H_
+
+#include "ldcp/data_types.h"
+#include "ldcp/error.h"
+
+#include <string>
+
+namespace ldcp_sdk
+{
+
+// Frames published into a POSIX shared-memory ring. Every slot is guarded by
+// a sequence counter that is odd while the publisher writes it, so readers
+// can use the data in place and check afterwards that it was not overwritten.
+// Opening a publisher replaces any existing ring of the same name.
+
+class ShmFramePublisher
+{
+public:
+  static const int DEFAULT_SLOT_COUNT = 8;
+
+public:
+  ShmFramePublisher();
+  ~ShmFramePublisher();
+
+  error_t open(const std::string& name, int beam_count_max, int slot_count = DEFAULT_SLOT_COUNT);
+  void close();
+  bool isOpened() const;
+
+  error_t publish(const ScanFrame& scan_frame);
+
+private:
+  std::string name_;
+  uint8_t* mapping_;
+  size_t mapping_size_;
+};
+
+class ShmFrameView
+{
+public:
+  uint32_t frame_number;
+  unsigned int timestamp;
+  int64_t host_timestamp;
+  angular_fov_t angular_fov;
+  int block_count;
+  int beam_count;
+  const uint32_t* block_timestamps;
+  const int64_t* block_host_timestamps;
+  const uint16_t* ranges;
+  const uint16_t* intensities;
+
+private:
+  friend class ShmFrameReader;
+  int slot_index;
+  uint32_t sequence;
+};
+
+class ShmFrameReader
+{
+public:
+  ShmFrameReader();
+  ~ShmFrameReader();
+
+  error_t open(const std::string& name);
+  void close();
+  bool isOpened() const;
+
+  error_t waitForFrame(int timeout);
+  error_t acquireLatest(ShmFrameView& view);
+  bool isValid(const ShmFrameView& view) const;
+
+  error_t readScanFrame(ScanFrame& scan_frame, int timeout);
+
+private:
+  const uint8_t* mapping_;
+  size_t mapping_size_;
+  uint32_t last_write_count_;
+};
+
+}
+
+#endif
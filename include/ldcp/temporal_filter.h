@@ -0,0 +1,65 @@
+#ifndef LDCP_SDK_TEMPORAL_FILTER_H_
+#define LDCP_SDK_TEMPORAL_FILTER_H_
+
+#include "ldcp/data_types.h"
+
+namespace ldcp_sdk
+{
+
+enum temporal_estimate_t {
+  TEMPORAL_ESTIMATE_MEAN,
+  TEMPORAL_ESTIMATE_MEDIAN
+};
+
+// Keeps the ranges of the last depth frames of one device, beam-major, with
+// running per-beam sums so mean and variance are updated in constant time
+// per beam whatever the depth. The median sorts the depth samples of each
+// beam. Ranges of 0 are dropouts and are left out of every statistic. A
+// beam valid in fewer than min_valid_count of the kept frames reads 0, and
+// a beam valid at least that often is held at its estimate, which
+// suppresses flicker between a return and a dropout.
+class TemporalFilter
+{
+public:
+  static const int DEPTH_MAX = 16;
+
+public:
+  explicit TemporalFilter(int depth = 5);
+
+  void setEstimate(temporal_estimate_t estimate);
+  void setMinValidCount(int count);
+  void reset();
+
+  void update(const ScanFrame& scan_frame);
+  void apply(ScanFrame& scan_frame);
+
+  int beamCount() const;
+  int frameCount() const;
+  const std::vector<float>& means() const;
+  const std::vector<float>& variances() const;
+
+private:
+  void estimateMedians(int* ranges);
+
+private:
+  static const int LANE_COUNT = 16;
+
+private:
+  int depth_;
+  temporal_estimate_t estimate_;
+  int min_valid_count_;
+
+  int beam_count_;
+  int frame_count_;
+  int slot_;
+  std::vector<uint16_t> history_;
+  std::vector<int32_t> sums_;
+  std::vector<int64_t> square_sums_;
+  std::vector<uint8_t> valid_counts_;
+  std::vector<float> means_;
+  std::vector<float> variances_;
+};
+
+}
+
+#endif
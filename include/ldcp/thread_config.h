@@ -0,0 +1,78 @@
+#ifndef LDCP_SDK_THREAD_CONFIG_H_
+#define LDCP_SDK_THREAD_CONFIG_H_
+
+#include "ldcp/error.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+enum thread_role_t {
+  THREAD_ROLE_TRANSPORT,
+  THREAD_ROLE_OOB_RECEIVER,
+  THREAD_ROLE_PROCESSING,
+  THREAD_ROLE_BACKGROUND,
+  THREAD_ROLE_COUNT
+};
+
+enum scheduling_policy_t {
+  SCHEDULING_POLICY_DEFAULT,
+  SCHEDULING_POLICY_FIFO,
+  SCHEDULING_POLICY_RR
+};
+
+class ThreadConfig
+{
+public:
+  ThreadConfig();
+
+  std::vector<int> cpu_affinity;
+  scheduling_policy_t scheduling_policy;
+  int priority;
+  size_t prefault_stack_size;
+};
+
+// Every thread created by the SDK goes through ThreadManager, which applies
+// the configuration of its role from inside the new thread before running it.
+// Configuration changes only affect threads created afterwards.
+class ThreadManager
+{
+public:
+  static ThreadManager& instance();
+
+  void setThreadConfig(const ThreadConfig& config);
+  void setThreadConfig(thread_role_t role, const ThreadConfig& config);
+  ThreadConfig threadConfig(thread_role_t role);
+
+  error_t lockMemory();
+  void unlockMemory();
+  bool isMemoryLocked() const;
+
+  int configurationFailures() const;
+
+  std::thread createThread(thread_role_t role, const std::string& name, std::function<void()> function);
+
+  static void prefault(void* data, size_t size);
+
+private:
+  ThreadManager();
+
+  error_t applyThreadConfig(const ThreadConfig& config, const std::string& name);
+  static void prefaultStack(size_t size);
+
+private:
+  std::mutex config_mutex_;
+  ThreadConfig configs_[THREAD_ROLE_COUNT];
+  std::atomic<bool> memory_locked_;
+  std::atomic<int> configuration_failures_;
+};
+
+}
+
+#endif
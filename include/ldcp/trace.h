@@ -0,0 +1,101 @@
+#ifndef LDCP_SDK_TRACE_H_
+#define LDCP_SDK_TRACE_H_
+
+#include "ldcp/error.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ldcp_sdk
+{
+
+enum trace_event_t {
+  TRACE_EVENT_PACKET_RECEIVE,
+  TRACE_EVENT_CRC_VERIFY,
+  TRACE_EVENT_BLOCK_ENQUEUE,
+  TRACE_EVENT_BLOCK_DEQUEUE,
+  TRACE_EVENT_BLOCK_DECODE,
+  TRACE_EVENT_FRAME_COMPLETE,
+  TRACE_EVENT_COMMAND_SEND,
+  TRACE_EVENT_COMMAND_RESPONSE,
+  TRACE_EVENT_COUNT
+};
+
+// Records timestamped events from SDK threads into one ring per thread. A
+// thread only ever writes its own ring, so recording takes no lock; the
+// exporter discards any event overwritten while it was being copied. When a
+// thread exits its ring is kept for export until another thread reuses it,
+// so there are never more rings than threads recording at once. Events are
+// only recorded when the SDK is built with ENABLE_TRACING.
+class Tracer
+{
+public:
+  static Tracer& instance();
+  static bool isEnabled();
+
+  void record(trace_event_t event, uint64_t argument);
+  void setThreadName(const std::string& name);
+  void clear();
+
+  error_t exportChromeTrace(std::ostream& stream);
+  error_t exportChromeTrace(const std::string& file_name);
+
+private:
+  static const uint64_t RING_SIZE = 1 << 13;
+
+  struct Event
+  {
+    int64_t time;
+    uint64_t argument;
+    trace_event_t event;
+  };
+
+  struct Ring
+  {
+    int thread_id;
+    std::string thread_name;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    Event events[RING_SIZE];
+  };
+
+  // Hands the calling thread's ring back when the thread exits
+  struct LocalRing
+  {
+    LocalRing();
+    ~LocalRing();
+
+    Ring* ring;
+  };
+
+  Tracer();
+
+  Ring* localRing();
+  Ring* acquireRing();
+  void releaseRing(Ring* ring);
+
+private:
+  std::mutex rings_mutex_;
+  std::vector<std::unique_ptr<Ring>> rings_;
+  std::vector<Ring*> free_rings_;
+  int next_thread_id_;
+};
+
+}
+
+#ifdef LDCP_SDK_TRACING
+#define LDCP_TRACE(event, argument) ::ldcp_sdk::Tracer::instance().record((event), (uint64_t)(argument))
+#define LDCP_TRACE_THREAD_NAME(name) ::ldcp_sdk::Tracer::instance().setThreadName(name)
+#else
+// The arguments stay unevaluated operands, so variables only kept for
+// tracing are not reported as unused
+#define LDCP_TRACE(event, argument) ((void)sizeof((event), (argument)))
+#define LDCP_TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef LDCP_SDK_TRANSPORT_H_
 #define LDCP_SDK_TRANSPORT_H_
 
+#include <atomic>
 #include <functional>
 #include <vector>
 #include <memory>
@@ -9,6 +10,9 @@
 
 #include "ldcp/error.h"
 #include "ldcp/location.h"
+#include "ldcp/data_types.h"
+#include "ldcp/document_pool.h"
+#include "ldcp/flight_recorder.h"
 
 namespace ldcp_sdk
 {
@@ -20,10 +24,10 @@ public:
   const static int OOB_PACKET_LENGTH_MAX = 65535;
 
 public:
-  typedef std::function<void(rapidjson::Document)> ReceivedMessageCallback;
+  typedef std::function<void(PooledDocument)> ReceivedMessageCallback;
   typedef std::function<void(const error_t)> TransmitErrorCallback;
   typedef std::function<void(const error_t)> ReceiveErrorCallback;
-  typedef std::function<void(std::vector<uint8_t>)> ReceivedOobPacketCallback;
+  typedef std::function<void(std::vector<uint8_t>, bool)> ReceivedOobPacketCallback;
 
 public:
   static std::unique_ptr<Transport> create(const Location& location);
@@ -35,16 +39,34 @@ public:
   virtual void disconnect() = 0;
   virtual bool isConnected() const = 0;
 
-  virtual void transmitMessage(rapidjson::Document message) = 0;
+  virtual void transmitMessage(PooledDocument message) = 0;
 
   virtual error_t enableOob(const Location& location) = 0;
+  virtual error_t getOobStatistics(OobStatistics& statistics) = 0;
 
+  void setDocumentPool(DocumentPool* document_pool);
   void setReceivedMessageCallback(ReceivedMessageCallback callback);
   void setTransmitErrorCallback(TransmitErrorCallback callback);
   void setReceiveErrorCallback(ReceiveErrorCallback callback);
   void setReceivedOobPacketCallback(ReceivedOobPacketCallback callback);
 
+  void setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout);
+  void setOobReceiveBufferSize(int size);
+  void setOobPacketVerification(bool enabled);
+  void setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder);
+
+protected:
+  Transport();
+
 protected:
+  DocumentPool* document_pool_;
+
+  oob_receive_mode_t oob_receive_mode_;
+  int busy_poll_timeout_;
+  int oob_receive_buffer_size_;
+  std::atomic<bool> verify_oob_packets_;
+  std::shared_ptr<FlightRecorder> flight_recorder_;
+
   ReceivedMessageCallback received_message_callback_;
   TransmitErrorCallback transmit_error_callback_;
   ReceiveErrorCallback receive_error_callback_;
@@ -1,6 +1,8 @@
 #ifndef LDCP_SDK_UTILITY_H_
 #define LDCP_SDK_UTILITY_H_
 
+#include "ldcp/data_types.h"
+
 #include <cinttypes>
 
 namespace ldcp_sdk
@@ -21,6 +23,20 @@ public:
     return checksum;
   }
 
+  static bool VerifyOobPacket(uint8_t* data, size_t length)
+  {
+    OobPacketHeader* oob_packet_header = reinterpret_cast<OobPacketHeader*>(data);
+
+    if (length < sizeof(OobPacketHeader) || oob_packet_header->signature != 0xFFFF)
+      return false;
+
+    uint16_t saved_checksum = oob_packet_header->checksum;
+    oob_packet_header->checksum = 0;
+    bool packet_valid = (CalculateCRC16(data, data + length) == saved_checksum);
+    oob_packet_header->checksum = saved_checksum;
+    return packet_valid;
+  }
+
   static int CalculateBase64EncodedLength(int src_len)
   {
     return (src_len + 2) / 3 * 4;
@@ -0,0 +1,212 @@
+#include "ldcp/angular_roi.h"
+#include "ldcp/scan_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static const double EPSILON = 1e-9;
+
+template <typename T>
+static void decodeBeams(const OobPacketHeader* oob_packet_header, int begin, int end, T* ranges, T* intensities)
+{
+  int block_length = oob_packet_header->block_length;
+  const uint16_t* source_ranges = reinterpret_cast<const uint16_t*>(oob_packet_header + 1);
+  for (int i = begin; i < end; i++)
+    ranges[i] = source_ranges[i];
+  if (!intensities)
+    return;
+  if (oob_packet_header->flags.payload_layout.intensity_width == INTENSITY_WIDTH_16BIT) {
+    const uint16_t* source_intensities = source_ranges + block_length;
+    for (int i = begin; i < end; i++)
+      intensities[i] = source_intensities[i];
+  }
+  else {
+    const uint8_t* source_intensities = reinterpret_cast<const uint8_t*>(source_ranges + block_length);
+    for (int i = begin; i < end; i++)
+      intensities[i] = source_intensities[i];
+  }
+}
+
+template <typename T>
+static void decodeBeams(const ScanBlock& scan_block, int begin, int end, T* ranges, T* intensities)
+{
+  const ScanBlock::BlockData& layer = scan_block.layers[0];
+  for (int i = begin; i < end; i++)
+    ranges[i] = (T)layer.ranges[i];
+  if (!intensities)
+    return;
+  int intensity_end = std::min(end, (int)layer.intensities.size());
+  for (int i = begin; i < intensity_end; i++)
+    intensities[i] = (T)layer.intensities[i];
+}
+
+template <typename Source, typename T>
+static void decodeBlockWithin(const std::vector<AngularRoi::BeamInterval>& beam_intervals, bool passthrough,
+                              const Source& source, int block_index, int block_length,
+                              T* ranges, T* intensities)
+{
+  if (passthrough) {
+    decodeBeams(source, 0, block_length, ranges, intensities);
+    return;
+  }
+
+  std::fill(ranges, ranges + block_length, 0);
+  if (intensities)
+    std::fill(intensities, intensities + block_length, 0);
+
+  int block_begin = block_index * block_length;
+  for (const AngularRoi::BeamInterval& interval : beam_intervals) {
+    int begin = std::max(interval.first - block_begin, 0);
+    int end = std::min(interval.second - block_begin, block_length);
+    if (begin < end)
+      decodeBeams(source, begin, end, ranges, intensities);
+  }
+}
+
+AngularRoi::AngularRoi()
+  : angular_fov_(ANGULAR_FOV_270DEG)
+  , beam_count_(0)
+{
+}
+
+void AngularRoi::addWindow(double start_angle, double end_angle)
+{
+  windows_.push_back(std::make_pair(start_angle, end_angle));
+  beam_count_ = 0;
+  beam_intervals_.clear();
+}
+
+void AngularRoi::clear()
+{
+  windows_.clear();
+  beam_count_ = 0;
+  beam_intervals_.clear();
+}
+
+bool AngularRoi::isEmpty() const
+{
+  return windows_.empty();
+}
+
+void AngularRoi::update(angular_fov_t angular_fov, scan_resolution_t resolution)
+{
+  update(angular_fov, ScanGeometry::beamCount(resolution, angular_fov));
+}
+
+void AngularRoi::update(angular_fov_t angular_fov, int beam_count)
+{
+  if (angular_fov == angular_fov_ && beam_count == beam_count_)
+    return;
+
+  angular_fov_ = angular_fov;
+  beam_count_ = beam_count;
+  beam_intervals_.clear();
+  if (beam_count <= 0)
+    return;
+
+  double increment = ScanGeometry::fieldOfView(angular_fov) / beam_count;
+  double start = ScanGeometry::startAngle(angular_fov);
+  int beams_per_revolution = (int)std::lround(2 * PI / increment);
+
+  std::vector<BeamInterval> intervals;
+  for (const std::pair<double, double>& window : windows_) {
+    double offset = window.first - start;
+    offset -= 2 * PI * std::floor(offset / (2 * PI));
+    // Windows that end before they start wrap around; a window of a full
+    // revolution or more covers every beam
+    double length = window.second - window.first;
+    if (length < 0)
+      length += 2 * PI * std::ceil(-length / (2 * PI));
+    length = std::min(length, 2 * PI);
+
+    int begin = (int)std::ceil(offset / increment - EPSILON);
+    int end = (int)std::floor((offset + length) / increment + EPSILON) + 1;
+    if (end - begin >= beams_per_revolution) {
+      intervals.push_back(BeamInterval(0, beam_count));
+      continue;
+    }
+    if (begin >= beams_per_revolution) {
+      begin -= beams_per_revolution;
+      end -= beams_per_revolution;
+    }
+    intervals.push_back(BeamInterval(begin, std::min(end, beams_per_revolution)));
+    if (end > beams_per_revolution)
+      intervals.push_back(BeamInterval(0, end - beams_per_revolution));
+  }
+
+  std::sort(intervals.begin(), intervals.end());
+  for (BeamInterval interval : intervals) {
+    interval.second = std::min(interval.second, beam_count);
+    if (interval.first >= interval.second)
+      continue;
+    if (!beam_intervals_.empty() && interval.first <= beam_intervals_.back().second)
+      beam_intervals_.back().second = std::max(beam_intervals_.back().second, interval.second);
+    else
+      beam_intervals_.push_back(interval);
+  }
+}
+
+const std::vector<AngularRoi::BeamInterval>& AngularRoi::beamIntervals() const
+{
+  return beam_intervals_;
+}
+
+bool AngularRoi::overlaps(int begin, int end) const
+{
+  if (windows_.empty())
+    return true;
+  for (const BeamInterval& interval : beam_intervals_) {
+    if (interval.first < end && begin < interval.second)
+      return true;
+  }
+  return false;
+}
+
+void AngularRoi::decodeBlock(const OobPacketHeader* oob_packet_header, int* ranges, int* intensities) const
+{
+  decodeBlockWithin(beam_intervals_, windows_.empty(), oob_packet_header,
+                    oob_packet_header->block_index, oob_packet_header->block_length, ranges, intensities);
+}
+
+void AngularRoi::decodeBlock(const OobPacketHeader* oob_packet_header, uint16_t* ranges, uint16_t* intensities) const
+{
+  decodeBlockWithin(beam_intervals_, windows_.empty(), oob_packet_header,
+                    oob_packet_header->block_index, oob_packet_header->block_length, ranges, intensities);
+}
+
+void AngularRoi::decodeBlock(const ScanBlock& scan_block, int* ranges, int* intensities) const
+{
+  decodeBlockWithin(beam_intervals_, windows_.empty(), scan_block,
+                    scan_block.block_index, scan_block.block_length, ranges, intensities);
+}
+
+void AngularRoi::decodeBlock(const ScanBlock& scan_block, uint16_t* ranges, uint16_t* intensities) const
+{
+  decodeBlockWithin(beam_intervals_, windows_.empty(), scan_block,
+                    scan_block.block_index, scan_block.block_length, ranges, intensities);
+}
+
+void AngularRoi::mask(ScanFrame& scan_frame)
+{
+  if (windows_.empty() || scan_frame.layers.empty())
+    return;
+
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  update(scan_frame.angular_fov, (int)ranges.size());
+
+  int begin = 0;
+  for (size_t i = 0; i <= beam_intervals_.size(); i++) {
+    int end = (i < beam_intervals_.size()) ? beam_intervals_[i].first : (int)ranges.size();
+    std::fill(ranges.begin() + begin, ranges.begin() + end, 0);
+    if (intensities.size() >= (size_t)end)
+      std::fill(intensities.begin() + begin, intensities.begin() + end, 0);
+    if (i < beam_intervals_.size())
+      begin = beam_intervals_[i].second;
+  }
+}
+
+}
@@ -0,0 +1,175 @@
+#include "ldcp/background_model.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+BackgroundModel::BackgroundModel()
+  : learning_frames_(50)
+  , background_rate_(0.01f)
+  , foreground_rate_(0)
+  , min_difference_(100)
+  , sigma_factor_(3)
+  , min_beam_count_(3)
+  , max_gap_(2)
+  , beam_count_(0)
+  , frame_count_(0)
+{
+}
+
+void BackgroundModel::setLearningFrames(int count)
+{
+  learning_frames_ = std::max(count, 1);
+}
+
+void BackgroundModel::setAdaptationRates(float background_rate, float foreground_rate)
+{
+  background_rate_ = background_rate;
+  foreground_rate_ = foreground_rate;
+}
+
+void BackgroundModel::setThreshold(int min_difference, float sigma_factor)
+{
+  min_difference_ = min_difference;
+  sigma_factor_ = sigma_factor;
+}
+
+void BackgroundModel::setSegmentation(int min_beam_count, int max_gap)
+{
+  min_beam_count_ = std::max(min_beam_count, 1);
+  max_gap_ = std::max(max_gap, 0);
+}
+
+void BackgroundModel::reset()
+{
+  frame_count_ = 0;
+  std::fill(means_.begin(), means_.end(), 0.0f);
+  std::fill(variances_.begin(), variances_.end(), 0.0f);
+  std::fill(sample_counts_.begin(), sample_counts_.end(), 0);
+  std::fill(foreground_mask_.begin(), foreground_mask_.end(), 0);
+}
+
+bool BackgroundModel::isLearned() const
+{
+  return frame_count_ >= learning_frames_;
+}
+
+void BackgroundModel::process(const ScanFrame& scan_frame, std::vector<ForegroundSegment>& segments)
+{
+  segments.clear();
+  if (scan_frame.layers.empty())
+    return;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  if (beam_count != beam_count_) {
+    beam_count_ = beam_count;
+    means_.resize(beam_count);
+    variances_.resize(beam_count);
+    sample_counts_.resize(beam_count);
+    foreground_mask_.resize(beam_count);
+    reset();
+  }
+
+  if (!isLearned()) {
+    learn(ranges.data());
+    frame_count_++;
+    return;
+  }
+
+  classify(ranges.data());
+  segment(ranges.data(), segments);
+}
+
+void BackgroundModel::learn(const int* ranges)
+{
+  float* means = means_.data();
+  float* variances = variances_.data();
+  uint16_t* sample_counts = sample_counts_.data();
+  const int beam_count = beam_count_;
+  for (int i = 0; i < beam_count; i++) {
+    int valid = ranges[i] > 0;
+    sample_counts[i] += (uint16_t)valid;
+    float weight = valid / std::max((float)sample_counts[i], 1.0f);
+    float delta = ranges[i] - means[i];
+    means[i] += weight * delta;
+    variances[i] += weight * (delta * (ranges[i] - means[i]) - variances[i]);
+  }
+}
+
+void BackgroundModel::classify(const int* ranges)
+{
+  float* means = means_.data();
+  float* variances = variances_.data();
+  uint16_t* sample_counts = sample_counts_.data();
+  uint8_t* foreground_mask = foreground_mask_.data();
+  const float min_difference = (float)min_difference_;
+  const float sigma_factor_squared = sigma_factor_ * sigma_factor_;
+  const float background_rate = background_rate_, foreground_rate = foreground_rate_;
+  const int learning_frames = std::min(learning_frames_, (int)UINT16_MAX);
+  const int beam_count = beam_count_;
+  for (int i = 0; i < beam_count; i++) {
+    float range = (float)ranges[i];
+    bool valid = ranges[i] > 0;
+    bool open = sample_counts[i] == 0;
+    float difference = std::abs(means[i] - range);
+    bool changed = (difference > min_difference) & (difference * difference > sigma_factor_squared * variances[i]);
+    bool foreground = valid & (open | changed);
+    foreground_mask[i] = foreground;
+
+    // Open beams take their first return as background. Beams short of a
+    // full learning phase of samples, such as those, average further ones
+    // the way learn() does before settling to the adaptation rate
+    float rate = valid ? (open ? 1.0f : (foreground ? foreground_rate : background_rate)) : 0.0f;
+    if (rate > 0.0f && sample_counts[i] < learning_frames) {
+      sample_counts[i]++;
+      rate = std::max(rate, 1.0f / sample_counts[i]);
+    }
+    float delta = range - means[i];
+    means[i] += rate * delta;
+    variances[i] += rate * (delta * (range - means[i]) - variances[i]);
+  }
+}
+
+void BackgroundModel::segment(const int* ranges, std::vector<ForegroundSegment>& segments)
+{
+  const uint8_t* foreground_mask = foreground_mask_.data();
+  ForegroundSegment current = ForegroundSegment();
+  double range_sum = 0;
+  int last = -1;
+  for (int i = 0; i <= beam_count_; i++) {
+    if (i < beam_count_ && !foreground_mask[i])
+      continue;
+
+    if (last >= 0 && (i == beam_count_ || i - last - 1 > max_gap_)) {
+      if (current.beam_count >= min_beam_count_) {
+        current.end = last + 1;
+        current.mean_range = (float)(range_sum / current.beam_count);
+        segments.push_back(current);
+      }
+      last = -1;
+    }
+    if (i == beam_count_)
+      break;
+
+    if (last < 0) {
+      current.begin = i;
+      current.beam_count = 0;
+      current.min_range = ranges[i];
+      range_sum = 0;
+    }
+    current.beam_count++;
+    current.min_range = std::min(current.min_range, ranges[i]);
+    range_sum += ranges[i];
+    last = i;
+  }
+}
+
+const std::vector<uint8_t>& BackgroundModel::foregroundMask() const
+{
+  return foreground_mask_;
+}
+
+}
@@ -0,0 +1,117 @@
+#include "ldcp/block_monitor.h"
+#include "ldcp/scan_geometry.h"
+#include "ldcp/thread_config.h"
+
+#include <chrono>
+
+namespace ldcp_sdk
+{
+
+BlockMonitor::BlockMonitor(Device& device)
+  : device_(device)
+  , running_(false)
+{
+}
+
+BlockMonitor::~BlockMonitor()
+{
+  stop();
+}
+
+error_t BlockMonitor::addBlockCallback(BlockCallback callback)
+{
+  if (running_)
+    return error_t::not_supported;
+  block_callbacks_.push_back(callback);
+  return error_t::no_error;
+}
+
+void BlockMonitor::setProtectiveField(const ProtectiveField& field, FieldCallback callback)
+{
+  std::lock_guard<std::mutex> lock(field_mutex_);
+  field_ = field;
+  field_callback_ = callback;
+}
+
+void BlockMonitor::start()
+{
+  if (running_)
+    return;
+
+  running_ = true;
+  thread_ = ThreadManager::instance().createThread(THREAD_ROLE_PROCESSING, "ldcp-block", [this]() {
+    monitorLoop();
+  });
+}
+
+void BlockMonitor::stop()
+{
+  running_ = false;
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void BlockMonitor::monitorLoop()
+{
+  ScanBlock scan_block, no_block = ScanBlock();
+  ScanGeometry geometry;
+
+  while (running_) {
+    error_t result = device_.readScanBlock(scan_block);
+    if (result != error_t::no_error) {
+      reportFault(result, no_block);
+      // Only timeouts wait by themselves
+      if (result != error_t::timed_out)
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)FAULT_RETRY_INTERVAL));
+      continue;
+    }
+    if (scan_block.block_count <= 0 || scan_block.block_length <= 0 ||
+        scan_block.block_index < 0 || scan_block.block_index >= scan_block.block_count ||
+        scan_block.layers.empty() || scan_block.layers[0].ranges.size() < (size_t)scan_block.block_length) {
+      reportFault(error_t::protocol_error, scan_block);
+      continue;
+    }
+
+    FieldCallback field_callback;
+    uint32_t violated_zones = 0;
+    error_t status = error_t::no_error;
+    {
+      std::lock_guard<std::mutex> lock(field_mutex_);
+      if (field_callback_) {
+        status = field_.evaluate(scan_block);
+        if (status == error_t::no_error && !field_.isComplete())
+          status = error_t::timed_out;
+        violated_zones = (status == error_t::no_error) ? field_.violatedZones() : field_.zoneMask();
+        field_callback = field_callback_;
+      }
+    }
+    if (field_callback)
+      field_callback(violated_zones, status, scan_block);
+
+    geometry.update(scan_block.angular_fov, scan_block.block_count * scan_block.block_length);
+    BlockSpan span;
+    span.beam_offset = scan_block.block_index * scan_block.block_length;
+    span.beam_count = scan_block.block_length;
+    span.start_angle = geometry.angle(span.beam_offset);
+    span.end_angle = geometry.angle(span.beam_offset + span.beam_count - 1);
+    for (BlockCallback& callback : block_callbacks_)
+      callback(scan_block, span);
+  }
+}
+
+// Whatever the field knew is no longer current after a fault
+void BlockMonitor::reportFault(error_t status, const ScanBlock& scan_block)
+{
+  FieldCallback field_callback;
+  uint32_t violated_zones;
+  {
+    std::lock_guard<std::mutex> lock(field_mutex_);
+    field_.reset();
+    violated_zones = field_.zoneMask();
+    field_callback = field_callback_;
+  }
+  if (field_callback)
+    field_callback(violated_zones, status, scan_block);
+}
+
+}
@@ -17,7 +17,7 @@ Bootloader::Bootloader(DeviceBase&& other)
 
 error_t Bootloader::beginUpdate()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("firmware/beginUpdate");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
@@ -29,7 +29,7 @@ error_t Bootloader::writeData(const uint8_t content[], int length)
   encoded.resize(Utility::CalculateBase64EncodedLength(length));
   Utility::Base64Encode(content, length, &encoded[0]);
 
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("firmware/writeData");
   request.AddMember("params",
@@ -44,7 +44,7 @@ error_t Bootloader::writeData(const uint8_t content[], int length)
 
 error_t Bootloader::endUpdate()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("firmware/endUpdate");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
@@ -56,7 +56,7 @@ error_t Bootloader::verifyHash(const uint8_t expected[], bool& passed)
   encoded.resize(Utility::CalculateBase64EncodedLength(HASH_LENGTH));
   Utility::Base64Encode(expected, HASH_LENGTH, &encoded[0]);
 
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("firmware/verifyHash");
   request.AddMember("params",
@@ -73,7 +73,7 @@ error_t Bootloader::verifyHash(const uint8_t expected[], bool& passed)
 
 error_t Bootloader::commitUpdate()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("firmware/commitUpdate");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
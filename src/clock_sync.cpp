@@ -0,0 +1,190 @@
+#include "ldcp/clock_sync.h"
+#include "ldcp/thread_config.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+namespace ldcp_sdk
+{
+
+ClockSync::ClockSync(SampleFunction sample_function)
+  : sample_function_(sample_function)
+  , running_(false)
+  , last_device_timestamp_(0)
+  , synchronized_(false)
+  , reference_device_timestamp_(0)
+  , reference_host_time_(0)
+  , tick_period_(0)
+  , round_trip_time_(0)
+{
+}
+
+ClockSync::~ClockSync()
+{
+  stop();
+}
+
+void ClockSync::start(int interval)
+{
+  if (isRunning())
+    return;
+
+  running_ = true;
+  thread_ = ThreadManager::instance().createThread(THREAD_ROLE_BACKGROUND, "ldcp-clocksync", [this, interval]() {
+    int sample_count = 0;
+    std::unique_lock<std::mutex> lock(thread_mutex_);
+    while (running_) {
+      lock.unlock();
+      if (sample() == error_t::no_error)
+        sample_count++;
+      lock.lock();
+
+      int wait_time = (sample_count < WARM_UP_SAMPLES) ? WARM_UP_INTERVAL : interval;
+      thread_cv_.wait_for(lock, std::chrono::milliseconds(wait_time), [this]() {
+        return !running_;
+      });
+    }
+  });
+}
+
+void ClockSync::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    running_ = false;
+  }
+  thread_cv_.notify_one();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+bool ClockSync::isRunning() const
+{
+  return thread_.joinable();
+}
+
+error_t ClockSync::sample()
+{
+  uint32_t device_timestamp = 0;
+
+  int64_t request_time = hostTime();
+  error_t result = sample_function_(device_timestamp);
+  int64_t response_time = hostTime();
+
+  if (result == error_t::no_error) {
+    int64_t round_trip_time = response_time - request_time;
+    addSample(device_timestamp, request_time + round_trip_time / 2, round_trip_time);
+  }
+
+  return result;
+}
+
+void ClockSync::reset()
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  samples_.clear();
+  synchronized_ = false;
+}
+
+bool ClockSync::isSynchronized() const
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  return synchronized_;
+}
+
+int64_t ClockSync::toHostTime(uint32_t device_timestamp) const
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  if (!synchronized_)
+    return 0;
+  int32_t elapsed_ticks = (int32_t)(device_timestamp - reference_device_timestamp_);
+  return (int64_t)std::llround(reference_host_time_ + tick_period_ * elapsed_ticks);
+}
+
+double ClockSync::tickPeriod() const
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  return tick_period_;
+}
+
+int64_t ClockSync::roundTripTime() const
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+  return round_trip_time_;
+}
+
+int64_t ClockSync::hostTime()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ClockSync::addSample(uint32_t device_timestamp, int64_t host_time, int64_t round_trip_time)
+{
+  std::lock_guard<std::mutex> lock(estimate_mutex_);
+
+  if (synchronized_) {
+    int32_t elapsed_ticks = (int32_t)(device_timestamp - reference_device_timestamp_);
+    double predicted_host_time = reference_host_time_ + tick_period_ * elapsed_ticks;
+    if (std::fabs(predicted_host_time - host_time) > DISCONTINUITY_THRESHOLD + round_trip_time) {
+      samples_.clear();
+      synchronized_ = false;
+    }
+  }
+
+  Sample sample;
+  sample.device_ticks = samples_.empty() ?
+    device_timestamp : samples_.back().device_ticks + (uint32_t)(device_timestamp - last_device_timestamp_);
+  sample.host_time = host_time;
+  sample.round_trip_time = round_trip_time;
+
+  samples_.push_back(sample);
+  if (samples_.size() > WINDOW_SIZE)
+    samples_.pop_front();
+  last_device_timestamp_ = device_timestamp;
+  round_trip_time_ = round_trip_time;
+
+  fit();
+}
+
+void ClockSync::fit()
+{
+  int64_t min_round_trip_time = samples_.front().round_trip_time;
+  for (const Sample& sample : samples_)
+    min_round_trip_time = std::min(min_round_trip_time, sample.round_trip_time);
+
+  const Sample& latest = samples_.back();
+
+  int count = 0;
+  double sum_x = 0, sum_y = 0;
+  for (const Sample& sample : samples_) {
+    if (sample.round_trip_time <= 2 * min_round_trip_time) {
+      sum_x += (double)(sample.device_ticks - latest.device_ticks);
+      sum_y += (double)(sample.host_time - latest.host_time);
+      count++;
+    }
+  }
+  if (count < 2)
+    return;
+
+  double mean_x = sum_x / count, mean_y = sum_y / count;
+  double sum_xx = 0, sum_xy = 0;
+  for (const Sample& sample : samples_) {
+    if (sample.round_trip_time <= 2 * min_round_trip_time) {
+      double x = (double)(sample.device_ticks - latest.device_ticks) - mean_x;
+      double y = (double)(sample.host_time - latest.host_time) - mean_y;
+      sum_xx += x * x;
+      sum_xy += x * y;
+    }
+  }
+  if (sum_xx <= 0)
+    return;
+
+  tick_period_ = sum_xy / sum_xx;
+  reference_device_timestamp_ = last_device_timestamp_;
+  reference_host_time_ = (double)latest.host_time + mean_y - tick_period_ * mean_x;
+  synchronized_ = (tick_period_ > 0);
+}
+
+}
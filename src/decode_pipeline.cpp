@@ -0,0 +1,295 @@
+#include "ldcp/decode_pipeline.h"
+#include "ldcp/thread_config.h"
+#include "ldcp/utility.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace ldcp_sdk
+{
+
+DecodeStream::DecodeStream()
+  : pipeline_(nullptr)
+  , home_worker_(0)
+  , scheduled_(false)
+  , expected_block_index_(0)
+  , block_count_(0)
+  , block_length_(0)
+  , corrupted_packets_(0)
+  , dropped_packets_(0)
+  , dropped_frames_(0)
+{
+}
+
+DecodeStream::DecodeStream(DecodePipeline& pipeline)
+  : pipeline_(&pipeline)
+  , home_worker_(pipeline.next_home_worker_++ % pipeline.workerCount())
+  , scheduled_(false)
+  , expected_block_index_(0)
+  , block_count_(0)
+  , block_length_(0)
+  , corrupted_packets_(0)
+  , dropped_packets_(0)
+  , dropped_frames_(0)
+{
+}
+
+void DecodeStream::setAngularRoi(const AngularRoi& roi)
+{
+  std::lock_guard<std::mutex> lock(roi_mutex_);
+  roi_ = roi;
+}
+
+void DecodeStream::setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder)
+{
+  std::atomic_store(&flight_recorder_, flight_recorder);
+}
+
+void DecodeStream::submit(std::vector<uint8_t> oob_packet)
+{
+  if (!pipeline_) {
+    decodePacket(oob_packet);
+    return;
+  }
+
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(input_mutex_);
+    if (input_queue_.size() == INPUT_QUEUE_LENGTH) {
+      input_queue_.pop_front();
+      dropped_packets_++;
+    }
+    input_queue_.push_back(std::move(oob_packet));
+    if (!scheduled_) {
+      scheduled_ = true;
+      schedule = true;
+    }
+  }
+  if (schedule)
+    pipeline_->schedule(shared_from_this(), home_worker_);
+}
+
+error_t DecodeStream::readScanFrame(ScanFrame& scan_frame, int timeout)
+{
+  std::unique_lock<std::mutex> lock(output_mutex_);
+  bool wait_result = output_cv_.wait_for(lock, std::chrono::milliseconds(timeout), [this]() {
+    return !output_queue_.empty();
+  });
+  if (!wait_result)
+    return error_t::timed_out;
+
+  std::swap(scan_frame, output_queue_.front());
+  if (spare_frames_.size() < OUTPUT_QUEUE_LENGTH)
+    spare_frames_.push_back(std::move(output_queue_.front()));
+  output_queue_.pop_front();
+  return error_t::no_error;
+}
+
+uint64_t DecodeStream::corruptedPackets() const
+{
+  return corrupted_packets_;
+}
+
+uint64_t DecodeStream::droppedPackets() const
+{
+  return dropped_packets_;
+}
+
+uint64_t DecodeStream::droppedFrames() const
+{
+  return dropped_frames_;
+}
+
+bool DecodeStream::process()
+{
+  {
+    std::lock_guard<std::mutex> lock(input_mutex_);
+    while (!input_queue_.empty() && batch_.size() < BATCH_SIZE) {
+      batch_.push_back(std::move(input_queue_.front()));
+      input_queue_.pop_front();
+    }
+  }
+
+  for (std::vector<uint8_t>& oob_packet : batch_)
+    decodePacket(oob_packet);
+  batch_.clear();
+
+  std::lock_guard<std::mutex> lock(input_mutex_);
+  if (input_queue_.empty()) {
+    scheduled_ = false;
+    return false;
+  }
+  return true;
+}
+
+void DecodeStream::decodePacket(std::vector<uint8_t>& oob_packet)
+{
+  bool verified = Utility::VerifyOobPacket(oob_packet.data(), oob_packet.size());
+  std::shared_ptr<FlightRecorder> flight_recorder = std::atomic_load(&flight_recorder_);
+  if (flight_recorder)
+    flight_recorder->recordOobPacket(oob_packet.data(), oob_packet.size(), verified);
+  if (!verified) {
+    corrupted_packets_++;
+    return;
+  }
+
+  const OobPacketHeader* oob_packet_header = reinterpret_cast<const OobPacketHeader*>(oob_packet.data());
+  int block_index = oob_packet_header->block_index;
+  int block_count = (oob_packet_header->block_count != 0) ? oob_packet_header->block_count : 8;
+  int block_length = oob_packet_header->block_length;
+  bool wide_intensities = (oob_packet_header->flags.payload_layout.intensity_width == INTENSITY_WIDTH_16BIT);
+  if (oob_packet.size() < sizeof(OobPacketHeader) + block_length * (wide_intensities ? 4 : 3)) {
+    corrupted_packets_++;
+    return;
+  }
+
+  if (block_index != expected_block_index_ ||
+      (block_index > 0 && (block_count != block_count_ || block_length != block_length_))) {
+    expected_block_index_ = 0;
+    if (block_index != 0)
+      return;
+  }
+
+  if (block_index == 0) {
+    block_count_ = block_count;
+    block_length_ = block_length;
+    frame_.timestamp = oob_packet_header->timestamp;
+    frame_.host_timestamp = 0;
+    frame_.angular_fov = (oob_packet_header->flags.angular_fov == 0) ? ANGULAR_FOV_270DEG : ANGULAR_FOV_360DEG;
+    frame_.block_timestamps.resize(block_count);
+    frame_.block_host_timestamps.assign(block_count, 0);
+    frame_.layers.resize(1);
+    frame_.layers[0].ranges.resize(block_count * block_length);
+    frame_.layers[0].intensities.resize(block_count * block_length);
+  }
+
+  frame_.block_timestamps[block_index] = oob_packet_header->timestamp;
+
+  int* frame_ranges = &frame_.layers[0].ranges[block_index * block_length];
+  int* frame_intensities = &frame_.layers[0].intensities[block_index * block_length];
+  {
+    std::lock_guard<std::mutex> lock(roi_mutex_);
+    roi_.update(frame_.angular_fov, block_count * block_length);
+    if (roi_.overlaps(block_index * block_length, (block_index + 1) * block_length))
+      roi_.decodeBlock(oob_packet_header, frame_ranges, frame_intensities);
+    else {
+      std::fill(frame_ranges, frame_ranges + block_length, 0);
+      std::fill(frame_intensities, frame_intensities + block_length, 0);
+    }
+  }
+
+  if (++expected_block_index_ < block_count_)
+    return;
+  expected_block_index_ = 0;
+
+  std::lock_guard<std::mutex> lock(output_mutex_);
+  if (output_queue_.size() == OUTPUT_QUEUE_LENGTH) {
+    if (spare_frames_.size() < OUTPUT_QUEUE_LENGTH)
+      spare_frames_.push_back(std::move(output_queue_.front()));
+    output_queue_.pop_front();
+    dropped_frames_++;
+  }
+  output_queue_.push_back(std::move(frame_));
+  if (!spare_frames_.empty()) {
+    frame_ = std::move(spare_frames_.back());
+    spare_frames_.pop_back();
+  }
+  output_cv_.notify_one();
+}
+
+DecodePipeline::DecodePipeline(int worker_count)
+  : next_home_worker_(0)
+  , pending_streams_(0)
+  , running_(true)
+{
+  if (worker_count <= 0)
+    worker_count = std::max(1, (int)std::thread::hardware_concurrency());
+
+  for (int i = 0; i < worker_count; i++)
+    workers_.emplace_back(new Worker());
+  for (int i = 0; i < worker_count; i++) {
+    workers_[i]->thread = ThreadManager::instance().createThread(THREAD_ROLE_PROCESSING, "ldcp-decode", [this, i]() {
+      workerLoop(i);
+    });
+  }
+}
+
+DecodePipeline::~DecodePipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    running_ = false;
+  }
+  idle_cv_.notify_all();
+  for (std::unique_ptr<Worker>& worker : workers_)
+    worker->thread.join();
+}
+
+std::shared_ptr<DecodeStream> DecodePipeline::createStream()
+{
+  return std::make_shared<DecodeStream>(*this);
+}
+
+int DecodePipeline::workerCount() const
+{
+  return (int)workers_.size();
+}
+
+void DecodePipeline::schedule(std::shared_ptr<DecodeStream> stream, int worker_index)
+{
+  {
+    std::lock_guard<std::mutex> lock(workers_[worker_index]->mutex);
+    workers_[worker_index]->ready_streams.push_back(std::move(stream));
+  }
+  pending_streams_++;
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+  }
+  idle_cv_.notify_one();
+}
+
+std::shared_ptr<DecodeStream> DecodePipeline::take(int worker_index)
+{
+  std::shared_ptr<DecodeStream> stream;
+  int worker_count = (int)workers_.size();
+
+  // Own streams are taken oldest first for fairness, stolen ones newest first
+  for (int i = 0; i < worker_count && !stream; i++) {
+    Worker& worker = *workers_[(worker_index + i) % worker_count];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.ready_streams.empty())
+      continue;
+    if (i == 0) {
+      stream = std::move(worker.ready_streams.front());
+      worker.ready_streams.pop_front();
+    }
+    else {
+      stream = std::move(worker.ready_streams.back());
+      worker.ready_streams.pop_back();
+    }
+    pending_streams_--;
+  }
+
+  return stream;
+}
+
+void DecodePipeline::workerLoop(int worker_index)
+{
+  while (true) {
+    std::shared_ptr<DecodeStream> stream = take(worker_index);
+    if (!stream) {
+      std::unique_lock<std::mutex> lock(idle_mutex_);
+      idle_cv_.wait(lock, [this]() {
+        return !running_ || pending_streams_ > 0;
+      });
+      if (!running_)
+        return;
+      continue;
+    }
+
+    if (stream->process())
+      schedule(stream, worker_index);
+  }
+}
+
+}
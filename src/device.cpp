@@ -1,24 +1,212 @@
 #include "ldcp/device.h"
 #include "ldcp/session.h"
 #include "ldcp/utility.h"
+#include "ldcp/scan_geometry.h"
+#include "ldcp/trace.h"
 
 #include <asio.hpp>
 
+#include <algorithm>
+
 namespace ldcp_sdk
 {
 
+static void decodeNotification(const rapidjson::Document& notification, ScanBlock& scan_block)
+{
+  scan_block.block_index = notification["params"]["block"].GetInt();
+  scan_block.block_count = 8;
+  scan_block.timestamp = (uint32_t)notification["params"]["timestamp"].GetInt64();
+  scan_block.angular_fov = ANGULAR_FOV_270DEG;
+  scan_block.layers.resize(notification["params"]["layers"].Size());
+  for (size_t i = 0; i < scan_block.layers.size(); i++) {
+    const rapidjson::Value& layer = notification["params"]["layers"][i];
+    if (layer.IsNull())
+      continue;
+
+    std::vector<uint8_t> decode_buffer;
+    const rapidjson::Value& ranges = layer["ranges"];
+    if (!ranges.IsNull()) {
+      int byte_count = Utility::CalculateBase64DecodedLength(ranges.GetString(), ranges.GetStringLength());
+      if (decode_buffer.size() < byte_count)
+        decode_buffer.resize(byte_count);
+      Utility::Base64Decode(ranges.GetString(), ranges.GetStringLength(), &decode_buffer[0]);
+      scan_block.block_length = byte_count / sizeof(uint16_t);
+      scan_block.layers[i].ranges.resize(scan_block.block_length);
+      for (int j = 0; j < scan_block.block_length; j++)
+        scan_block.layers[i].ranges[j] = ((uint16_t*)&decode_buffer[0])[j];
+    }
+    const rapidjson::Value& intensities = layer["intensities"];
+    if (!intensities.IsNull()) {
+      int byte_count = Utility::CalculateBase64DecodedLength(intensities.GetString(), intensities.GetStringLength());
+      if (decode_buffer.size() < byte_count)
+        decode_buffer.resize(byte_count);
+      Utility::Base64Decode(intensities.GetString(), intensities.GetStringLength(), &decode_buffer[0]);
+      scan_block.layers[i].intensities.resize(byte_count);
+      for (int j = 0; j < byte_count; j++)
+        scan_block.layers[i].intensities[j] = decode_buffer[j];
+    }
+  }
+}
+
+static void decodeOobPacketHeader(const OobPacketHeader* oob_packet_header, ScanBlock& scan_block)
+{
+  scan_block.block_index = oob_packet_header->block_index;
+  scan_block.block_count = (oob_packet_header->block_count != 0) ? oob_packet_header->block_count : 8;
+  scan_block.block_length = oob_packet_header->block_length;
+  scan_block.timestamp = oob_packet_header->timestamp;
+  scan_block.angular_fov = (oob_packet_header->flags.angular_fov == 0) ?
+    ANGULAR_FOV_270DEG : ANGULAR_FOV_360DEG;
+}
+
+// Frame layouts Device::assembleScanFrame can write into. reset() sizes the
+// destination for the frame starting with the given block, or reports that
+// it does not fit.
+class ScanFrameDestination
+{
+public:
+  typedef int value_type;
+
+  explicit ScanFrameDestination(ScanFrame& scan_frame)
+    : scan_frame_(scan_frame)
+  {
+  }
+
+  bool reset(const ScanBlock& scan_block, int64_t host_timestamp)
+  {
+    size_t beam_count = (size_t)scan_block.block_count * scan_block.block_length;
+    scan_frame_.timestamp = scan_block.timestamp;
+    scan_frame_.host_timestamp = host_timestamp;
+    scan_frame_.angular_fov = scan_block.angular_fov;
+    scan_frame_.block_timestamps.resize(scan_block.block_count);
+    scan_frame_.block_host_timestamps.resize(scan_block.block_count);
+    scan_frame_.layers.resize(1);
+    scan_frame_.layers[0].ranges.resize(beam_count);
+    scan_frame_.layers[0].intensities.resize(beam_count);
+    return true;
+  }
+
+  void setBlockTimestamp(int block_index, unsigned int timestamp, int64_t host_timestamp)
+  {
+    scan_frame_.block_timestamps[block_index] = timestamp;
+    scan_frame_.block_host_timestamps[block_index] = host_timestamp;
+  }
+
+  int* ranges(int offset)
+  {
+    return scan_frame_.layers[0].ranges.data() + offset;
+  }
+
+  int* intensities(int offset)
+  {
+    return scan_frame_.layers[0].intensities.data() + offset;
+  }
+
+private:
+  ScanFrame& scan_frame_;
+};
+
+class ScanFrameBufferDestination
+{
+public:
+  typedef uint16_t value_type;
+
+  explicit ScanFrameBufferDestination(ScanFrameBuffer& buffer)
+    : buffer_(buffer)
+  {
+  }
+
+  bool reset(const ScanBlock& scan_block, int64_t host_timestamp)
+  {
+    size_t beam_count = (size_t)scan_block.block_count * scan_block.block_length;
+    if (beam_count > buffer_.beam_capacity ||
+        ((buffer_.block_timestamps || buffer_.block_host_timestamps) &&
+         (size_t)scan_block.block_count > buffer_.block_capacity))
+      return false;
+
+    buffer_.timestamp = scan_block.timestamp;
+    buffer_.host_timestamp = host_timestamp;
+    buffer_.angular_fov = scan_block.angular_fov;
+    buffer_.beam_count = (int)beam_count;
+    buffer_.block_count = scan_block.block_count;
+    return true;
+  }
+
+  void setBlockTimestamp(int block_index, unsigned int timestamp, int64_t host_timestamp)
+  {
+    if (buffer_.block_timestamps)
+      buffer_.block_timestamps[block_index] = timestamp;
+    if (buffer_.block_host_timestamps)
+      buffer_.block_host_timestamps[block_index] = host_timestamp;
+  }
+
+  uint16_t* ranges(int offset)
+  {
+    return buffer_.ranges + offset;
+  }
+
+  uint16_t* intensities(int offset)
+  {
+    return buffer_.intensities ? buffer_.intensities + offset : nullptr;
+  }
+
+private:
+  ScanFrameBuffer& buffer_;
+};
+
+static bool copyScanFrame(const ScanFrame& scan_frame, ScanFrameBuffer& buffer)
+{
+  size_t beam_count = scan_frame.layers[0].ranges.size();
+  size_t block_count = scan_frame.block_timestamps.size();
+  if (beam_count > buffer.beam_capacity ||
+      ((buffer.block_timestamps || buffer.block_host_timestamps) && block_count > buffer.block_capacity))
+    return false;
+
+  buffer.timestamp = scan_frame.timestamp;
+  buffer.host_timestamp = scan_frame.host_timestamp;
+  buffer.angular_fov = scan_frame.angular_fov;
+  buffer.beam_count = (int)beam_count;
+  buffer.block_count = (int)block_count;
+  for (size_t i = 0; i < block_count; i++) {
+    if (buffer.block_timestamps)
+      buffer.block_timestamps[i] = scan_frame.block_timestamps[i];
+    if (buffer.block_host_timestamps)
+      buffer.block_host_timestamps[i] = scan_frame.block_host_timestamps[i];
+  }
+  const int* ranges = scan_frame.layers[0].ranges.data();
+  for (size_t i = 0; i < beam_count; i++)
+    buffer.ranges[i] = (uint16_t)ranges[i];
+  if (buffer.intensities) {
+    const int* intensities = scan_frame.layers[0].intensities.data();
+    for (size_t i = 0; i < beam_count; i++)
+      buffer.intensities[i] = (uint16_t)intensities[i];
+  }
+  return true;
+}
+
 Device::Device(const DeviceInfo& device_info)
   : DeviceBase(device_info)
+  , decode_pipeline_(nullptr)
+  , oob_receive_mode_(OOB_RECEIVE_MODE_REACTOR)
+  , roi_(std::make_shared<const AngularRoi>())
+  , oob_receive_buffer_size_(0)
 {
 }
 
 Device::Device(const Location& location)
   : DeviceBase(location)
+  , decode_pipeline_(nullptr)
+  , oob_receive_mode_(OOB_RECEIVE_MODE_REACTOR)
+  , roi_(std::make_shared<const AngularRoi>())
+  , oob_receive_buffer_size_(0)
 {
 }
 
 Device::Device(DeviceBase&& other)
   : DeviceBase(std::move(other))
+  , decode_pipeline_(nullptr)
+  , oob_receive_mode_(OOB_RECEIVE_MODE_REACTOR)
+  , roi_(std::make_shared<const AngularRoi>())
+  , oob_receive_buffer_size_(0)
 {
 }
 
@@ -30,6 +218,8 @@ error_t Device::open()
     if (isOobEnabled(oob_enabled) == error_t::no_error && oob_enabled) {
       in_port_t target_port = 0;
       if (getOobTargetPort(target_port) == error_t::no_error) {
+        session_->setOobReceiveBufferSize((oob_receive_buffer_size_ > 0) ?
+                                          oob_receive_buffer_size_ : estimateOobReceiveBufferSize());
         result = session_->enableOobTransport(NetworkLocation(htonl(INADDR_ANY), target_port));
         if (result != error_t::no_error)
           close();
@@ -43,9 +233,37 @@ error_t Device::open()
   return result;
 }
 
+int Device::estimateOobReceiveBufferSize()
+{
+  scan_resolution_t resolution;
+  angular_fov_t angular_fov;
+  int frequency = 0;
+  if (getScanResolution(resolution) != error_t::no_error ||
+      getAngularFov(angular_fov) != error_t::no_error ||
+      getScanFrequency(frequency) != error_t::no_error || frequency <= 0)
+    return 0;
+
+  int64_t bytes_per_frame = (int64_t)ScanGeometry::beamCount(resolution, angular_fov) * 2 * sizeof(uint16_t);
+  int64_t bytes_per_duration = bytes_per_frame * frequency * OOB_RECEIVE_BUFFER_DURATION / 1000;
+  return (int)std::min(std::max(2 * bytes_per_frame, bytes_per_duration), (int64_t)INT_MAX);
+}
+
+void Device::applyHostTimestamps(ScanFrame& scan_frame)
+{
+  scan_frame.host_timestamp = toHostTime(scan_frame.timestamp);
+  for (size_t i = 0; i < scan_frame.block_timestamps.size(); i++)
+    scan_frame.block_host_timestamps[i] = toHostTime(scan_frame.block_timestamps[i]);
+}
+
+void Device::close()
+{
+  stopClockSync();
+  DeviceBase::close();
+}
+
 error_t Device::queryModel(std::string& model)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -62,7 +280,7 @@ error_t Device::queryModel(std::string& model)
 
 error_t Device::querySerial(std::string& serial)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -79,7 +297,7 @@ error_t Device::querySerial(std::string& serial)
 
 error_t Device::queryFirmwareVersion(std::string& firmware_version)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -96,7 +314,7 @@ error_t Device::queryFirmwareVersion(std::string& firmware_version)
 
 error_t Device::queryHardwareVersion(std::string& hardware_version)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -113,7 +331,7 @@ error_t Device::queryHardwareVersion(std::string& hardware_version)
 
 error_t Device::queryState(std::string& state)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -130,7 +348,7 @@ error_t Device::queryState(std::string& state)
 
 error_t Device::queryMotorFrequency(double& motor_frequency)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -147,7 +365,7 @@ error_t Device::queryMotorFrequency(double& motor_frequency)
 
 error_t Device::readTimestamp(uint32_t& timestamp)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("device/readTimestamp");
   error_t result = session_->executeCommand(std::move(request), response);
   if (result == error_t::no_error)
@@ -157,15 +375,51 @@ error_t Device::readTimestamp(uint32_t& timestamp)
 
 error_t Device::resetTimestamp()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("device/resetTimestamp");
   error_t result = session_->executeCommand(std::move(request), response);
+  if (result == error_t::no_error && clock_sync_)
+    clock_sync_->reset();
   return result;
 }
 
+void Device::startClockSync(int interval)
+{
+  if (!clock_sync_) {
+    Session* session = session_.get();
+    clock_sync_.reset(new ClockSync([session](uint32_t& timestamp) -> error_t {
+      if (!session->isOpened())
+        return error_t::unknown;
+      PooledDocument request = session->createEmptyRequestObject(), response;
+      request["method"].SetString("device/readTimestamp");
+      error_t result = session->executeCommand(std::move(request), response);
+      if (result == error_t::no_error)
+        timestamp = (uint32_t)response["result"].GetInt64();
+      return result;
+    }));
+  }
+  clock_sync_->start(interval);
+}
+
+void Device::stopClockSync()
+{
+  if (clock_sync_)
+    clock_sync_->stop();
+}
+
+bool Device::isClockSynchronized() const
+{
+  return clock_sync_ && clock_sync_->isSynchronized();
+}
+
+int64_t Device::toHostTime(uint32_t timestamp) const
+{
+  return clock_sync_ ? clock_sync_->toHostTime(timestamp) : 0;
+}
+
 error_t Device::startMeasurement()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("scan/startMeasurement");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
@@ -173,7 +427,7 @@ error_t Device::startMeasurement()
 
 error_t Device::stopMeasurement()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("scan/stopMeasurement");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
@@ -181,7 +435,7 @@ error_t Device::stopMeasurement()
 
 error_t Device::startStreaming()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("scan/startStreaming");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
@@ -189,105 +443,207 @@ error_t Device::startStreaming()
 
 error_t Device::stopStreaming()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   request["method"].SetString("scan/stopStreaming");
   error_t result = session_->executeCommand(std::move(request), response);
   return result;
 }
 
+// Without a decode pipeline, busy-poll mode assembles frames on the polling
+// thread through a stream of its own, so blocks are not read one by one
+void Device::setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout)
+{
+  session_->setOobReceiveMode(mode, busy_poll_timeout);
+  oob_receive_mode_ = mode;
+  if (!decode_pipeline_)
+    setDecodeStream((mode == OOB_RECEIVE_MODE_BUSY_POLL) ? std::make_shared<DecodeStream>() : nullptr);
+}
+
+void Device::setOobReceiveBufferSize(int size)
+{
+  oob_receive_buffer_size_ = size;
+}
+
+error_t Device::getOobStatistics(OobStatistics& statistics)
+{
+  return session_->getOobStatistics(statistics);
+}
+
+void Device::setDecodePipeline(DecodePipeline* pipeline)
+{
+  decode_pipeline_ = pipeline;
+  if (pipeline)
+    setDecodeStream(pipeline->createStream());
+  else
+    setDecodeStream((oob_receive_mode_ == OOB_RECEIVE_MODE_BUSY_POLL) ? std::make_shared<DecodeStream>() : nullptr);
+}
+
+void Device::setDecodeStream(std::shared_ptr<DecodeStream> decode_stream)
+{
+  if (decode_stream) {
+    decode_stream->setAngularRoi(*roi_);
+    decode_stream->setFlightRecorder(flight_recorder_);
+  }
+  std::atomic_store(&decode_stream_, decode_stream);
+  session_->setDecodeStream(decode_stream);
+}
+
+void Device::setAngularRoi(const AngularRoi& roi)
+{
+  std::atomic_store(&roi_, std::make_shared<const AngularRoi>(roi));
+  if (decode_stream_)
+    decode_stream_->setAngularRoi(roi);
+}
+
+void Device::enableFlightRecorder(size_t capacity, int retention, const std::string& dump_directory)
+{
+  flight_recorder_ = std::make_shared<FlightRecorder>(capacity, retention);
+  if (!dump_directory.empty())
+    flight_recorder_->setDumpDirectory(dump_directory);
+  session_->setFlightRecorder(flight_recorder_);
+  if (decode_stream_)
+    decode_stream_->setFlightRecorder(flight_recorder_);
+}
+
+error_t Device::dumpFlightRecorder(const std::string& file_name)
+{
+  if (!flight_recorder_)
+    return error_t::not_supported;
+  return flight_recorder_->dump(file_name);
+}
+
 error_t Device::readScanFrame(ScanFrame& scan_frame)
 {
+  std::shared_ptr<DecodeStream> decode_stream = std::atomic_load(&decode_stream_);
+  if (decode_stream) {
+    error_t result = decode_stream->readScanFrame(scan_frame, session_->timeout());
+    if (result == error_t::no_error) {
+      applyHostTimestamps(scan_frame);
+      LDCP_TRACE(TRACE_EVENT_FRAME_COMPLETE, scan_frame.timestamp);
+    }
+    return result;
+  }
+
+  ScanFrameDestination destination(scan_frame);
+  return assembleScanFrame(destination);
+}
+
+error_t Device::readScanFrame(ScanFrameBuffer& buffer)
+{
+  if (!buffer.ranges)
+    return error_t::invalid_params;
+
+  // The pipeline's frame storage is swapped with pipeline_frame_ and
+  // recycled, so the only cost is the copy into the buffer
+  std::shared_ptr<DecodeStream> decode_stream = std::atomic_load(&decode_stream_);
+  if (decode_stream) {
+    error_t result = decode_stream->readScanFrame(pipeline_frame_, session_->timeout());
+    if (result != error_t::no_error)
+      return result;
+    applyHostTimestamps(pipeline_frame_);
+    if (!copyScanFrame(pipeline_frame_, buffer))
+      return error_t::invalid_params;
+    LDCP_TRACE(TRACE_EVENT_FRAME_COMPLETE, buffer.timestamp);
+    return error_t::no_error;
+  }
+
+  ScanFrameBufferDestination destination(buffer);
+  return assembleScanFrame(destination);
+}
+
+// Polls blocks until a complete frame has arrived in order and decodes each
+// one into the destination, which is a ScanFrameDestination or a
+// ScanFrameBufferDestination.
+template <class Destination>
+error_t Device::assembleScanFrame(Destination& destination)
+{
+  PooledDocument notification;
+  std::vector<uint8_t> oob_data;
   ScanBlock scan_block;
 
+  // The ROI is set from other threads, so each frame picks up the latest one
+  std::shared_ptr<const AngularRoi> roi = std::atomic_load(&roi_);
+  if (roi != frame_roi_source_) {
+    frame_roi_ = *roi;
+    frame_roi_source_ = roi;
+  }
+
+  unsigned int frame_timestamp = 0;
   int expected_block_index = 0;
   int block_count = INT_MAX, block_length = 0;
   while (expected_block_index < block_count) {
-    error_t result = readScanBlock(scan_block);
+    notification.SetNull();
+    oob_data.clear();
+    error_t result = session_->pollForScanBlock(notification, oob_data);
     if (result != error_t::no_error)
       return result;
 
+    const OobPacketHeader* oob_packet_header = nullptr;
+    if (!notification.IsNull())
+      decodeNotification(notification, scan_block);
+    else if (oob_data.size() > 0) {
+      oob_packet_header = reinterpret_cast<const OobPacketHeader*>(oob_data.data());
+      decodeOobPacketHeader(oob_packet_header, scan_block);
+    }
+    else
+      continue;
+
     if (scan_block.block_index != expected_block_index) {
       expected_block_index = 0;
       continue;
     }
-    else {
-      if (expected_block_index == 0) {
-        block_count = scan_block.block_count;
-        block_length = scan_block.block_length;
-
-        scan_frame.timestamp = scan_block.timestamp;
-        scan_frame.angular_fov = scan_block.angular_fov;
-        scan_frame.layers.resize(1);
-        scan_frame.layers[0].ranges.resize(block_count * block_length);
-        scan_frame.layers[0].intensities.resize(block_count * block_length);
-      }
 
-      for (int i = 0; i < block_length; i++) {
-        scan_frame.layers[0].ranges[expected_block_index * block_length + i] =
-            scan_block.layers[0].ranges[i];
-        scan_frame.layers[0].intensities[expected_block_index * block_length + i] =
-            scan_block.layers[0].intensities[i];
-      }
+    if (expected_block_index == 0) {
+      block_count = scan_block.block_count;
+      block_length = scan_block.block_length;
+      if (!destination.reset(scan_block, toHostTime(scan_block.timestamp)))
+        return error_t::invalid_params;
+      frame_timestamp = scan_block.timestamp;
+      frame_roi_.update(scan_block.angular_fov, block_count * block_length);
+    }
+    else if (scan_block.block_length != block_length) {
+      expected_block_index = 0;
+      continue;
+    }
+
+    destination.setBlockTimestamp(expected_block_index, scan_block.timestamp, toHostTime(scan_block.timestamp));
 
-      expected_block_index++;
+    typename Destination::value_type* ranges = destination.ranges(expected_block_index * block_length);
+    typename Destination::value_type* intensities = destination.intensities(expected_block_index * block_length);
+    if (!frame_roi_.overlaps(expected_block_index * block_length, (expected_block_index + 1) * block_length)) {
+      std::fill(ranges, ranges + block_length, 0);
+      if (intensities)
+        std::fill(intensities, intensities + block_length, 0);
     }
+    else if (oob_packet_header)
+      frame_roi_.decodeBlock(oob_packet_header, ranges, intensities);
+    else
+      frame_roi_.decodeBlock(scan_block, ranges, intensities);
+
+    LDCP_TRACE(TRACE_EVENT_BLOCK_DECODE, expected_block_index);
+    expected_block_index++;
   }
 
+  LDCP_TRACE(TRACE_EVENT_FRAME_COMPLETE, frame_timestamp);
   return error_t::no_error;
 }
 
 error_t Device::readScanBlock(ScanBlock& scan_block)
 {
-  rapidjson::Document notification;
+  if (std::atomic_load(&decode_stream_))
+    return error_t::not_supported;
+
+  PooledDocument notification;
   std::vector<uint8_t> oob_data;
   error_t result = session_->pollForScanBlock(notification, oob_data);
 
   if (result == error_t::no_error) {
-    if (!notification.IsNull()) {
-      scan_block.block_index = notification["params"]["block"].GetInt();
-      scan_block.block_count = 8;
-      scan_block.timestamp = (uint32_t)notification["params"]["timestamp"].GetInt64();
-      scan_block.angular_fov = ANGULAR_FOV_270DEG;
-      scan_block.layers.resize(notification["params"]["layers"].Size());
-      for (size_t i = 0; i < scan_block.layers.size(); i++) {
-        const rapidjson::Value& layer = notification["params"]["layers"][i];
-        if (layer.IsNull())
-          continue;
-
-        std::vector<uint8_t> decode_buffer;
-        const rapidjson::Value& ranges = layer["ranges"];
-        if (!ranges.IsNull()) {
-          int byte_count = Utility::CalculateBase64DecodedLength(ranges.GetString(), ranges.GetStringLength());
-          if (decode_buffer.size() < byte_count)
-            decode_buffer.resize(byte_count);
-          Utility::Base64Decode(ranges.GetString(), ranges.GetStringLength(), &decode_buffer[0]);
-          scan_block.block_length = byte_count / sizeof(uint16_t);
-          scan_block.layers[i].ranges.resize(scan_block.block_length);
-          for (int j = 0; j < scan_block.block_length; j++)
-            scan_block.layers[i].ranges[j] = ((uint16_t*)&decode_buffer[0])[j];
-        }
-        const rapidjson::Value& intensities = layer["intensities"];
-        if (!intensities.IsNull()) {
-          int byte_count = Utility::CalculateBase64DecodedLength(intensities.GetString(), intensities.GetStringLength());
-          if (decode_buffer.size() < byte_count)
-            decode_buffer.resize(byte_count);
-          Utility::Base64Decode(intensities.GetString(), intensities.GetStringLength(), &decode_buffer[0]);
-          scan_block.layers[i].intensities.resize(byte_count);
-          for (int j = 0; j < byte_count; j++)
-            scan_block.layers[i].intensities[j] = decode_buffer[j];
-        }
-      }
-    }
+    if (!notification.IsNull())
+      decodeNotification(notification, scan_block);
     else if (oob_data.size() > 0) {
       const OobPacketHeader* oob_packet_header = reinterpret_cast<const OobPacketHeader*>(
           oob_data.data());
-
-      scan_block.block_index = oob_packet_header->block_index;
-      scan_block.block_count = (oob_packet_header->block_count != 0) ? oob_packet_header->block_count : 8;
-      scan_block.block_length = oob_packet_header->block_length;
-      scan_block.timestamp = oob_packet_header->timestamp;
-      scan_block.angular_fov = (oob_packet_header->flags.angular_fov == 0) ?
-        ANGULAR_FOV_270DEG : ANGULAR_FOV_360DEG;
+      decodeOobPacketHeader(oob_packet_header, scan_block);
 
       scan_block.layers.resize(1);
       scan_block.layers[0].ranges.resize(oob_packet_header->block_length);
@@ -307,14 +663,67 @@ error_t Device::readScanBlock(ScanBlock& scan_block)
         }
       }
     }
+
+    scan_block.host_timestamp = toHostTime(scan_block.timestamp);
+    LDCP_TRACE(TRACE_EVENT_BLOCK_DECODE, scan_block.block_index);
   }
 
   return result;
 }
 
+error_t Device::readRawScanFrame(RawScanFrame& scan_frame)
+{
+  RawScanBlock scan_block;
+
+  scan_frame.blocks.clear();
+  int block_count = INT_MAX;
+  while ((int)scan_frame.blocks.size() < block_count) {
+    error_t result = readRawScanBlock(scan_block);
+    if (result != error_t::no_error)
+      return result;
+
+    int expected_block_index = (int)scan_frame.blocks.size();
+    if (scan_block.blockIndex() != expected_block_index ||
+        (expected_block_index > 0 && scan_block.blockLength() != scan_frame.blocks[0].blockLength())) {
+      scan_frame.blocks.clear();
+      block_count = INT_MAX;
+      continue;
+    }
+
+    if (expected_block_index == 0) {
+      block_count = scan_block.blockCount();
+      scan_frame.host_timestamp = scan_block.host_timestamp;
+    }
+    scan_frame.blocks.push_back(scan_block);
+  }
+
+  LDCP_TRACE(TRACE_EVENT_FRAME_COMPLETE, scan_frame.timestamp());
+  return error_t::no_error;
+}
+
+error_t Device::readRawScanBlock(RawScanBlock& scan_block)
+{
+  if (std::atomic_load(&decode_stream_))
+    return error_t::not_supported;
+
+  PooledDocument notification;
+  std::vector<uint8_t> oob_data;
+  error_t result = session_->pollForScanBlock(notification, oob_data);
+  if (result != error_t::no_error)
+    return result;
+  if (!notification.IsNull())
+    return error_t::not_supported;
+
+  scan_block = RawScanBlock(std::make_shared<const std::vector<uint8_t>>(std::move(oob_data)));
+  if (!scan_block.isValid())
+    return error_t::protocol_error;
+  scan_block.host_timestamp = toHostTime(scan_block.timestamp());
+  return error_t::no_error;
+}
+
 error_t Device::getUserMacAddress(uint8_t address[])
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -334,7 +743,7 @@ error_t Device::getUserMacAddress(uint8_t address[])
 
 error_t Device::getNetworkAddress(in_addr_t& address)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -351,7 +760,7 @@ error_t Device::getNetworkAddress(in_addr_t& address)
 
 error_t Device::getSubnetMask(in_addr_t& subnet)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -368,7 +777,7 @@ error_t Device::getSubnetMask(in_addr_t& subnet)
 
 error_t Device::getHostName(std::string& host_name)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -385,7 +794,7 @@ error_t Device::getHostName(std::string& host_name)
 
 error_t Device::getScanFrequency(int& frequency)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -402,7 +811,7 @@ error_t Device::getScanFrequency(int& frequency)
 
 error_t Device::isShadowFilterEnabled(bool& enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -418,7 +827,7 @@ error_t Device::isShadowFilterEnabled(bool& enabled)
 
 error_t Device::getShadowFilterStrength(int& strength)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -434,7 +843,7 @@ error_t Device::getShadowFilterStrength(int& strength)
 
 error_t Device::isOobEnabled(bool& enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -451,7 +860,7 @@ error_t Device::isOobEnabled(bool& enabled)
 
 error_t Device::getOobAutoStartStreaming(bool& enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -467,7 +876,7 @@ error_t Device::getOobAutoStartStreaming(bool& enabled)
 
 error_t Device::getOobTargetAddress(in_addr_t& address)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -484,7 +893,7 @@ error_t Device::getOobTargetAddress(in_addr_t& address)
 
 error_t Device::getOobTargetPort(in_port_t& port)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/get");
   request.AddMember("params",
@@ -501,7 +910,7 @@ error_t Device::getOobTargetPort(in_port_t& port)
 
 error_t Device::getScanResolution(scan_resolution_t& resolution)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request.AddMember("method", "settings/read", allocator);
   request.AddMember("params",
@@ -530,7 +939,7 @@ error_t Device::getScanResolution(scan_resolution_t& resolution)
 
 error_t Device::getAngularFov(angular_fov_t& angular_fov)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request.AddMember("method", "settings/read", allocator);
   request.AddMember("params",
@@ -558,7 +967,7 @@ error_t Device::setUserMacAddress(const uint8_t address[])
   std::snprintf(&value[0], value.length(), "%02X:%02X:%02X:%02X:%02X:%02X",
     address[0], address[1], address[2], address[3], address[4], address[5]);
 
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -575,7 +984,7 @@ error_t Device::setUserMacAddress(const uint8_t address[])
 
 error_t Device::setNetworkAddress(in_addr_t address)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -592,7 +1001,7 @@ error_t Device::setNetworkAddress(in_addr_t address)
 
 error_t Device::setSubnetMask(in_addr_t subnet)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -609,7 +1018,7 @@ error_t Device::setSubnetMask(in_addr_t subnet)
 
 error_t Device::setHostName(const std::string& host_name)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -626,7 +1035,7 @@ error_t Device::setHostName(const std::string& host_name)
 
 error_t Device::setScanFrequency(int frequency)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -642,7 +1051,7 @@ error_t Device::setScanFrequency(int frequency)
 
 error_t Device::setShadowFilterEnabled(bool enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -658,7 +1067,7 @@ error_t Device::setShadowFilterEnabled(bool enabled)
 
 error_t Device::setShadowFilterStrength(int strength)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -674,7 +1083,7 @@ error_t Device::setShadowFilterStrength(int strength)
 
 error_t Device::setOobEnabled(bool enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -690,7 +1099,7 @@ error_t Device::setOobEnabled(bool enabled)
 
 error_t Device::setOobAutoStartStreaming(bool enabled)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -706,7 +1115,7 @@ error_t Device::setOobAutoStartStreaming(bool enabled)
 
 error_t Device::setOobTargetAddress(in_addr_t address)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -723,7 +1132,7 @@ error_t Device::setOobTargetAddress(in_addr_t address)
 
 error_t Device::setOobTargetPort(in_port_t port)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/set");
   request.AddMember("params",
@@ -760,7 +1169,7 @@ error_t Device::setScanResolution(scan_resolution_t resolution)
       return error_t::not_supported;
   }
 
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request.AddMember("method", "settings/write", allocator);
   request.AddMember("params",
@@ -788,7 +1197,7 @@ error_t Device::setAngularFov(angular_fov_t angular_fov)
       return error_t::not_supported;
   }
 
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request.AddMember("method", "settings/write", allocator);
   request.AddMember("params",
@@ -804,7 +1213,7 @@ error_t Device::setAngularFov(angular_fov_t angular_fov)
 
 error_t Device::persistSettings()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("settings/persist");
 
@@ -815,7 +1224,7 @@ error_t Device::persistSettings()
 
 void Device::rebootToBootloader()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject();
+  PooledDocument request = session_->createEmptyRequestObject();
   request["method"].SetString("device/rebootToBootloader");
   session_->executeCommand(std::move(request));
 }
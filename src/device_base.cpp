@@ -55,7 +55,7 @@ void DeviceBase::close()
 
 error_t DeviceBase::queryOperationMode(std::string& mode)
 {
-  rapidjson::Document request = session_->createEmptyRequestObject(), response;
+  PooledDocument request = session_->createEmptyRequestObject(), response;
   rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
   request["method"].SetString("device/queryInfo");
   request.AddMember("params",
@@ -72,7 +72,7 @@ error_t DeviceBase::queryOperationMode(std::string& mode)
 
 void DeviceBase::reboot()
 {
-  rapidjson::Document request = session_->createEmptyRequestObject();
+  PooledDocument request = session_->createEmptyRequestObject();
   request["method"].SetString("device/reboot");
   session_->executeCommand(std::move(request));
 }
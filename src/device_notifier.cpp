@@ -1,4 +1,5 @@
 #include "ldcp/device_notifier.h"
+#include "ldcp/thread_config.h"
 
 #ifdef __linux__
 
@@ -74,7 +75,9 @@ FAIL_CLEAN_UP:
 
 void NetworkDeviceNotifierLinux::start()
 {
-  thread_ = std::thread([&]() { avahi_simple_poll_loop(simple_poll_); });
+  thread_ = ThreadManager::instance().createThread(THREAD_ROLE_BACKGROUND, "ldcp-discovery", [&]() {
+    avahi_simple_poll_loop(simple_poll_);
+  });
 }
 
 void NetworkDeviceNotifierLinux::stop()
@@ -218,7 +221,7 @@ bool NetworkDeviceNotifierWindows::init()
 
 void NetworkDeviceNotifierWindows::start()
 {
-  thread_ = std::thread([&]() {
+  thread_ = ThreadManager::instance().createThread(THREAD_ROLE_BACKGROUND, "ldcp-discovery", [&]() {
     active_flag_ = true;
     while (active_flag_) {
       FD_SET copyed_read_set_ = read_set_;
@@ -0,0 +1,155 @@
+#include "ldcp/document_pool.h"
+
+namespace ldcp_sdk
+{
+
+class DocumentArena
+{
+public:
+  explicit DocumentArena(size_t size);
+
+  rapidjson::Document::AllocatorType& allocator();
+  void recycle();
+
+private:
+  static const size_t INITIAL_SIZE = 4096;
+
+private:
+  size_t size_;
+  std::unique_ptr<char[]> buffer_;
+  rapidjson::CrtAllocator base_allocator_;
+  std::unique_ptr<rapidjson::Document::AllocatorType> allocator_;
+
+  friend class DocumentPool;
+};
+
+DocumentArena::DocumentArena(size_t size)
+  : size_(size)
+  , buffer_(new char[size])
+  , allocator_(new rapidjson::Document::AllocatorType(buffer_.get(), size, size, &base_allocator_))
+{
+}
+
+rapidjson::Document::AllocatorType& DocumentArena::allocator()
+{
+  return *allocator_;
+}
+
+void DocumentArena::recycle()
+{
+  size_t used = allocator_->Size();
+  if (allocator_->Capacity() > size_) {
+    while (size_ < 2 * used)
+      size_ *= 2;
+    allocator_.reset();
+    buffer_.reset(new char[size_]);
+    allocator_.reset(new rapidjson::Document::AllocatorType(buffer_.get(), size_, size_, &base_allocator_));
+  }
+  else
+    allocator_->Clear();
+}
+
+// Without an arena the document owns an allocator of its own, which moves
+// along with the document and only allocates chunks once values are added
+PooledDocument::PooledDocument()
+  : rapidjson::Document(rapidjson::kNullType)
+  , pool_(nullptr)
+  , arena_(nullptr)
+{
+}
+
+PooledDocument::PooledDocument(DocumentPool* pool, DocumentArena* arena)
+  : rapidjson::Document(rapidjson::kNullType, arena ? arenaAllocator(arena) : nullptr)
+  , pool_(pool)
+  , arena_(arena)
+{
+}
+
+PooledDocument::PooledDocument(PooledDocument&& other)
+  : rapidjson::Document(std::move(other))
+  , pool_(other.pool_)
+  , arena_(other.arena_)
+{
+  other.arena_ = nullptr;
+}
+
+PooledDocument::~PooledDocument()
+{
+  release();
+}
+
+PooledDocument& PooledDocument::operator=(PooledDocument&& other)
+{
+  if (this != &other) {
+    rapidjson::Document::operator=(std::move(other));
+    release();
+    pool_ = other.pool_;
+    arena_ = other.arena_;
+    other.arena_ = nullptr;
+  }
+  return *this;
+}
+
+void PooledDocument::release()
+{
+  if (arena_) {
+    pool_->release(arena_);
+    arena_ = nullptr;
+  }
+}
+
+rapidjson::Document::AllocatorType* PooledDocument::arenaAllocator(DocumentArena* arena)
+{
+  return &arena->allocator();
+}
+
+DocumentPool::DocumentPool()
+{
+  arenas_.reserve(ARENA_COUNT_MAX);
+  free_arenas_.reserve(ARENA_COUNT_MAX);
+}
+
+DocumentPool::~DocumentPool()
+{
+}
+
+PooledDocument DocumentPool::createDocument()
+{
+  return PooledDocument(this, acquire());
+}
+
+PooledDocument DocumentPool::createRequest()
+{
+  PooledDocument request = createDocument();
+  rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
+
+  request.SetObject()
+      .AddMember("jsonrpc", "2.0", allocator)
+      .AddMember("method", rapidjson::Value(), allocator);
+
+  return request;
+}
+
+DocumentArena* DocumentPool::acquire()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!free_arenas_.empty()) {
+    DocumentArena* arena = free_arenas_.back();
+    free_arenas_.pop_back();
+    return arena;
+  }
+  if (arenas_.size() < ARENA_COUNT_MAX) {
+    arenas_.emplace_back(new DocumentArena(DocumentArena::INITIAL_SIZE));
+    return arenas_.back().get();
+  }
+  return nullptr;
+}
+
+void DocumentPool::release(DocumentArena* arena)
+{
+  arena->recycle();
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_arenas_.push_back(arena);
+}
+
+}
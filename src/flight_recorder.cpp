@@ -0,0 +1,221 @@
+#include "ldcp/flight_recorder.h"
+#include "ldcp/clock_sync.h"
+#include "ldcp/data_types.h"
+#include "ldcp/thread_config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace ldcp_sdk
+{
+
+static const char FILE_SIGNATURE[8] = { 'L', 'D', 'C', 'P', 'F', 'R', 'E', 'C' };
+
+FlightRecorder::FlightRecorder(size_t capacity, int retention)
+  : ring_(capacity)
+  , retention_((int64_t)retention * 1000000)
+  , head_(0)
+  , tail_(0)
+  , crc_burst_threshold_(DEFAULT_CRC_BURST_THRESHOLD)
+  , crc_failures_(0)
+  , crc_window_start_(0)
+  , sequence_valid_(false)
+  , last_frame_index_(0)
+  , last_block_index_(0)
+  , last_block_count_(0)
+  , running_(false)
+  , pending_reason_(nullptr)
+  , last_dump_time_(0)
+  , anomaly_dumps_(0)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+  {
+    std::lock_guard<std::mutex> lock(dump_mutex_);
+    running_ = false;
+  }
+  dump_cv_.notify_one();
+  if (dump_thread_.joinable())
+    dump_thread_.join();
+}
+
+void FlightRecorder::setDumpDirectory(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(dump_mutex_);
+  dump_directory_ = directory;
+  if (!running_ && !directory.empty()) {
+    running_ = true;
+    dump_thread_ = ThreadManager::instance().createThread(THREAD_ROLE_BACKGROUND, "ldcp-recorder", [this]() {
+      dumpLoop();
+    });
+  }
+}
+
+void FlightRecorder::setCrcBurstThreshold(int threshold)
+{
+  crc_burst_threshold_ = threshold;
+}
+
+void FlightRecorder::record(flight_record_t type, const uint8_t* data, size_t length)
+{
+  write(ClockSync::hostTime(), type, data, length);
+}
+
+void FlightRecorder::recordOobPacket(const uint8_t* data, size_t length, bool verified)
+{
+  int64_t time = ClockSync::hostTime();
+  write(time, verified ? FLIGHT_RECORD_OOB_PACKET : FLIGHT_RECORD_OOB_PACKET_CORRUPTED, data, length);
+  detectAnomaly(time, data, length, verified);
+}
+
+error_t FlightRecorder::dump(const std::string& file_name)
+{
+  // Sized before locking so writers only wait for the copy itself
+  std::vector<uint8_t> snapshot(ring_.size());
+  size_t snapshot_size;
+  {
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    snapshot_size = (size_t)(head_ - tail_);
+    copyOut(tail_, snapshot.data(), snapshot_size);
+  }
+  snapshot.resize(snapshot_size);
+
+  std::ofstream stream(file_name, std::ios::binary);
+  if (!stream.is_open())
+    return error_t::invalid_params;
+  stream.write(FILE_SIGNATURE, sizeof(FILE_SIGNATURE));
+
+  int64_t oldest_time = ClockSync::hostTime() - retention_;
+  size_t offset = 0;
+  while (offset < snapshot.size()) {
+    RecordHeader header;
+    std::memcpy(&header, &snapshot[offset], sizeof(header));
+    size_t record_size = sizeof(header) + header.length;
+    if (header.time >= oldest_time)
+      stream.write(reinterpret_cast<const char*>(&snapshot[offset]), record_size);
+    offset += record_size;
+  }
+
+  return stream.good() ? error_t::no_error : error_t::unknown;
+}
+
+int FlightRecorder::anomalyDumpCount() const
+{
+  return anomaly_dumps_;
+}
+
+void FlightRecorder::write(int64_t time, flight_record_t type, const uint8_t* data, size_t length)
+{
+  size_t record_size = sizeof(RecordHeader) + length;
+  if (record_size > ring_.size())
+    return;
+
+  RecordHeader header;
+  header.time = time;
+  header.type = type;
+  header.length = (uint32_t)length;
+
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  while (head_ + record_size - tail_ > ring_.size()) {
+    RecordHeader oldest;
+    copyOut(tail_, &oldest, sizeof(oldest));
+    tail_ += sizeof(oldest) + oldest.length;
+  }
+  copyIn(head_, &header, sizeof(header));
+  copyIn(head_ + sizeof(header), data, length);
+  head_ += record_size;
+}
+
+void FlightRecorder::copyIn(uint64_t position, const void* source, size_t length)
+{
+  if (length == 0)
+    return;
+  size_t offset = (size_t)(position % ring_.size());
+  size_t first = std::min(length, ring_.size() - offset);
+  std::memcpy(&ring_[offset], source, first);
+  std::memcpy(&ring_[0], static_cast<const uint8_t*>(source) + first, length - first);
+}
+
+void FlightRecorder::copyOut(uint64_t position, void* destination, size_t length) const
+{
+  if (length == 0)
+    return;
+  size_t offset = (size_t)(position % ring_.size());
+  size_t first = std::min(length, ring_.size() - offset);
+  std::memcpy(destination, &ring_[offset], first);
+  std::memcpy(static_cast<uint8_t*>(destination) + first, &ring_[0], length - first);
+}
+
+void FlightRecorder::detectAnomaly(int64_t time, const uint8_t* data, size_t length, bool verified)
+{
+  std::lock_guard<std::mutex> lock(anomaly_mutex_);
+  if (!verified) {
+    if (time - crc_window_start_ > CRC_BURST_WINDOW) {
+      crc_window_start_ = time;
+      crc_failures_ = 0;
+    }
+    if (++crc_failures_ == crc_burst_threshold_)
+      requestDump("crc", time);
+    return;
+  }
+
+  if (length < sizeof(OobPacketHeader))
+    return;
+  const OobPacketHeader* oob_packet_header = reinterpret_cast<const OobPacketHeader*>(data);
+  int block_count = (oob_packet_header->block_count != 0) ? oob_packet_header->block_count : 8;
+
+  if (sequence_valid_) {
+    bool expected;
+    if (last_block_index_ + 1 < last_block_count_)
+      expected = (oob_packet_header->frame_index == last_frame_index_ &&
+                  oob_packet_header->block_index == last_block_index_ + 1);
+    else
+      expected = (oob_packet_header->frame_index == (uint16_t)(last_frame_index_ + 1) &&
+                  oob_packet_header->block_index == 0);
+    if (!expected)
+      requestDump("gap", time);
+  }
+
+  sequence_valid_ = true;
+  last_frame_index_ = oob_packet_header->frame_index;
+  last_block_index_ = oob_packet_header->block_index;
+  last_block_count_ = block_count;
+}
+
+void FlightRecorder::requestDump(const char* reason, int64_t time)
+{
+  std::lock_guard<std::mutex> lock(dump_mutex_);
+  if (!running_ || pending_reason_ || (last_dump_time_ != 0 && time - last_dump_time_ < retention_))
+    return;
+  pending_reason_ = reason;
+  last_dump_time_ = time;
+  dump_cv_.notify_one();
+}
+
+void FlightRecorder::dumpLoop()
+{
+  std::unique_lock<std::mutex> lock(dump_mutex_);
+  while (running_) {
+    dump_cv_.wait(lock, [this]() {
+      return !running_ || pending_reason_;
+    });
+    if (!pending_reason_)
+      continue;
+
+    int64_t wall_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string file_name = dump_directory_ + "/ldcp-flight-" + pending_reason_ + "-" +
+      std::to_string(wall_time) + ".rec";
+    lock.unlock();
+    if (dump(file_name) == error_t::no_error)
+      anomaly_dumps_++;
+    lock.lock();
+    pending_reason_ = nullptr;
+  }
+}
+
+}
@@ -0,0 +1,202 @@
+#include "ldcp/frame_synchronizer.h"
+#include "ldcp/thread_config.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace ldcp_sdk
+{
+
+FrameSynchronizer::FrameSynchronizer()
+  : tolerance_(DEFAULT_TOLERANCE)
+  , max_latency_(DEFAULT_MAX_LATENCY)
+  , running_(false)
+{
+}
+
+FrameSynchronizer::~FrameSynchronizer()
+{
+  stop();
+}
+
+int FrameSynchronizer::addDevice(Device& device, const Pose2D& extrinsics)
+{
+  std::unique_ptr<Sensor> sensor(new Sensor());
+  sensor->device = &device;
+  sensor->extrinsics = extrinsics;
+  sensors_.push_back(std::move(sensor));
+  return (int)sensors_.size() - 1;
+}
+
+void FrameSynchronizer::setTolerance(int64_t tolerance)
+{
+  tolerance_ = tolerance;
+}
+
+void FrameSynchronizer::setMaxLatency(int64_t max_latency)
+{
+  max_latency_ = max_latency;
+}
+
+void FrameSynchronizer::setMergedCloudCallback(MergedCloudCallback callback)
+{
+  callback_ = callback;
+}
+
+void FrameSynchronizer::start()
+{
+  if (running_)
+    return;
+
+  running_ = true;
+  for (std::unique_ptr<Sensor>& sensor : sensors_) {
+    Sensor* target = sensor.get();
+    sensor->thread = ThreadManager::instance().createThread(THREAD_ROLE_PROCESSING, "ldcp-sync", [this, target]() {
+      sensorLoop(*target);
+    });
+  }
+}
+
+void FrameSynchronizer::stop()
+{
+  running_ = false;
+  for (std::unique_ptr<Sensor>& sensor : sensors_) {
+    if (sensor->thread.joinable())
+      sensor->thread.join();
+    sensor->clouds.clear();
+  }
+}
+
+void FrameSynchronizer::sensorLoop(Sensor& sensor)
+{
+  ScanFrame scan_frame;
+  PointCloud merged_cloud;
+
+  while (running_) {
+    if (sensor.device->readScanFrame(scan_frame) != error_t::no_error)
+      continue;
+
+    PointCloud point_cloud;
+    convert(sensor, scan_frame, point_cloud);
+
+    bool ready = false;
+    std::unique_lock<std::mutex> callback_lock(callback_mutex_, std::defer_lock);
+    {
+      std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+      sensor.clouds.push_back(std::move(point_cloud));
+      if (sensor.clouds.size() > QUEUE_LENGTH_MAX)
+        sensor.clouds.pop_front();
+      ready = collectSet(ClockSync::hostTime(), merged_cloud);
+      if (ready)
+        callback_lock.lock();
+    }
+    if (ready && callback_)
+      callback_(merged_cloud);
+  }
+}
+
+void FrameSynchronizer::convert(Sensor& sensor, const ScanFrame& scan_frame, PointCloud& point_cloud)
+{
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  const std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  int beam_count = (int)ranges.size();
+
+  if (sensor.geometry.beamCount() != beam_count || sensor.geometry.angularFov() != scan_frame.angular_fov ||
+      (int)sensor.cosines.size() != beam_count) {
+    sensor.geometry.update(scan_frame.angular_fov, beam_count);
+    float yaw_cos = (float)std::cos(sensor.extrinsics.theta), yaw_sin = (float)std::sin(sensor.extrinsics.theta);
+    sensor.cosines.resize(beam_count);
+    sensor.sines.resize(beam_count);
+    const float* c = sensor.geometry.cosines();
+    const float* s = sensor.geometry.sines();
+    for (int i = 0; i < beam_count; i++) {
+      sensor.cosines[i] = c[i] * yaw_cos - s[i] * yaw_sin;
+      sensor.sines[i] = s[i] * yaw_cos + c[i] * yaw_sin;
+    }
+  }
+
+  point_cloud.host_timestamp = (scan_frame.host_timestamp != 0) ?
+    scan_frame.host_timestamp : ClockSync::hostTime();
+  point_cloud.x.resize(beam_count);
+  point_cloud.y.resize(beam_count);
+  point_cloud.intensities.resize(beam_count);
+
+  const float tx = (float)sensor.extrinsics.x, ty = (float)sensor.extrinsics.y;
+  const float* c = sensor.cosines.data();
+  const float* s = sensor.sines.data();
+  int valid_count = 0;
+  for (int i = 0; i < beam_count; i++) {
+    if (ranges[i] > 0) {
+      float range = ranges[i] * ScanGeometry::RANGE_SCALE;
+      point_cloud.x[valid_count] = range * c[i] + tx;
+      point_cloud.y[valid_count] = range * s[i] + ty;
+      point_cloud.intensities[valid_count] = intensities[i];
+      valid_count++;
+    }
+  }
+  point_cloud.x.resize(valid_count);
+  point_cloud.y.resize(valid_count);
+  point_cloud.intensities.resize(valid_count);
+}
+
+bool FrameSynchronizer::collectSet(int64_t now, PointCloud& merged_cloud)
+{
+  // Drop frames too old to pair with the newest front until the fronts of
+  // all sensors agree; a partial set is only emitted once the oldest front
+  // has waited longer than the latency bound.
+  int64_t lower, upper;
+  for (;;) {
+    bool complete = true;
+    int64_t oldest = INT64_MAX, newest = INT64_MIN;
+    for (std::unique_ptr<Sensor>& sensor : sensors_) {
+      if (sensor->clouds.empty())
+        complete = false;
+      else {
+        oldest = std::min(oldest, sensor->clouds.front().host_timestamp);
+        newest = std::max(newest, sensor->clouds.front().host_timestamp);
+      }
+    }
+
+    if (complete) {
+      bool popped = false;
+      for (std::unique_ptr<Sensor>& sensor : sensors_) {
+        while (!sensor->clouds.empty() && sensor->clouds.front().host_timestamp < newest - tolerance_) {
+          sensor->clouds.pop_front();
+          popped = true;
+        }
+      }
+      if (popped)
+        continue;
+      lower = newest - tolerance_;
+      upper = newest;
+    }
+    else if (oldest != INT64_MAX && now - oldest > max_latency_) {
+      lower = oldest;
+      upper = oldest + tolerance_;
+    }
+    else
+      return false;
+    break;
+  }
+
+  merged_cloud.host_timestamp = INT64_MAX;
+  merged_cloud.x.clear();
+  merged_cloud.y.clear();
+  merged_cloud.intensities.clear();
+  for (std::unique_ptr<Sensor>& sensor : sensors_) {
+    if (sensor->clouds.empty() || sensor->clouds.front().host_timestamp < lower ||
+        sensor->clouds.front().host_timestamp > upper)
+      continue;
+    const PointCloud& point_cloud = sensor->clouds.front();
+    merged_cloud.host_timestamp = std::min(merged_cloud.host_timestamp, point_cloud.host_timestamp);
+    merged_cloud.x.insert(merged_cloud.x.end(), point_cloud.x.begin(), point_cloud.x.end());
+    merged_cloud.y.insert(merged_cloud.y.end(), point_cloud.y.begin(), point_cloud.y.end());
+    merged_cloud.intensities.insert(merged_cloud.intensities.end(),
+                                    point_cloud.intensities.begin(), point_cloud.intensities.end());
+    sensor->clouds.pop_front();
+  }
+
+  return true;
+}
+
+}
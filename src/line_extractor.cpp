@@ -0,0 +1,299 @@
+#include "ldcp/line_extractor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static float angleDifference(float a, float b)
+{
+  float difference = std::fabs(a - b);
+  difference -= (float)(2 * PI) * std::floor(difference / (float)(2 * PI));
+  return std::min(difference, (float)(2 * PI) - difference);
+}
+
+LineExtractor::LineExtractor()
+  : split_distance_(0.03f)
+  , merge_angle_(0.05f)
+  , merge_distance_(0.03f)
+  , min_point_count_(8)
+  , min_length_(0.1f)
+  , corner_angle_(0.5f)
+  , corner_distance_(0.1f)
+  , range_sigma_(0.01f)
+{
+}
+
+ScanSegmenter& LineExtractor::segmenter()
+{
+  return segmenter_;
+}
+
+void LineExtractor::setSplitDistance(float distance)
+{
+  split_distance_ = distance;
+}
+
+void LineExtractor::setMergeTolerance(float angle, float distance)
+{
+  merge_angle_ = angle;
+  merge_distance_ = distance;
+}
+
+void LineExtractor::setMinLineSize(int point_count, float length)
+{
+  min_point_count_ = std::max(point_count, 2);
+  min_length_ = length;
+}
+
+void LineExtractor::setCornerThreshold(float min_angle, float max_distance)
+{
+  corner_angle_ = min_angle;
+  corner_distance_ = max_distance;
+}
+
+void LineExtractor::setRangeSigma(float sigma)
+{
+  range_sigma_ = sigma;
+}
+
+void LineExtractor::process(const ScanFrame& scan_frame, std::vector<LineFeature>& lines,
+                            std::vector<CornerFeature>& corners)
+{
+  lines.clear();
+  corners.clear();
+  segmenter_.process(scan_frame, segments_);
+  collectPoints(scan_frame);
+
+  // A closed contour is opened at a point where it has to be split anyway,
+  // and closed again by repeating that point at the end.
+  int beam_count = geometry_.beamCount();
+  int point_count = (int)xs_.size();
+  bool closed = segments_.size() == 1 && segments_[0].end - segments_[0].begin == beam_count && point_count > 2;
+  if (closed) {
+    runs_.clear();
+    split(0, point_count - 1);
+    int start = runs_[0].second;
+    std::rotate(xs_.begin(), xs_.begin() + start, xs_.end());
+    std::rotate(ys_.begin(), ys_.begin() + start, ys_.end());
+    std::rotate(beams_.begin(), beams_.begin() + start, beams_.end());
+    for (int i = point_count - start; i < point_count; i++)
+      beams_[i] += beam_count;
+    xs_.push_back(xs_[0]);
+    ys_.push_back(ys_[0]);
+    beams_.push_back(beams_[0] + beam_count);
+    segments_[0].point_count = point_count + 1;
+  }
+  computeSums();
+
+  // Split every segment into runs that are straight within the split
+  // distance. Consecutive runs of a segment share their boundary point.
+  runs_.clear();
+  int segment_first = 0;
+  for (const ScanSegment& segment : segments_) {
+    int segment_last = segment_first + segment.point_count - 1;
+    split(segment_first, segment_last);
+    segment_first = segment_last + 1;
+  }
+
+  LineFeature line, previous;
+  size_t run_count = 0;
+  for (size_t i = 0; i < runs_.size(); i++) {
+    if (run_count > 0 && runs_[run_count - 1].second == runs_[i].first) {
+      fit(runs_[run_count - 1].first, runs_[run_count - 1].second, previous);
+      fit(runs_[i].first, runs_[i].second, line);
+      if (angleDifference(previous.alpha, line.alpha) < merge_angle_ &&
+          std::fabs(previous.rho - line.rho) < merge_distance_) {
+        runs_[run_count - 1].second = runs_[i].second;
+        continue;
+      }
+    }
+    runs_[run_count++] = runs_[i];
+  }
+  runs_.resize(run_count);
+
+  int previous_last = -1;
+  for (const std::pair<int, int>& run : runs_) {
+    if (run.second - run.first + 1 < min_point_count_) {
+      previous_last = -1;
+      continue;
+    }
+    fit(run.first, run.second, line);
+    float length = std::hypot(line.end_x - line.start_x, line.end_y - line.start_y);
+    if (length < min_length_) {
+      previous_last = -1;
+      continue;
+    }
+
+    lines.push_back(line);
+    if (previous_last == run.first)
+      detectCorner(lines, (int)lines.size() - 2, (int)lines.size() - 1, run.first, corners);
+    previous_last = run.second;
+  }
+
+  if (closed && lines.size() > 2 && previous_last == (int)xs_.size() - 1 && runs_.front().first == 0 &&
+      lines.front().begin == beams_[0])
+    detectCorner(lines, (int)lines.size() - 1, 0, 0, corners);
+}
+
+void LineExtractor::detectCorner(const std::vector<LineFeature>& lines, int first_line, int second_line,
+                                 int shared_point, std::vector<CornerFeature>& corners) const
+{
+  const LineFeature& first = lines[first_line];
+  const LineFeature& second = lines[second_line];
+  float angle = angleDifference(first.alpha, second.alpha);
+  angle = std::min(angle, (float)PI - angle);
+  float determinant = std::cos(first.alpha) * std::sin(second.alpha) -
+                      std::sin(first.alpha) * std::cos(second.alpha);
+  if (angle < corner_angle_ || std::fabs(determinant) < 1e-6f)
+    return;
+
+  CornerFeature corner;
+  corner.x = (first.rho * std::sin(second.alpha) - second.rho * std::sin(first.alpha)) / determinant;
+  corner.y = (second.rho * std::cos(first.alpha) - first.rho * std::cos(second.alpha)) / determinant;
+  corner.angle = angle;
+  corner.first_line = first_line;
+  corner.second_line = second_line;
+  if (std::hypot(corner.x - xs_[shared_point], corner.y - ys_[shared_point]) <= corner_distance_)
+    corners.push_back(corner);
+}
+
+void LineExtractor::collectPoints(const ScanFrame& scan_frame)
+{
+  xs_.clear();
+  ys_.clear();
+  beams_.clear();
+  if (scan_frame.layers.empty())
+    return;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  geometry_.update(scan_frame.angular_fov, beam_count);
+  const float* c = geometry_.cosines();
+  const float* s = geometry_.sines();
+
+  for (ScanSegment& segment : segments_) {
+    int point_count = 0;
+    for (int i = segment.begin; i < segment.end; i++) {
+      int beam = (i < beam_count) ? i : i - beam_count;
+      if (ranges[beam] <= 0)
+        continue;
+      float range = ranges[beam] * ScanGeometry::RANGE_SCALE;
+      xs_.push_back(range * c[beam]);
+      ys_.push_back(range * s[beam]);
+      beams_.push_back(i);
+      point_count++;
+    }
+    segment.point_count = point_count;
+  }
+}
+
+void LineExtractor::computeSums()
+{
+  size_t point_count = xs_.size();
+  for (int i = 0; i < 5; i++)
+    sums_[i].resize(point_count + 1);
+  sums_[0][0] = sums_[1][0] = sums_[2][0] = sums_[3][0] = sums_[4][0] = 0;
+  for (size_t i = 0; i < point_count; i++) {
+    double x = xs_[i], y = ys_[i];
+    sums_[0][i + 1] = sums_[0][i] + x;
+    sums_[1][i + 1] = sums_[1][i] + y;
+    sums_[2][i + 1] = sums_[2][i] + x * x;
+    sums_[3][i + 1] = sums_[3][i] + y * y;
+    sums_[4][i + 1] = sums_[4][i] + x * y;
+  }
+}
+
+void LineExtractor::split(int first, int last)
+{
+  stack_.clear();
+  stack_.push_back(std::make_pair(first, last));
+  while (!stack_.empty()) {
+    std::pair<int, int> run = stack_.back();
+    stack_.pop_back();
+    if (run.second - run.first < 2) {
+      runs_.push_back(run);
+      continue;
+    }
+
+    const float* xs = xs_.data();
+    const float* ys = ys_.data();
+    float ax = xs[run.first], ay = ys[run.first];
+    float dx = xs[run.second] - ax, dy = ys[run.second] - ay;
+    float chord_length = std::sqrt(dx * dx + dy * dy);
+    // Ends close together, as on a closed contour, leave the chord without
+    // a direction; the distance from the first point is used instead.
+    bool degenerate = chord_length < split_distance_;
+    if (degenerate)
+      chord_length = 1;
+
+    float max_distance = 0;
+    for (int k = run.first + 1; k < run.second; k++) {
+      float px = xs[k] - ax, py = ys[k] - ay;
+      float distance = degenerate ? px * px + py * py : std::fabs(px * dy - py * dx);
+      max_distance = std::max(max_distance, distance);
+    }
+    if (degenerate)
+      max_distance = std::sqrt(max_distance);
+
+    int farthest = run.first + 1;
+    for (int k = run.first + 1; k < run.second; k++) {
+      float px = xs[k] - ax, py = ys[k] - ay;
+      float distance = degenerate ? std::sqrt(px * px + py * py) : std::fabs(px * dy - py * dx);
+      if (distance >= max_distance) {
+        farthest = k;
+        break;
+      }
+    }
+
+    if (max_distance > split_distance_ * chord_length) {
+      stack_.push_back(std::make_pair(farthest, run.second));
+      stack_.push_back(std::make_pair(run.first, farthest));
+    }
+    else
+      runs_.push_back(run);
+  }
+}
+
+void LineExtractor::fit(int first, int last, LineFeature& line) const
+{
+  double n = last - first + 1;
+  double sx = sums_[0][last + 1] - sums_[0][first];
+  double sy = sums_[1][last + 1] - sums_[1][first];
+  double mx = sx / n, my = sy / n;
+  double sxx = sums_[2][last + 1] - sums_[2][first] - sx * mx;
+  double syy = sums_[3][last + 1] - sums_[3][first] - sy * my;
+  double sxy = sums_[4][last + 1] - sums_[4][first] - sx * my;
+
+  double alpha = 0.5 * std::atan2(-2 * sxy, syy - sxx);
+  double rho = mx * std::cos(alpha) + my * std::sin(alpha);
+  if (rho < 0) {
+    rho = -rho;
+    alpha += (alpha < 0) ? PI : -PI;
+  }
+  double cos_alpha = std::cos(alpha), sin_alpha = std::sin(alpha);
+
+  double spread = 0.5 * (sxx + syy) + std::sqrt(0.25 * (sxx - syy) * (sxx - syy) + sxy * sxy);
+  double variance = (double)range_sigma_ * range_sigma_;
+  double alpha_variance = (spread > 0) ? variance / spread : variance;
+  double tangential = -mx * sin_alpha + my * cos_alpha;
+
+  line.begin = beams_[first];
+  line.end = beams_[last] + 1;
+  line.point_count = last - first + 1;
+  line.rho = (float)rho;
+  line.alpha = (float)alpha;
+  line.alpha_variance = (float)alpha_variance;
+  line.rho_variance = (float)(variance / n + tangential * tangential * alpha_variance);
+  line.rho_alpha_covariance = (float)(tangential * alpha_variance);
+
+  double start_offset = xs_[first] * cos_alpha + ys_[first] * sin_alpha - rho;
+  double end_offset = xs_[last] * cos_alpha + ys_[last] * sin_alpha - rho;
+  line.start_x = (float)(xs_[first] - start_offset * cos_alpha);
+  line.start_y = (float)(ys_[first] - start_offset * sin_alpha);
+  line.end_x = (float)(xs_[last] - end_offset * cos_alpha);
+  line.end_y = (float)(ys_[last] - end_offset * sin_alpha);
+}
+
+}
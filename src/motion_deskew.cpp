@@ -0,0 +1,185 @@
+#include "ldcp/motion_deskew.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ldcp_sdk
+{
+
+void MotionDeskew::interpolatePointTimestamps(const ScanFrame& scan_frame, double tick_period,
+                                              std::vector<int64_t>& timestamps)
+{
+  std::vector<int64_t> times;
+  blockTimes(scan_frame, tick_period, times);
+
+  int block_count = (int)scan_frame.block_timestamps.size();
+  int beam_count = scan_frame.layers.empty() ? 0 : (int)scan_frame.layers[0].ranges.size();
+  timestamps.resize(beam_count);
+  if (block_count == 0)
+    return;
+
+  int block_length = beam_count / block_count;
+  double step = 0;
+  for (int i = 0; i < block_count; i++) {
+    int64_t start = times[i];
+    step = (double)(times[i + 1] - times[i]) / std::max(block_length, 1);
+    int64_t* output = timestamps.data() + i * block_length;
+    for (int j = 0; j < block_length; j++)
+      output[j] = start + (int64_t)(step * j);
+  }
+
+  // Beams left over when the frame does not divide evenly into blocks
+  // continue the spacing of the last block
+  int64_t start = times[block_count - 1];
+  for (int j = block_count * block_length; j < beam_count; j++)
+    timestamps[j] = start + (int64_t)(step * (j - (block_count - 1) * block_length));
+}
+
+MotionDeskew::MotionDeskew()
+  : tick_period_(1000.0)
+{
+}
+
+void MotionDeskew::setPoseCallback(PoseCallback callback)
+{
+  pose_callback_ = callback;
+}
+
+void MotionDeskew::setVelocityCallback(VelocityCallback callback)
+{
+  velocity_callback_ = callback;
+}
+
+void MotionDeskew::setTickPeriod(double tick_period)
+{
+  tick_period_ = tick_period;
+}
+
+error_t MotionDeskew::process(const ScanFrame& scan_frame, PointCloud& point_cloud)
+{
+  if (scan_frame.layers.empty() || scan_frame.block_timestamps.empty())
+    return error_t::invalid_params;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  int block_count = (int)scan_frame.block_timestamps.size();
+  if (beam_count % block_count != 0)
+    return error_t::invalid_params;
+  int block_length = beam_count / block_count;
+
+  blockTimes(scan_frame, tick_period_, block_times_);
+  if (!computeBlockTransforms(block_times_))
+    return error_t::unknown;
+
+  geometry_.update(scan_frame.angular_fov, beam_count);
+
+  point_cloud.host_timestamp = scan_frame.host_timestamp;
+  point_cloud.x.resize(beam_count);
+  point_cloud.y.resize(beam_count);
+  point_cloud.intensities = scan_frame.layers[0].intensities;
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float inverse_length = 1.0f / block_length;
+  for (int i = 0; i < block_count; i++) {
+    const float c0 = transform_cos_[i], dc = transform_cos_[i + 1] - c0;
+    const float s0 = transform_sin_[i], ds = transform_sin_[i + 1] - s0;
+    const float x0 = transform_x_[i], dx = transform_x_[i + 1] - x0;
+    const float y0 = transform_y_[i], dy = transform_y_[i + 1] - y0;
+
+    int offset = i * block_length;
+    const int* r = ranges.data() + offset;
+    const float* beam_cos = geometry_.cosines() + offset;
+    const float* beam_sin = geometry_.sines() + offset;
+    float* x = point_cloud.x.data() + offset;
+    float* y = point_cloud.y.data() + offset;
+    for (int j = 0; j < block_length; j++) {
+      float t = j * inverse_length;
+      float c = c0 + dc * t, s = s0 + ds * t;
+      float range = r[j] * ScanGeometry::RANGE_SCALE;
+      float px = range * beam_cos[j], py = range * beam_sin[j];
+      float qx = c * px - s * py + x0 + dx * t;
+      float qy = s * px + c * py + y0 + dy * t;
+      x[j] = (r[j] > 0) ? qx : nan;
+      y[j] = (r[j] > 0) ? qy : nan;
+    }
+  }
+
+  return error_t::no_error;
+}
+
+void MotionDeskew::blockTimes(const ScanFrame& scan_frame, double tick_period, std::vector<int64_t>& times)
+{
+  int block_count = (int)scan_frame.block_timestamps.size();
+  times.resize(block_count + 1);
+  if (block_count == 0)
+    return;
+
+  bool host_timestamps_valid = (scan_frame.block_host_timestamps.size() == (size_t)block_count);
+  for (int i = 0; host_timestamps_valid && i < block_count; i++)
+    host_timestamps_valid = (scan_frame.block_host_timestamps[i] != 0);
+
+  if (host_timestamps_valid) {
+    for (int i = 0; i < block_count; i++)
+      times[i] = scan_frame.block_host_timestamps[i];
+  }
+  else {
+    uint32_t first = scan_frame.block_timestamps[0];
+    int64_t base = (int64_t)(first * tick_period);
+    for (int i = 0; i < block_count; i++)
+      times[i] = base + (int64_t)((int32_t)(scan_frame.block_timestamps[i] - first) * tick_period);
+  }
+
+  times[block_count] = (block_count > 1) ?
+    2 * times[block_count - 1] - times[block_count - 2] : times[block_count - 1];
+}
+
+bool MotionDeskew::computeBlockTransforms(const std::vector<int64_t>& times)
+{
+  int count = (int)times.size();
+  transform_cos_.assign(count, 1.0f);
+  transform_sin_.assign(count, 0.0f);
+  transform_x_.assign(count, 0.0f);
+  transform_y_.assign(count, 0.0f);
+
+  if (pose_callback_) {
+    Pose2D reference;
+    if (!pose_callback_(times[0], reference))
+      return false;
+    double reference_cos = std::cos(reference.theta), reference_sin = std::sin(reference.theta);
+    for (int i = 1; i < count; i++) {
+      Pose2D pose;
+      if (!pose_callback_(times[i], pose))
+        return false;
+      double dx = pose.x - reference.x, dy = pose.y - reference.y;
+      transform_cos_[i] = (float)std::cos(pose.theta - reference.theta);
+      transform_sin_[i] = (float)std::sin(pose.theta - reference.theta);
+      transform_x_[i] = (float)(reference_cos * dx + reference_sin * dy);
+      transform_y_[i] = (float)(-reference_sin * dx + reference_cos * dy);
+    }
+  }
+  else if (velocity_callback_) {
+    Velocity2D velocity;
+    if (!velocity_callback_(times[0], velocity))
+      return false;
+    for (int i = 1; i < count; i++) {
+      double dt = (times[i] - times[0]) * 1e-9;
+      double theta = velocity.omega * dt;
+      double c = std::cos(theta), s = std::sin(theta);
+      transform_cos_[i] = (float)c;
+      transform_sin_[i] = (float)s;
+      if (std::fabs(velocity.omega) < 1e-9) {
+        transform_x_[i] = (float)(velocity.vx * dt);
+        transform_y_[i] = (float)(velocity.vy * dt);
+      }
+      else {
+        transform_x_[i] = (float)((velocity.vx * s - velocity.vy * (1 - c)) / velocity.omega);
+        transform_y_[i] = (float)((velocity.vx * (1 - c) + velocity.vy * s) / velocity.omega);
+      }
+    }
+  }
+
+  return true;
+}
+
+}
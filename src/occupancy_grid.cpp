@@ -0,0 +1,409 @@
+#include "ldcp/occupancy_grid.h"
+#include "ldcp/thread_config.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static const float LOG_ODDS_SCALE = 1024.0f;
+static const int16_t UNKNOWN_LOG_ODDS = INT16_MIN;
+static const int SECTORS_PER_WORKER = 4;
+static const int TILE_MARGIN = 2;
+static const int TILE_CELL_COUNT = OccupancyGrid::TILE_SIZE * OccupancyGrid::TILE_SIZE;
+
+struct OccupancyTile
+{
+  int16_t cells[TILE_CELL_COUNT];
+};
+
+static int16_t logOdds(float probability)
+{
+  double value = std::log(probability / (1.0 - probability)) * LOG_ODDS_SCALE;
+  return (int16_t)std::max(std::min(std::lround(value), (long)INT16_MAX), (long)(INT16_MIN + 1));
+}
+
+static float probability(int16_t log_odds)
+{
+  return 1.0f - 1.0f / (1.0f + std::exp(log_odds / LOG_ODDS_SCALE));
+}
+
+OccupancyGridSnapshot::OccupancyGridSnapshot()
+  : resolution_(0)
+  , tile_origin_x_(0)
+  , tile_origin_y_(0)
+  , tile_columns_(0)
+  , tile_rows_(0)
+{
+}
+
+double OccupancyGridSnapshot::resolution() const
+{
+  return resolution_;
+}
+
+bool OccupancyGridSnapshot::isEmpty() const
+{
+  return tiles_.empty();
+}
+
+float OccupancyGridSnapshot::probability(double x, double y) const
+{
+  if (tiles_.empty())
+    return -1;
+
+  int cell_x = (int)std::floor(x / resolution_) - tile_origin_x_ * OccupancyGrid::TILE_SIZE;
+  int cell_y = (int)std::floor(y / resolution_) - tile_origin_y_ * OccupancyGrid::TILE_SIZE;
+  if (cell_x < 0 || cell_y < 0 || cell_x >= tile_columns_ * OccupancyGrid::TILE_SIZE ||
+      cell_y >= tile_rows_ * OccupancyGrid::TILE_SIZE)
+    return -1;
+
+  const std::shared_ptr<const OccupancyTile>& tile =
+    tiles_[(cell_y / OccupancyGrid::TILE_SIZE) * tile_columns_ + cell_x / OccupancyGrid::TILE_SIZE];
+  if (!tile)
+    return -1;
+  int16_t value = tile->cells[(cell_y % OccupancyGrid::TILE_SIZE) * OccupancyGrid::TILE_SIZE +
+                              cell_x % OccupancyGrid::TILE_SIZE];
+  return (value == UNKNOWN_LOG_ODDS) ? -1 : ldcp_sdk::probability(value);
+}
+
+// Row-major cells from the corner at (origin_x, origin_y), rows running
+// along +y, holding -1 for unknown cells and the occupancy probability in
+// percent otherwise.
+void OccupancyGridSnapshot::exportCells(std::vector<int8_t>& cells, int& width, int& height,
+                                        double& origin_x, double& origin_y) const
+{
+  width = tile_columns_ * OccupancyGrid::TILE_SIZE;
+  height = tile_rows_ * OccupancyGrid::TILE_SIZE;
+  origin_x = tile_origin_x_ * OccupancyGrid::TILE_SIZE * resolution_;
+  origin_y = tile_origin_y_ * OccupancyGrid::TILE_SIZE * resolution_;
+  cells.assign((size_t)width * height, -1);
+
+  for (int tile_y = 0; tile_y < tile_rows_; tile_y++) {
+    for (int tile_x = 0; tile_x < tile_columns_; tile_x++) {
+      const std::shared_ptr<const OccupancyTile>& tile = tiles_[tile_y * tile_columns_ + tile_x];
+      if (!tile)
+        continue;
+      for (int row = 0; row < OccupancyGrid::TILE_SIZE; row++) {
+        const int16_t* source = tile->cells + row * OccupancyGrid::TILE_SIZE;
+        int8_t* target = &cells[(size_t)(tile_y * OccupancyGrid::TILE_SIZE + row) * width +
+                                tile_x * OccupancyGrid::TILE_SIZE];
+        for (int column = 0; column < OccupancyGrid::TILE_SIZE; column++) {
+          if (source[column] != UNKNOWN_LOG_ODDS)
+            target[column] = (int8_t)std::lround(100 * ldcp_sdk::probability(source[column]));
+        }
+      }
+    }
+  }
+}
+
+OccupancyGrid::OccupancyGrid(double resolution, int worker_count)
+  : resolution_(resolution)
+  , hit_update_(logOdds(0.7f))
+  , miss_update_(logOdds(0.4f))
+  , min_log_odds_(logOdds(0.12f))
+  , max_log_odds_(logOdds(0.97f))
+  , max_range_(30.0f)
+  , tile_origin_x_(0)
+  , tile_origin_y_(0)
+  , tile_columns_(0)
+  , tile_rows_(0)
+  , sensor_x_(0)
+  , sensor_y_(0)
+  , sensor_cos_(1)
+  , sensor_sin_(0)
+  , generation_(0)
+  , busy_workers_(0)
+  , running_(true)
+  , next_sector_(0)
+{
+  if (worker_count <= 0)
+    worker_count = std::max(1, (int)std::thread::hardware_concurrency());
+
+  for (int i = 0; i < worker_count; i++)
+    workers_.emplace_back(new Worker());
+  for (int i = 1; i < worker_count; i++) {
+    workers_[i]->thread = ThreadManager::instance().createThread(THREAD_ROLE_PROCESSING, "ldcp-grid", [this, i]() {
+      workerLoop(i);
+    });
+  }
+}
+
+OccupancyGrid::~OccupancyGrid()
+{
+  {
+    std::lock_guard<std::mutex> lock(job_mutex_);
+    running_ = false;
+  }
+  job_cv_.notify_all();
+  for (std::unique_ptr<Worker>& worker : workers_) {
+    if (worker->thread.joinable())
+      worker->thread.join();
+  }
+}
+
+void OccupancyGrid::setHitProbabilities(float hit, float miss)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  hit_update_ = logOdds(hit);
+  miss_update_ = logOdds(miss);
+}
+
+void OccupancyGrid::setProbabilityLimits(float min_probability, float max_probability)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  min_log_odds_ = logOdds(min_probability);
+  max_log_odds_ = logOdds(max_probability);
+}
+
+void OccupancyGrid::setMaxRange(float range)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_range_ = range;
+}
+
+void OccupancyGrid::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  tiles_.clear();
+  tile_origin_x_ = tile_origin_y_ = 0;
+  tile_columns_ = tile_rows_ = 0;
+}
+
+double OccupancyGrid::resolution() const
+{
+  return resolution_;
+}
+
+int OccupancyGrid::tileCount()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  int count = 0;
+  for (const std::shared_ptr<OccupancyTile>& tile : tiles_)
+    count += tile ? 1 : 0;
+  return count;
+}
+
+void OccupancyGrid::snapshot(OccupancyGridSnapshot& snapshot)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  snapshot.resolution_ = resolution_;
+  snapshot.tile_origin_x_ = tile_origin_x_;
+  snapshot.tile_origin_y_ = tile_origin_y_;
+  snapshot.tile_columns_ = tile_columns_;
+  snapshot.tile_rows_ = tile_rows_;
+  snapshot.tiles_.assign(tiles_.begin(), tiles_.end());
+}
+
+error_t OccupancyGrid::update(const ScanFrame& scan_frame, const Pose2D& pose)
+{
+  if (scan_frame.layers.empty() || scan_frame.layers[0].ranges.empty())
+    return error_t::invalid_params;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int* ranges = scan_frame.layers[0].ranges.data();
+  const int beam_count = (int)scan_frame.layers[0].ranges.size();
+  geometry_.update(scan_frame.angular_fov, beam_count);
+
+  // One more range of zero for bearings outside the field of view
+  ranges_.resize(beam_count + 1);
+  ranges_[beam_count] = 0;
+  float* metres = ranges_.data();
+  const float max_range = max_range_;
+  float reach = 0;
+  for (int i = 0; i < beam_count; i++) {
+    metres[i] = (ranges[i] > 0) ? ranges[i] * ScanGeometry::RANGE_SCALE : 0.0f;
+    reach = std::max(reach, std::min(metres[i], max_range));
+  }
+  if (reach <= 0)
+    return error_t::no_error;
+
+  sensor_x_ = pose.x;
+  sensor_y_ = pose.y;
+  sensor_cos_ = (float)std::cos(pose.theta);
+  sensor_sin_ = (float)std::sin(pose.theta);
+
+  double tile_length = resolution_ * TILE_SIZE;
+  double margin = reach + resolution_;
+  int min_x = (int)std::floor((pose.x - margin) / tile_length);
+  int min_y = (int)std::floor((pose.y - margin) / tile_length);
+  int max_x = (int)std::floor((pose.x + margin) / tile_length);
+  int max_y = (int)std::floor((pose.y + margin) / tile_length);
+  reserveTiles(min_x, min_y, max_x, max_y);
+
+  // Tiles go to the sector their centre lies in, as seen from the sensor
+  int sector_count = SECTORS_PER_WORKER * (int)workers_.size();
+  int tile_count = (max_x - min_x + 1) * (max_y - min_y + 1);
+  sector_offsets_.assign(sector_count + 1, 0);
+  sector_tiles_.resize(tile_count);
+  tile_sectors_.resize(tile_count);
+  int* tile_sectors = tile_sectors_.data();
+  for (int tile_y = min_y, k = 0; tile_y <= max_y; tile_y++) {
+    for (int tile_x = min_x; tile_x <= max_x; tile_x++, k++) {
+      double center_x = (tile_x + 0.5) * tile_length - pose.x;
+      double center_y = (tile_y + 0.5) * tile_length - pose.y;
+      int sector = (int)((std::atan2(center_y, center_x) + PI) / (2 * PI) * sector_count);
+      sector = std::min(std::max(sector, 0), sector_count - 1);
+      tile_sectors[k] = sector;
+      sector_offsets_[sector + 1]++;
+    }
+  }
+  for (int sector = 0; sector < sector_count; sector++)
+    sector_offsets_[sector + 1] += sector_offsets_[sector];
+  for (int tile_y = min_y, k = 0; tile_y <= max_y; tile_y++) {
+    for (int tile_x = min_x; tile_x <= max_x; tile_x++, k++) {
+      int index = (tile_y - tile_origin_y_) * tile_columns_ + (tile_x - tile_origin_x_);
+      sector_tiles_[sector_offsets_[tile_sectors[k]]++] = index;
+    }
+  }
+  for (int sector = sector_count; sector > 0; sector--)
+    sector_offsets_[sector] = sector_offsets_[sector - 1];
+  sector_offsets_[0] = 0;
+
+  {
+    std::lock_guard<std::mutex> job_lock(job_mutex_);
+    busy_workers_ = (int)workers_.size() - 1;
+    next_sector_ = 0;
+    generation_++;
+  }
+  job_cv_.notify_all();
+  processSectors(workers_[0]->deltas);
+  {
+    std::unique_lock<std::mutex> job_lock(job_mutex_);
+    done_cv_.wait(job_lock, [this]() {
+      return busy_workers_ == 0;
+    });
+  }
+
+  return error_t::no_error;
+}
+
+void OccupancyGrid::reserveTiles(int min_x, int min_y, int max_x, int max_y)
+{
+  if (!tiles_.empty()) {
+    if (min_x >= tile_origin_x_ && min_y >= tile_origin_y_ &&
+        max_x < tile_origin_x_ + tile_columns_ && max_y < tile_origin_y_ + tile_rows_)
+      return;
+
+    // Grow with a margin so that a moving sensor does not regrow every frame
+    int end_x = tile_origin_x_ + tile_columns_, end_y = tile_origin_y_ + tile_rows_;
+    min_x = (min_x < tile_origin_x_) ? min_x - TILE_MARGIN : tile_origin_x_;
+    min_y = (min_y < tile_origin_y_) ? min_y - TILE_MARGIN : tile_origin_y_;
+    max_x = (max_x >= end_x) ? max_x + TILE_MARGIN : end_x - 1;
+    max_y = (max_y >= end_y) ? max_y + TILE_MARGIN : end_y - 1;
+  }
+
+  int columns = max_x - min_x + 1, rows = max_y - min_y + 1;
+  std::vector<std::shared_ptr<OccupancyTile>> tiles(columns * rows);
+  for (int row = 0; row < tile_rows_; row++) {
+    for (int column = 0; column < tile_columns_; column++) {
+      int index = (tile_origin_y_ + row - min_y) * columns + (tile_origin_x_ + column - min_x);
+      tiles[index] = std::move(tiles_[row * tile_columns_ + column]);
+    }
+  }
+  tiles_.swap(tiles);
+  tile_origin_x_ = min_x;
+  tile_origin_y_ = min_y;
+  tile_columns_ = columns;
+  tile_rows_ = rows;
+}
+
+void OccupancyGrid::processSectors(std::vector<int16_t>& deltas)
+{
+  const int sector_count = (int)sector_offsets_.size() - 1;
+  for (int sector = next_sector_++; sector < sector_count; sector = next_sector_++) {
+    for (int k = sector_offsets_[sector]; k < sector_offsets_[sector + 1]; k++)
+      updateTile(sector_tiles_[k], deltas);
+  }
+}
+
+// Every cell centre is turned into the sensor frame and looked up in the
+// beam it lies on. Cells within half a cell diagonal of that beam's return
+// are hits, cells nearer to the sensor are misses, and cells behind the
+// return or beyond the maximum range are left alone. The tile is only
+// allocated, or copied away from snapshots, once some cell of it changes.
+void OccupancyGrid::updateTile(int tile_index, std::vector<int16_t>& deltas)
+{
+  const int tile_x = tile_origin_x_ + tile_index % tile_columns_;
+  const int tile_y = tile_origin_y_ + tile_index / tile_columns_;
+  const float resolution = (float)resolution_;
+  const float base_x = (float)((tile_x * TILE_SIZE + 0.5) * resolution_ - sensor_x_);
+  const float base_y = (float)((tile_y * TILE_SIZE + 0.5) * resolution_ - sensor_y_);
+  const float c = sensor_cos_, s = sensor_sin_;
+
+  const int beam_count = geometry_.beamCount();
+  const float band = resolution * 0.7072f;
+  const float max_range = max_range_;
+  const int hit_update = hit_update_, miss_update = miss_update_;
+  const float* ranges = ranges_.data();
+
+  deltas.resize(TILE_CELL_COUNT);
+  int touched = 0;
+  for (int row = 0; row < TILE_SIZE; row++) {
+    const float dy = base_y + row * resolution;
+    int16_t* delta = deltas.data() + row * TILE_SIZE;
+    for (int column = 0; column < TILE_SIZE; column++) {
+      float dx = base_x + column * resolution;
+      float local_x = c * dx + s * dy, local_y = c * dy - s * dx;
+      float distance_squared = dx * dx + dy * dy;
+      int beam = geometry_.beamIndex(local_y, local_x);
+      float range = ranges[std::min((unsigned int)beam, (unsigned int)beam_count)];
+      float near = std::max(range - band, 0.0f), far = range + band;
+      float free = std::max(std::min(range, max_range) - band, 0.0f);
+      int hit = (range > 0) & (range <= max_range) &
+                (distance_squared >= near * near) & (distance_squared <= far * far);
+      int miss = (range > 0) & (distance_squared < free * free);
+      int value = hit * hit_update + miss * miss_update;
+      delta[column] = (int16_t)value;
+      touched |= value;
+    }
+  }
+  if (!touched)
+    return;
+
+  std::shared_ptr<OccupancyTile>& tile = tiles_[tile_index];
+  if (!tile) {
+    tile = std::make_shared<OccupancyTile>();
+    std::fill(tile->cells, tile->cells + TILE_CELL_COUNT, UNKNOWN_LOG_ODDS);
+  }
+  else if (tile.use_count() > 1)
+    tile = std::make_shared<OccupancyTile>(*tile);
+
+  int16_t* cells = tile->cells;
+  const int16_t* delta = deltas.data();
+  const int low = min_log_odds_, high = max_log_odds_;
+  for (int i = 0; i < TILE_CELL_COUNT; i++) {
+    int value = cells[i];
+    int known = (value == UNKNOWN_LOG_ODDS) ? 0 : value;
+    int updated = std::min(std::max(known + delta[i], low), high);
+    cells[i] = delta[i] ? (int16_t)updated : (int16_t)value;
+  }
+}
+
+void OccupancyGrid::workerLoop(int worker_index)
+{
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(job_mutex_);
+      job_cv_.wait(lock, [this, &generation]() {
+        return !running_ || generation_ != generation;
+      });
+      if (!running_)
+        return;
+      generation = generation_;
+    }
+
+    processSectors(workers_[worker_index]->deltas);
+
+    {
+      std::lock_guard<std::mutex> lock(job_mutex_);
+      if (--busy_workers_ == 0)
+        done_cv_.notify_one();
+    }
+  }
+}
+
+}
@@ -0,0 +1,304 @@
+#include "ldcp/oob_receiver.h"
+#include "ldcp/thread_config.h"
+#include "ldcp/trace.h"
+
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <climits>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <time.h>
+#endif
+
+namespace ldcp_sdk
+{
+
+static std::mutex receivers_mutex;
+static std::map<uint64_t, std::weak_ptr<OobReceiver>> receivers;
+
+std::shared_ptr<OobReceiver> OobReceiver::acquire(const NetworkLocation& local_location,
+                                                  oob_receive_mode_t mode, int busy_poll_timeout,
+                                                  error_t& result)
+{
+  std::lock_guard<std::mutex> lock(receivers_mutex);
+
+  uint64_t key = senderKey(local_location.address(), local_location.port());
+  std::shared_ptr<OobReceiver> receiver = receivers[key].lock();
+  if (receiver) {
+    if (mode != receiver->mode_ ||
+        (mode == OOB_RECEIVE_MODE_BUSY_POLL && busy_poll_timeout != receiver->busy_poll_timeout_)) {
+      result = error_t::invalid_params;
+      return nullptr;
+    }
+    result = error_t::no_error;
+    return receiver;
+  }
+
+  receiver.reset(new OobReceiver());
+  result = receiver->open(local_location, mode, busy_poll_timeout);
+  if (result != error_t::no_error)
+    return nullptr;
+
+  receivers[key] = receiver;
+  return receiver;
+}
+
+OobReceiver::OobReceiver()
+  : socket_(io_service_)
+  , mode_(OOB_RECEIVE_MODE_REACTOR)
+  , busy_poll_timeout_(0)
+  , polling_(false)
+  , receive_buffer_(BATCH_SIZE * PACKET_LENGTH_MAX)
+  , control_buffer_(BATCH_SIZE * CONTROL_LENGTH_MAX)
+  , kernel_drops_(0)
+{
+}
+
+OobReceiver::~OobReceiver()
+{
+  if (thread_.joinable()) {
+    if (mode_ == OOB_RECEIVE_MODE_BUSY_POLL) {
+      polling_ = false;
+      thread_.join();
+      socket_.close();
+    }
+    else {
+      io_service_.dispatch([&]() {
+        socket_.close();
+      });
+      thread_.join();
+    }
+  }
+}
+
+void OobReceiver::registerSender(const NetworkLocation& sender_location, PacketCallback callback,
+                                 int receive_buffer_size)
+{
+  std::lock_guard<std::mutex> lock(senders_mutex_);
+  Sender& sender = senders_[senderKey(sender_location.address(), sender_location.port())];
+  sender = Sender();
+  sender.callback = callback;
+  sender.receive_buffer_size = receive_buffer_size;
+  updateReceiveBufferSize();
+}
+
+void OobReceiver::unregisterSender(const NetworkLocation& sender_location)
+{
+  std::lock_guard<std::mutex> lock(senders_mutex_);
+  senders_.erase(senderKey(sender_location.address(), sender_location.port()));
+}
+
+void OobReceiver::updateReceiveBufferSize()
+{
+  int64_t sum = 0;
+  for (auto& entry : senders_)
+    sum += std::max(entry.second.receive_buffer_size, 0);
+  int total_size = (int)std::min(sum, (int64_t)INT_MAX);
+  if (total_size <= 0)
+    return;
+
+  asio::ip::udp::socket::receive_buffer_size current_size;
+  asio::error_code error;
+  socket_.get_option(current_size, error);
+  if (!error && current_size.value() >= total_size)
+    return;
+
+#ifdef __linux__
+  if (setsockopt(socket_.native_handle(), SOL_SOCKET, SO_RCVBUFFORCE, &total_size, sizeof(total_size)) == 0)
+    return;
+#endif
+  socket_.set_option(asio::ip::udp::socket::receive_buffer_size(total_size), error);
+}
+
+void OobReceiver::getStatistics(const NetworkLocation& sender_location, OobStatistics& statistics)
+{
+  std::lock_guard<std::mutex> lock(senders_mutex_);
+  statistics = OobStatistics();
+  auto iter = senders_.find(senderKey(sender_location.address(), sender_location.port()));
+  if (iter != senders_.end()) {
+    const Sender& sender = iter->second;
+    statistics.packets_received = sender.packets_received;
+    if (sender.packets_received > 0) {
+      statistics.receive_latency_mean = sender.receive_latency_sum / (int64_t)sender.packets_received;
+      statistics.delivery_latency_mean = sender.delivery_latency_sum / (int64_t)sender.packets_received;
+    }
+    statistics.receive_latency_max = sender.receive_latency_max;
+    statistics.delivery_latency_max = sender.delivery_latency_max;
+  }
+  statistics.kernel_drops = kernel_drops_;
+
+  asio::ip::udp::socket::receive_buffer_size receive_buffer_size;
+  asio::error_code error;
+  socket_.get_option(receive_buffer_size, error);
+  statistics.receive_buffer_size = error ? 0 : receive_buffer_size.value();
+}
+
+error_t OobReceiver::open(const NetworkLocation& local_location, oob_receive_mode_t mode, int busy_poll_timeout)
+{
+  socket_.open(asio::ip::udp::v4());
+  socket_.set_option(asio::ip::udp::socket::reuse_address(true));
+
+  asio::ip::udp::endpoint local_address(asio::ip::address_v4(ntohl(local_location.address())),
+                                        ntohs(local_location.port()));
+  asio::error_code bind_result;
+  socket_.bind(local_address, bind_result);
+
+  if (!bind_result) {
+    socket_.non_blocking(true);
+    mode_ = mode;
+    busy_poll_timeout_ = busy_poll_timeout;
+
+#ifdef __linux__
+    int enabled = 1;
+    setsockopt(socket_.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled));
+    setsockopt(socket_.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &enabled, sizeof(enabled));
+    if (mode == OOB_RECEIVE_MODE_BUSY_POLL && busy_poll_timeout > 0)
+      setsockopt(socket_.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &busy_poll_timeout, sizeof(busy_poll_timeout));
+#endif
+
+    if (mode == OOB_RECEIVE_MODE_BUSY_POLL) {
+      polling_ = true;
+      thread_ = ThreadManager::instance().createThread(THREAD_ROLE_OOB_RECEIVER, "ldcp-oob-poll", [&]() {
+        while (polling_)
+          receivePackets();
+      });
+    }
+    else {
+      waitForPackets();
+      thread_ = ThreadManager::instance().createThread(THREAD_ROLE_OOB_RECEIVER, "ldcp-oob", [&]() {
+        io_service_.run();
+      });
+    }
+    return error_t::no_error;
+  }
+  else {
+    socket_.close();
+
+    if (bind_result == asio::error::address_in_use)
+      return error_t::address_in_use;
+    else
+      return error_t::unknown;
+  }
+}
+
+void OobReceiver::waitForPackets()
+{
+  socket_.async_wait(asio::ip::udp::socket::wait_read, [this](const asio::error_code& error) {
+    if (!error) {
+      while (receivePackets() == BATCH_SIZE);
+      waitForPackets();
+    }
+  });
+}
+
+#ifdef __linux__
+
+int OobReceiver::receivePackets()
+{
+  struct mmsghdr messages[BATCH_SIZE];
+  struct iovec iovecs[BATCH_SIZE];
+  struct sockaddr_in sender_addresses[BATCH_SIZE];
+
+  for (int i = 0; i < BATCH_SIZE; i++) {
+    iovecs[i].iov_base = &receive_buffer_[i * PACKET_LENGTH_MAX];
+    iovecs[i].iov_len = PACKET_LENGTH_MAX;
+    messages[i].msg_hdr.msg_name = &sender_addresses[i];
+    messages[i].msg_hdr.msg_namelen = sizeof(sender_addresses[i]);
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = &control_buffer_[i * CONTROL_LENGTH_MAX];
+    messages[i].msg_hdr.msg_controllen = CONTROL_LENGTH_MAX;
+    messages[i].msg_hdr.msg_flags = 0;
+  }
+
+  int count = recvmmsg(socket_.native_handle(), messages, BATCH_SIZE, MSG_DONTWAIT, NULL);
+  if (count <= 0)
+    return 0;
+  int64_t wakeup_time = realTime();
+
+  std::lock_guard<std::mutex> lock(senders_mutex_);
+  for (int i = 0; i < count; i++) {
+    int64_t arrival_time = wakeup_time;
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+        const struct timespec* timestamp = reinterpret_cast<const struct timespec*>(CMSG_DATA(cmsg));
+        arrival_time = (int64_t)timestamp->tv_sec * 1000000000 + timestamp->tv_nsec;
+      }
+      else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        kernel_drops_ = *reinterpret_cast<const uint32_t*>(CMSG_DATA(cmsg));
+    }
+    dispatchPacket(sender_addresses[i].sin_addr.s_addr, sender_addresses[i].sin_port,
+                   &receive_buffer_[i * PACKET_LENGTH_MAX], messages[i].msg_len,
+                   arrival_time, wakeup_time);
+  }
+
+  return count;
+}
+
+int64_t OobReceiver::realTime()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+#else
+
+int OobReceiver::receivePackets()
+{
+  asio::ip::udp::endpoint sender_address;
+  asio::error_code error;
+
+  int count = 0;
+  while (count < BATCH_SIZE) {
+    size_t length = socket_.receive_from(asio::buffer(receive_buffer_.data(), PACKET_LENGTH_MAX),
+                                         sender_address, 0, error);
+    if (error)
+      break;
+    int64_t wakeup_time = realTime();
+
+    std::lock_guard<std::mutex> lock(senders_mutex_);
+    dispatchPacket(htonl(sender_address.address().to_v4().to_ulong()), htons(sender_address.port()),
+                   receive_buffer_.data(), length, wakeup_time, wakeup_time);
+    count++;
+  }
+
+  return count;
+}
+
+int64_t OobReceiver::realTime()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+#endif
+
+void OobReceiver::dispatchPacket(in_addr_t address, in_port_t port, uint8_t* data, size_t length,
+                                 int64_t arrival_time, int64_t wakeup_time)
+{
+  auto iter = senders_.find(senderKey(address, port));
+  if (iter != senders_.end()) {
+    Sender& sender = iter->second;
+    LDCP_TRACE(TRACE_EVENT_PACKET_RECEIVE, length);
+    sender.callback(data, length);
+
+    int64_t receive_latency = wakeup_time - arrival_time;
+    int64_t delivery_latency = realTime() - wakeup_time;
+    sender.packets_received++;
+    sender.receive_latency_sum += receive_latency;
+    sender.receive_latency_max = std::max(sender.receive_latency_max, receive_latency);
+    sender.delivery_latency_sum += delivery_latency;
+    sender.delivery_latency_max = std::max(sender.delivery_latency_max, delivery_latency);
+  }
+}
+
+uint64_t OobReceiver::senderKey(in_addr_t address, in_port_t port)
+{
+  return ((uint64_t)address << 16) | port;
+}
+
+}
@@ -0,0 +1,172 @@
+#include "ldcp/protective_field.h"
+#include "ldcp/scan_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ldcp_sdk
+{
+
+ProtectiveField::ProtectiveField()
+  : min_beam_count_(1)
+  , angular_fov_(ANGULAR_FOV_270DEG)
+  , beam_count_(0)
+  , sequence_(0)
+{
+}
+
+int ProtectiveField::addZone(const std::vector<Point2D>& polygon)
+{
+  if (zones_.size() == ZONE_COUNT_MAX || polygon.size() < 3)
+    return -1;
+  zones_.push_back(polygon);
+  beam_count_ = 0;
+  reset();
+  return (int)zones_.size() - 1;
+}
+
+void ProtectiveField::clearZones()
+{
+  zones_.clear();
+  beam_count_ = 0;
+  reset();
+}
+
+int ProtectiveField::zoneCount() const
+{
+  return (int)zones_.size();
+}
+
+void ProtectiveField::setMinBeamCount(int count)
+{
+  min_beam_count_ = std::max(count, 1);
+}
+
+void ProtectiveField::update(angular_fov_t angular_fov, int beam_count)
+{
+  if (angular_fov == angular_fov_ && beam_count == beam_count_)
+    return;
+
+  angular_fov_ = angular_fov;
+  beam_count_ = beam_count;
+  near_thresholds_.resize(zones_.size() * beam_count);
+  far_thresholds_.resize(zones_.size() * beam_count);
+  for (size_t i = 0; i < zones_.size(); i++)
+    computeThresholds(zones_[i], &near_thresholds_[i * beam_count], &far_thresholds_[i * beam_count]);
+  reset();
+}
+
+void ProtectiveField::computeThresholds(const std::vector<Point2D>& polygon, int* near_thresholds,
+                                        int* far_thresholds)
+{
+  size_t vertex_count = polygon.size();
+  bool origin_inside = false;
+  for (size_t i = 0, j = vertex_count - 1; i < vertex_count; j = i++) {
+    const Point2D& a = polygon[i];
+    const Point2D& b = polygon[j];
+    if ((a.y > 0) != (b.y > 0) && 0 < (b.x - a.x) * (0 - a.y) / (b.y - a.y) + a.x)
+      origin_inside = !origin_inside;
+  }
+
+  ScanGeometry geometry;
+  geometry.update(angular_fov_, beam_count_);
+  for (int beam = 0; beam < beam_count_; beam++) {
+    double angle = geometry.angle(beam);
+    double dx = std::cos(angle), dy = std::sin(angle);
+    double near = origin_inside ? 0 : std::numeric_limits<double>::max(), far = 0;
+    for (size_t i = 0, j = vertex_count - 1; i < vertex_count; j = i++) {
+      const Point2D& a = polygon[j];
+      double ex = polygon[i].x - a.x, ey = polygon[i].y - a.y;
+      double denominator = dx * ey - dy * ex;
+      if (std::fabs(denominator) < 1e-12)
+        continue;
+      double t = (a.x * ey - a.y * ex) / denominator;
+      double s = (a.x * dy - a.y * dx) / denominator;
+      if (t < 0 || s < 0 || s > 1)
+        continue;
+      near = std::min(near, t);
+      far = std::max(far, t);
+    }
+    if (far <= near) {
+      near_thresholds[beam] = 0;
+      far_thresholds[beam] = 0;
+    }
+    else {
+      near_thresholds[beam] = (int)std::floor(near / ScanGeometry::RANGE_SCALE);
+      far_thresholds[beam] = (int)std::ceil(far / ScanGeometry::RANGE_SCALE);
+    }
+  }
+}
+
+error_t ProtectiveField::evaluate(const ScanBlock& scan_block)
+{
+  int block_length = scan_block.block_length;
+  if (scan_block.block_count <= 0 || block_length <= 0 ||
+      scan_block.block_index < 0 || scan_block.block_index >= scan_block.block_count ||
+      scan_block.layers.empty() || scan_block.layers[0].ranges.size() < (size_t)block_length)
+    return error_t::invalid_params;
+  if (zones_.empty())
+    return error_t::no_error;
+
+  update(scan_block.angular_fov, scan_block.block_count * block_length);
+  if (block_violations_.size() != (size_t)scan_block.block_count) {
+    block_violations_.assign(scan_block.block_count, 0);
+    block_sequences_.assign(scan_block.block_count, 0);
+  }
+
+  const int* ranges = scan_block.layers[0].ranges.data();
+  int beam_offset = scan_block.block_index * block_length;
+  uint32_t violations = 0;
+  for (size_t i = 0; i < zones_.size(); i++) {
+    const int* near = &near_thresholds_[i * beam_count_ + beam_offset];
+    const int* far = &far_thresholds_[i * beam_count_ + beam_offset];
+    int count = 0;
+    for (int j = 0; j < block_length; j++)
+      count += (ranges[j] > 0) & (ranges[j] >= near[j]) & (ranges[j] < far[j]);
+    if (count >= min_beam_count_)
+      violations |= (uint32_t)1 << i;
+  }
+
+  block_violations_[scan_block.block_index] = violations;
+  block_sequences_[scan_block.block_index] = ++sequence_;
+  return error_t::no_error;
+}
+
+uint32_t ProtectiveField::violatedZones() const
+{
+  uint64_t oldest = sequence_ - std::min(sequence_, (uint64_t)(2 * block_sequences_.size()));
+  uint32_t violations = 0;
+  for (size_t i = 0; i < block_violations_.size(); i++) {
+    if (block_sequences_[i] > oldest)
+      violations |= block_violations_[i];
+  }
+  return violations;
+}
+
+uint32_t ProtectiveField::zoneMask() const
+{
+  return (zones_.size() == ZONE_COUNT_MAX) ? ~(uint32_t)0 : ((uint32_t)1 << zones_.size()) - 1;
+}
+
+bool ProtectiveField::isComplete() const
+{
+  if (zones_.empty())
+    return true;
+  if (block_sequences_.empty())
+    return false;
+  uint64_t oldest = sequence_ - std::min(sequence_, (uint64_t)(2 * block_sequences_.size()));
+  for (uint64_t block_sequence : block_sequences_) {
+    if (block_sequence <= oldest)
+      return false;
+  }
+  return true;
+}
+
+void ProtectiveField::reset()
+{
+  std::fill(block_violations_.begin(), block_violations_.end(), 0);
+  std::fill(block_sequences_.begin(), block_sequences_.end(), 0);
+}
+
+}
@@ -0,0 +1,192 @@
+#include "ldcp/raw_scan_frame.h"
+
+#include <algorithm>
+
+namespace ldcp_sdk
+{
+
+RawScanBlock::RawScanBlock()
+  : host_timestamp(0)
+{
+}
+
+RawScanBlock::RawScanBlock(PacketPointer oob_packet)
+  : host_timestamp(0)
+  , oob_packet_(oob_packet)
+{
+}
+
+bool RawScanBlock::isValid() const
+{
+  if (!oob_packet_ || oob_packet_->size() < sizeof(OobPacketHeader))
+    return false;
+  size_t sample_size = (intensityWidth() == INTENSITY_WIDTH_16BIT) ? 4 : 3;
+  return oob_packet_->size() >= sizeof(OobPacketHeader) + blockLength() * sample_size;
+}
+
+int RawScanBlock::blockIndex() const
+{
+  return header()->block_index;
+}
+
+int RawScanBlock::blockCount() const
+{
+  return (header()->block_count != 0) ? header()->block_count : 8;
+}
+
+int RawScanBlock::blockLength() const
+{
+  return header()->block_length;
+}
+
+unsigned int RawScanBlock::timestamp() const
+{
+  return header()->timestamp;
+}
+
+angular_fov_t RawScanBlock::angularFov() const
+{
+  return (header()->flags.angular_fov == 0) ? ANGULAR_FOV_270DEG : ANGULAR_FOV_360DEG;
+}
+
+int RawScanBlock::intensityWidth() const
+{
+  return header()->flags.payload_layout.intensity_width;
+}
+
+int RawScanBlock::range(int index) const
+{
+  return ranges()[index];
+}
+
+int RawScanBlock::intensity(int index) const
+{
+  const uint16_t* end_of_ranges = ranges() + blockLength();
+  if (intensityWidth() == INTENSITY_WIDTH_16BIT)
+    return end_of_ranges[index];
+  else
+    return reinterpret_cast<const uint8_t*>(end_of_ranges)[index];
+}
+
+void RawScanBlock::decodeRanges(int begin, int end, int* ranges) const
+{
+  const uint16_t* source = this->ranges();
+  for (int i = begin; i < end; i++)
+    ranges[i - begin] = source[i];
+}
+
+void RawScanBlock::decodeIntensities(int begin, int end, int* intensities) const
+{
+  const uint16_t* end_of_ranges = ranges() + blockLength();
+  if (intensityWidth() == INTENSITY_WIDTH_16BIT) {
+    for (int i = begin; i < end; i++)
+      intensities[i - begin] = end_of_ranges[i];
+  }
+  else {
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(end_of_ranges);
+    for (int i = begin; i < end; i++)
+      intensities[i - begin] = source[i];
+  }
+}
+
+void RawScanBlock::decode(ScanBlock& scan_block) const
+{
+  scan_block.block_index = blockIndex();
+  scan_block.block_count = blockCount();
+  scan_block.block_length = blockLength();
+  scan_block.timestamp = timestamp();
+  scan_block.host_timestamp = host_timestamp;
+  scan_block.angular_fov = angularFov();
+  scan_block.layers.resize(1);
+  scan_block.layers[0].ranges.resize(scan_block.block_length);
+  scan_block.layers[0].intensities.resize(scan_block.block_length);
+  decodeRanges(0, scan_block.block_length, scan_block.layers[0].ranges.data());
+  decodeIntensities(0, scan_block.block_length, scan_block.layers[0].intensities.data());
+}
+
+const OobPacketHeader* RawScanBlock::header() const
+{
+  return reinterpret_cast<const OobPacketHeader*>(oob_packet_->data());
+}
+
+const uint16_t* RawScanBlock::ranges() const
+{
+  return reinterpret_cast<const uint16_t*>(header() + 1);
+}
+
+RawScanFrame::RawScanFrame()
+  : host_timestamp(0)
+{
+}
+
+int RawScanFrame::beamCount() const
+{
+  return blocks.empty() ? 0 : (int)blocks.size() * blocks[0].blockLength();
+}
+
+unsigned int RawScanFrame::timestamp() const
+{
+  return blocks.empty() ? 0 : blocks[0].timestamp();
+}
+
+angular_fov_t RawScanFrame::angularFov() const
+{
+  return blocks.empty() ? ANGULAR_FOV_270DEG : blocks[0].angularFov();
+}
+
+int RawScanFrame::range(int beam_index) const
+{
+  int block_length = blocks[0].blockLength();
+  return blocks[beam_index / block_length].range(beam_index % block_length);
+}
+
+int RawScanFrame::intensity(int beam_index) const
+{
+  int block_length = blocks[0].blockLength();
+  return blocks[beam_index / block_length].intensity(beam_index % block_length);
+}
+
+void RawScanFrame::decodeRanges(int begin, int end, int* ranges) const
+{
+  int block_length = blocks[0].blockLength();
+  for (int i = begin; i < end; ) {
+    int block_begin = i % block_length;
+    int count = std::min(end - i, block_length - block_begin);
+    blocks[i / block_length].decodeRanges(block_begin, block_begin + count, ranges + (i - begin));
+    i += count;
+  }
+}
+
+void RawScanFrame::decodeIntensities(int begin, int end, int* intensities) const
+{
+  int block_length = blocks[0].blockLength();
+  for (int i = begin; i < end; ) {
+    int block_begin = i % block_length;
+    int count = std::min(end - i, block_length - block_begin);
+    blocks[i / block_length].decodeIntensities(block_begin, block_begin + count, intensities + (i - begin));
+    i += count;
+  }
+}
+
+void RawScanFrame::decode(ScanFrame& scan_frame) const
+{
+  int beam_count = beamCount();
+  scan_frame.timestamp = timestamp();
+  scan_frame.host_timestamp = host_timestamp;
+  scan_frame.angular_fov = angularFov();
+  scan_frame.block_timestamps.resize(blocks.size());
+  scan_frame.block_host_timestamps.resize(blocks.size());
+  for (size_t i = 0; i < blocks.size(); i++) {
+    scan_frame.block_timestamps[i] = blocks[i].timestamp();
+    scan_frame.block_host_timestamps[i] = blocks[i].host_timestamp;
+  }
+  scan_frame.layers.resize(1);
+  scan_frame.layers[0].ranges.resize(beam_count);
+  scan_frame.layers[0].intensities.resize(beam_count);
+  if (beam_count > 0) {
+    decodeRanges(0, beam_count, scan_frame.layers[0].ranges.data());
+    decodeIntensities(0, beam_count, scan_frame.layers[0].intensities.data());
+  }
+}
+
+}
@@ -0,0 +1,162 @@
+#include "ldcp/reflector_detector.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace ldcp_sdk
+{
+
+ReflectorDetector::ReflectorDetector()
+  : threshold_(200)
+  , min_beam_count_(2)
+  , max_beam_count_(INT_MAX)
+  , min_width_(0)
+  , max_width_(1.0f)
+  , max_range_jump_(100)
+  , radius_(0)
+{
+}
+
+void ReflectorDetector::setIntensityThreshold(int threshold)
+{
+  threshold_ = threshold;
+}
+
+void ReflectorDetector::setBeamCountLimits(int min_beam_count, int max_beam_count)
+{
+  min_beam_count_ = std::max(min_beam_count, 1);
+  max_beam_count_ = max_beam_count;
+}
+
+void ReflectorDetector::setWidthLimits(float min_width, float max_width)
+{
+  min_width_ = min_width;
+  max_width_ = max_width;
+}
+
+void ReflectorDetector::setMaxRangeJump(int jump)
+{
+  max_range_jump_ = jump;
+}
+
+void ReflectorDetector::setReflectorRadius(float radius)
+{
+  radius_ = radius;
+}
+
+void ReflectorDetector::process(const ScanFrame& scan_frame, std::vector<Reflector>& reflectors)
+{
+  reflectors.clear();
+  if (scan_frame.layers.empty())
+    return;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  const std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  int beam_count = (int)ranges.size();
+  if (beam_count == 0 || intensities.size() != ranges.size())
+    return;
+  geometry_.update(scan_frame.angular_fov, beam_count);
+
+  collectRuns(ranges.data(), intensities.data(), beam_count);
+
+  if (scan_frame.angular_fov == ANGULAR_FOV_360DEG && runs_.size() > 1 &&
+      runs_.front().begin == 0 && runs_.back().end == beam_count &&
+      std::abs(ranges[0] - ranges[beam_count - 1]) <= max_range_jump_) {
+    Run& first = runs_.front();
+    Run& last = runs_.back();
+    last.end = first.end + beam_count;
+    last.weight_sum += first.weight_sum;
+    last.index_sum += first.index_sum + first.weight_sum * beam_count;
+    last.range_sum += first.range_sum;
+    last.peak_intensity = std::max(last.peak_intensity, first.peak_intensity);
+    first.end = first.begin;
+  }
+
+  Reflector reflector;
+  for (const Run& run : runs_) {
+    if (finish(run, ranges.data(), beam_count, reflector))
+      reflectors.push_back(reflector);
+  }
+}
+
+void ReflectorDetector::collectRuns(const int* ranges, const int* intensities, int beam_count)
+{
+  mask_.resize(beam_count + sizeof(uint64_t));
+  uint8_t* mask = mask_.data();
+  const int threshold = threshold_;
+  for (int i = 0; i < beam_count; i++)
+    mask[i] = (uint8_t)((intensities[i] >= threshold) & (ranges[i] > 0));
+  std::memset(mask + beam_count, 0, sizeof(uint64_t));
+
+  runs_.clear();
+  Run run = Run();
+  bool in_run = false;
+  for (int i = 0; i < beam_count; ) {
+    if (!in_run) {
+      uint64_t word;
+      std::memcpy(&word, mask + i, sizeof(word));
+      if (word == 0) {
+        i += sizeof(word);
+        continue;
+      }
+    }
+
+    if (mask[i] && in_run && std::abs(ranges[i] - ranges[i - 1]) > max_range_jump_) {
+      runs_.push_back(run);
+      in_run = false;
+    }
+    if (mask[i]) {
+      if (!in_run) {
+        run = Run();
+        run.begin = i;
+        in_run = true;
+      }
+      double weight = intensities[i] - threshold + 1;
+      run.end = i + 1;
+      run.weight_sum += weight;
+      run.index_sum += weight * i;
+      run.range_sum += weight * ranges[i];
+      run.peak_intensity = std::max(run.peak_intensity, intensities[i]);
+    }
+    else if (in_run) {
+      runs_.push_back(run);
+      in_run = false;
+    }
+    i++;
+  }
+  if (in_run)
+    runs_.push_back(run);
+}
+
+bool ReflectorDetector::finish(const Run& run, const int* ranges, int beam_count, Reflector& reflector) const
+{
+  int run_length = run.end - run.begin;
+  if (run_length < min_beam_count_ || run_length > max_beam_count_)
+    return false;
+
+  int first = run.begin % beam_count, last = (run.end - 1) % beam_count;
+  const float* c = geometry_.cosines();
+  const float* s = geometry_.sines();
+  float first_range = ranges[first] * ScanGeometry::RANGE_SCALE;
+  float last_range = ranges[last] * ScanGeometry::RANGE_SCALE;
+  float width = std::hypot(first_range * c[first] - last_range * c[last],
+                           first_range * s[first] - last_range * s[last]);
+  if (width < min_width_ || width > max_width_)
+    return false;
+
+  reflector.begin = run.begin;
+  reflector.end = run.end;
+  reflector.beam_index = (float)(run.index_sum / run.weight_sum);
+  reflector.angle = (float)(ScanGeometry::startAngle(geometry_.angularFov()) +
+                            reflector.beam_index * geometry_.angleIncrement());
+  reflector.range = (float)(run.range_sum / run.weight_sum) * ScanGeometry::RANGE_SCALE + radius_;
+  reflector.x = reflector.range * std::cos(reflector.angle);
+  reflector.y = reflector.range * std::sin(reflector.angle);
+  reflector.width = width;
+  reflector.peak_intensity = run.peak_intensity;
+  return true;
+}
+
+}
@@ -0,0 +1,174 @@
+#include "ldcp/scan_filter.h"
+#include "ldcp/scan_geometry.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+struct FilterParameters
+{
+  int min_range, max_range;
+  int min_intensity, max_intensity;
+  float sin_increment, cos_increment, tan_shadow_angle;
+};
+
+static inline int filterBeam(const FilterParameters& parameters, int range, int previous_range,
+                             int next_range, int intensity)
+{
+  float previous_y = previous_range * parameters.sin_increment;
+  float previous_x = range - previous_range * parameters.cos_increment;
+  float next_y = next_range * parameters.sin_increment;
+  float next_x = range - next_range * parameters.cos_increment;
+
+  bool keep = (range > 0) & (range >= parameters.min_range) & (range <= parameters.max_range) &
+              (intensity >= parameters.min_intensity) & (intensity <= parameters.max_intensity);
+  bool shadow = ((previous_range > 0) & (previous_y < parameters.tan_shadow_angle * std::fabs(previous_x))) |
+                ((next_range > 0) & (next_y < parameters.tan_shadow_angle * std::fabs(next_x)));
+  return (keep & !shadow) ? range : 0;
+}
+
+static inline int median3(int a, int b, int c)
+{
+  return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+static inline int median5(int a, int b, int c, int d, int e)
+{
+  return median3(e, std::max(std::min(a, b), std::min(c, d)), std::min(std::max(a, b), std::max(c, d)));
+}
+
+static void filterBeams(const FilterParameters& parameters, const int* ranges, const int* intensities,
+                        int first, int last, int beam_count, int left_range, int* output)
+{
+  int right_range = (last < beam_count) ? ranges[last] : 0;
+  if (last - first == 1) {
+    output[0] = filterBeam(parameters, ranges[first], left_range, right_range,
+                           intensities ? intensities[first] : 0);
+    return;
+  }
+
+  output[0] = filterBeam(parameters, ranges[first], left_range, ranges[first + 1],
+                         intensities ? intensities[first] : 0);
+  if (intensities) {
+    for (int i = first + 1; i < last - 1; i++)
+      output[i - first] = filterBeam(parameters, ranges[i], ranges[i - 1], ranges[i + 1], intensities[i]);
+  }
+  else {
+    for (int i = first + 1; i < last - 1; i++)
+      output[i - first] = filterBeam(parameters, ranges[i], ranges[i - 1], ranges[i + 1], 0);
+  }
+  output[last - 1 - first] = filterBeam(parameters, ranges[last - 1], ranges[last - 2], right_range,
+                                        intensities ? intensities[last - 1] : 0);
+}
+
+ScanFilter::ScanFilter()
+  : min_range_(0), max_range_(INT_MAX)
+  , min_intensity_(0), max_intensity_(INT_MAX)
+  , shadow_angle_(0)
+  , median_window_(1)
+{
+}
+
+void ScanFilter::setRangeLimits(int min_range, int max_range)
+{
+  min_range_ = min_range;
+  max_range_ = max_range;
+}
+
+void ScanFilter::setIntensityLimits(int min_intensity, int max_intensity)
+{
+  min_intensity_ = min_intensity;
+  max_intensity_ = max_intensity;
+}
+
+void ScanFilter::setShadowAngle(double min_angle)
+{
+  shadow_angle_ = min_angle;
+}
+
+void ScanFilter::setMedianWindow(int window)
+{
+  median_window_ = (window >= 5) ? 5 : (window >= 3) ? 3 : 1;
+}
+
+void ScanFilter::apply(ScanFrame& scan_frame)
+{
+  if (scan_frame.layers.empty())
+    return;
+
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  int beam_count = (int)ranges.size();
+  if (beam_count == 0)
+    return;
+  apply(ranges.data(), (intensities.size() == ranges.size()) ? intensities.data() : nullptr, beam_count,
+        ScanGeometry::fieldOfView(scan_frame.angular_fov) / beam_count);
+}
+
+void ScanFilter::apply(int* ranges, int* intensities, int beam_count, double angle_increment)
+{
+  FilterParameters parameters;
+  parameters.min_range = min_range_;
+  parameters.max_range = max_range_;
+  parameters.min_intensity = intensities ? min_intensity_ : INT_MIN;
+  parameters.max_intensity = intensities ? max_intensity_ : INT_MAX;
+  parameters.sin_increment = (float)std::sin(angle_increment);
+  parameters.cos_increment = (float)std::cos(angle_increment);
+  parameters.tan_shadow_angle = (float)std::tan(shadow_angle_);
+
+  // scratch[j] holds the kept range of beam begin - radius + j. The last
+  // 2 * radius entries of a tile are carried over as the head of the next.
+  const int radius = median_window_ / 2;
+  scratch_.assign(TILE_LENGTH + 2 * radius, 0);
+  int* scratch = scratch_.data();
+  int left_range = 0;
+
+  for (int begin = 0; begin < beam_count; begin += TILE_LENGTH) {
+    int end = std::min(begin + TILE_LENGTH, beam_count);
+    if (begin > 0)
+      std::copy(scratch + TILE_LENGTH, scratch + TILE_LENGTH + 2 * radius, scratch);
+
+    int first = (begin == 0) ? 0 : begin + radius;
+    int last = std::min(end + radius, beam_count);
+    if (first < last) {
+      filterBeams(parameters, ranges, intensities, first, last, beam_count, left_range,
+                  scratch + (first - begin + radius));
+      left_range = ranges[last - 1];
+    }
+    std::fill(scratch + std::max(last, first) - begin + radius, scratch + end - begin + 2 * radius, 0);
+
+    int length = end - begin;
+    if (radius == 0) {
+      for (int i = 0; i < length; i++)
+        ranges[begin + i] = scratch[i];
+    }
+    else if (radius == 1) {
+      for (int i = 0; i < length; i++) {
+        int c = scratch[i + 1];
+        int a = (scratch[i] > 0) ? scratch[i] : c;
+        int b = (scratch[i + 2] > 0) ? scratch[i + 2] : c;
+        ranges[begin + i] = (c > 0) ? median3(a, b, c) : 0;
+      }
+    }
+    else {
+      for (int i = 0; i < length; i++) {
+        int c = scratch[i + 2];
+        int a = (scratch[i] > 0) ? scratch[i] : c;
+        int b = (scratch[i + 1] > 0) ? scratch[i + 1] : c;
+        int d = (scratch[i + 3] > 0) ? scratch[i + 3] : c;
+        int e = (scratch[i + 4] > 0) ? scratch[i + 4] : c;
+        ranges[begin + i] = (c > 0) ? median5(a, b, d, e, c) : 0;
+      }
+    }
+
+    if (intensities) {
+      for (int i = begin; i < end; i++)
+        intensities[i] = (ranges[i] > 0) ? intensities[i] : 0;
+    }
+  }
+}
+
+}
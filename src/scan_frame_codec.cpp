@@ -0,0 +1,234 @@
+#include "ldcp/scan_frame_codec.h"
+
+#include <cstring>
+
+namespace ldcp_sdk
+{
+
+static const uint32_t SIGNATURE = 0x4653444c;
+static const uint8_t VERSION = 1;
+static const int VALUES_PER_LANE = ScanFrameCodec::CHUNK_LENGTH / ScanFrameCodec::LANE_COUNT;
+static const int LANES = ScanFrameCodec::LANE_COUNT;
+
+template<typename T>
+static void append(std::vector<uint8_t>& data, const T& value)
+{
+  size_t offset = data.size();
+  data.resize(offset + sizeof(T));
+  std::memcpy(&data[offset], &value, sizeof(T));
+}
+
+template<typename T>
+static bool extract(const uint8_t*& data, const uint8_t* end, T& value)
+{
+  if ((size_t)(end - data) < sizeof(T))
+    return false;
+  std::memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return true;
+}
+
+static int bitWidth(uint32_t value)
+{
+  int width = 0;
+  while (value != 0) {
+    width++;
+    value >>= 1;
+  }
+  return width;
+}
+
+static size_t wordCount(int width)
+{
+  return (size_t)(width * VALUES_PER_LANE + 31) / 32 * LANES;
+}
+
+static void packChunk(const uint32_t* values, int width, uint32_t* words)
+{
+  size_t word_count = wordCount(width);
+  for (size_t i = 0; i < word_count; i++)
+    words[i] = 0;
+
+  for (int j = 0; j < VALUES_PER_LANE; j++) {
+    int shift = (j * width) % 32;
+    uint32_t* output = words + (j * width) / 32 * LANES;
+    const uint32_t* input = values + j * LANES;
+    for (int lane = 0; lane < LANES; lane++)
+      output[lane] |= input[lane] << shift;
+    if (shift + width > 32) {
+      uint32_t* spill = output + LANES;
+      for (int lane = 0; lane < LANES; lane++)
+        spill[lane] |= input[lane] >> (32 - shift);
+    }
+  }
+}
+
+static void unpackChunk(const uint32_t* words, int width, uint32_t* values)
+{
+  uint32_t mask = (width == 32) ? 0xffffffff : ((1u << width) - 1);
+  for (int j = 0; j < VALUES_PER_LANE; j++) {
+    int shift = (j * width) % 32;
+    const uint32_t* input = words + (j * width) / 32 * LANES;
+    uint32_t* output = values + j * LANES;
+    if (width == 0) {
+      for (int lane = 0; lane < LANES; lane++)
+        output[lane] = 0;
+      continue;
+    }
+    for (int lane = 0; lane < LANES; lane++)
+      output[lane] = input[lane] >> shift;
+    if (shift + width > 32) {
+      const uint32_t* spill = input + LANES;
+      for (int lane = 0; lane < LANES; lane++)
+        output[lane] |= spill[lane] << (32 - shift);
+    }
+    for (int lane = 0; lane < LANES; lane++)
+      output[lane] &= mask;
+  }
+}
+
+void ScanFrameCodec::encode(const ScanFrame& scan_frame, std::vector<uint8_t>& data)
+{
+  data.clear();
+  append(data, SIGNATURE);
+  append(data, VERSION);
+  append(data, (uint8_t)scan_frame.angular_fov);
+  append(data, (uint8_t)scan_frame.layers.size());
+  append(data, (uint8_t)0);
+  append(data, (uint32_t)scan_frame.timestamp);
+  append(data, scan_frame.host_timestamp);
+
+  uint32_t block_count = (uint32_t)scan_frame.block_timestamps.size();
+  append(data, block_count);
+  for (uint32_t i = 0; i < block_count; i++)
+    append(data, (uint32_t)scan_frame.block_timestamps[i]);
+  for (uint32_t i = 0; i < block_count; i++)
+    append(data, (i < scan_frame.block_host_timestamps.size()) ? scan_frame.block_host_timestamps[i] : (int64_t)0);
+
+  for (const ScanFrame::FrameData& layer : scan_frame.layers) {
+    encodeChannel(layer.ranges, true, data);
+    encodeChannel(layer.intensities, false, data);
+  }
+}
+
+error_t ScanFrameCodec::decode(const uint8_t* data, size_t length, ScanFrame& scan_frame)
+{
+  const uint8_t* end = data + length;
+
+  uint32_t signature, timestamp, block_count;
+  uint8_t version, angular_fov, layer_count, reserved;
+  if (!extract(data, end, signature) || signature != SIGNATURE ||
+      !extract(data, end, version) || version != VERSION ||
+      !extract(data, end, angular_fov) || !extract(data, end, layer_count) || !extract(data, end, reserved) ||
+      !extract(data, end, timestamp) || !extract(data, end, scan_frame.host_timestamp) ||
+      !extract(data, end, block_count) || (uint64_t)(end - data) < (uint64_t)block_count * 12)
+    return error_t::invalid_params;
+
+  scan_frame.timestamp = timestamp;
+  scan_frame.angular_fov = (angular_fov_t)angular_fov;
+  scan_frame.block_timestamps.resize(block_count);
+  scan_frame.block_host_timestamps.resize(block_count);
+  for (uint32_t i = 0; i < block_count; i++) {
+    extract(data, end, timestamp);
+    scan_frame.block_timestamps[i] = timestamp;
+  }
+  for (uint32_t i = 0; i < block_count; i++)
+    extract(data, end, scan_frame.block_host_timestamps[i]);
+
+  scan_frame.layers.resize(layer_count);
+  for (ScanFrame::FrameData& layer : scan_frame.layers) {
+    if (!decodeChannel(data, end, true, layer.ranges) ||
+        !decodeChannel(data, end, false, layer.intensities))
+      return error_t::invalid_params;
+  }
+
+  return error_t::no_error;
+}
+
+void ScanFrameCodec::encodeChannel(const std::vector<int>& values, bool delta, std::vector<uint8_t>& data)
+{
+  uint32_t count = (uint32_t)values.size();
+  uint32_t chunk_count = (count + CHUNK_LENGTH - 1) / CHUNK_LENGTH;
+  append(data, count);
+
+  residuals_.assign((size_t)chunk_count * CHUNK_LENGTH, 0);
+  const int* input = values.data();
+  uint32_t* residuals = residuals_.data();
+  if (delta) {
+    for (uint32_t i = 0; i < count && i < (uint32_t)LANES; i++)
+      residuals[i] = ((uint32_t)input[i] << 1) ^ (uint32_t)(input[i] >> 31);
+    for (uint32_t i = LANES; i < count; i++) {
+      int difference = input[i] - input[i - LANES];
+      residuals[i] = ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+    }
+  }
+  else {
+    for (uint32_t i = 0; i < count; i++)
+      residuals[i] = (uint32_t)input[i];
+  }
+
+  size_t widths_offset = data.size();
+  data.resize(widths_offset + chunk_count);
+  for (uint32_t k = 0; k < chunk_count; k++) {
+    const uint32_t* chunk = residuals + (size_t)k * CHUNK_LENGTH;
+    uint32_t bits = 0;
+    for (int i = 0; i < CHUNK_LENGTH; i++)
+      bits |= chunk[i];
+    int width = bitWidth(bits);
+    data[widths_offset + k] = (uint8_t)width;
+
+    size_t word_count = wordCount(width);
+    words_.resize(word_count);
+    packChunk(chunk, width, words_.data());
+    size_t offset = data.size();
+    data.resize(offset + word_count * sizeof(uint32_t));
+    if (word_count > 0)
+      std::memcpy(&data[offset], words_.data(), word_count * sizeof(uint32_t));
+  }
+}
+
+bool ScanFrameCodec::decodeChannel(const uint8_t*& data, const uint8_t* end, bool delta, std::vector<int>& values)
+{
+  // Every chunk takes at least its width byte, so the count is checked
+  // against the remaining data before anything is allocated
+  uint32_t count;
+  if (!extract(data, end, count) || count > (uint32_t)BEAM_COUNT_MAX)
+    return false;
+  uint32_t chunk_count = (uint32_t)(((uint64_t)count + CHUNK_LENGTH - 1) / CHUNK_LENGTH);
+  if ((uint64_t)(end - data) < chunk_count)
+    return false;
+
+  const uint8_t* widths = data;
+  data += chunk_count;
+
+  residuals_.resize((size_t)chunk_count * CHUNK_LENGTH);
+  for (uint32_t k = 0; k < chunk_count; k++) {
+    int width = widths[k];
+    size_t word_count = wordCount(width);
+    if (width > 32 || (size_t)(end - data) < word_count * sizeof(uint32_t))
+      return false;
+    words_.resize(word_count);
+    if (word_count > 0)
+      std::memcpy(words_.data(), data, word_count * sizeof(uint32_t));
+    data += word_count * sizeof(uint32_t);
+    unpackChunk(words_.data(), width, residuals_.data() + (size_t)k * CHUNK_LENGTH);
+  }
+
+  values.resize(count);
+  int* output = values.data();
+  const uint32_t* residuals = residuals_.data();
+  if (delta) {
+    for (uint32_t i = 0; i < count; i++)
+      output[i] = (int)(residuals[i] >> 1) ^ -(int)(residuals[i] & 1);
+    for (uint32_t i = LANES; i < count; i++)
+      output[i] += output[i - LANES];
+  }
+  else {
+    for (uint32_t i = 0; i < count; i++)
+      output[i] = (int)residuals[i];
+  }
+
+  return true;
+}
+
+}
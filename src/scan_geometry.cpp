@@ -0,0 +1,136 @@
+#include "ldcp/scan_geometry.h"
+
+#include <cmath>
+#include <limits>
+
+namespace ldcp_sdk
+{
+
+double ScanGeometry::fieldOfView(angular_fov_t angular_fov)
+{
+  return (angular_fov == ANGULAR_FOV_360DEG) ? 2 * PI : 1.5 * PI;
+}
+
+double ScanGeometry::startAngle(angular_fov_t angular_fov)
+{
+  return -fieldOfView(angular_fov) / 2;
+}
+
+int ScanGeometry::beamCount(scan_resolution_t resolution, angular_fov_t angular_fov)
+{
+  int beams_per_revolution = 0;
+  switch (resolution) {
+    case SCAN_RESOLUTION_120K:
+      beams_per_revolution = 120000;
+      break;
+    case SCAN_RESOLUTION_90K:
+      beams_per_revolution = 90000;
+      break;
+    case SCAN_RESOLUTION_60K:
+      beams_per_revolution = 60000;
+      break;
+    case SCAN_RESOLUTION_30K:
+      beams_per_revolution = 30000;
+      break;
+    case SCAN_RESOLUTION_15K:
+      beams_per_revolution = 15000;
+      break;
+  }
+  return (angular_fov == ANGULAR_FOV_360DEG) ? beams_per_revolution : beams_per_revolution * 3 / 4;
+}
+
+ScanGeometry::ScanGeometry()
+  : angular_fov_(ANGULAR_FOV_270DEG)
+  , beam_count_(0)
+  , start_angle_(0)
+  , inverse_increment_(0)
+{
+}
+
+void ScanGeometry::update(angular_fov_t angular_fov, int beam_count)
+{
+  if (angular_fov == angular_fov_ && beam_count == beam_count_)
+    return;
+
+  angular_fov_ = angular_fov;
+  beam_count_ = beam_count;
+  start_angle_ = (float)startAngle(angular_fov);
+  inverse_increment_ = (beam_count > 0) ? (float)(1.0 / angleIncrement()) : 0.0f;
+  cosines_.resize(beam_count);
+  sines_.resize(beam_count);
+  for (int i = 0; i < beam_count; i++) {
+    double beam_angle = angle(i);
+    cosines_[i] = (float)std::cos(beam_angle);
+    sines_[i] = (float)std::sin(beam_angle);
+  }
+}
+
+angular_fov_t ScanGeometry::angularFov() const
+{
+  return angular_fov_;
+}
+
+int ScanGeometry::beamCount() const
+{
+  return beam_count_;
+}
+
+double ScanGeometry::angleIncrement() const
+{
+  return (beam_count_ > 0) ? fieldOfView(angular_fov_) / beam_count_ : 0;
+}
+
+double ScanGeometry::angle(int beam_index) const
+{
+  return startAngle(angular_fov_) + beam_index * angleIncrement();
+}
+
+int ScanGeometry::beamIndex(double angle) const
+{
+  if (beam_count_ == 0)
+    return -1;
+
+  double offset = angle - startAngle(angular_fov_);
+  offset -= 2 * PI * std::floor(offset / (2 * PI));
+  int beam_index = (int)std::floor(offset / angleIncrement());
+  if (angular_fov_ == ANGULAR_FOV_360DEG)
+    return beam_index % beam_count_;
+  else
+    return (beam_index < beam_count_) ? beam_index : -1;
+}
+
+const float* ScanGeometry::cosines() const
+{
+  return cosines_.data();
+}
+
+const float* ScanGeometry::sines() const
+{
+  return sines_.data();
+}
+
+void ScanGeometry::toPointCloud(const ScanFrame& scan_frame, PointCloud& point_cloud)
+{
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  update(scan_frame.angular_fov, beam_count);
+
+  point_cloud.host_timestamp = scan_frame.host_timestamp;
+  point_cloud.x.resize(beam_count);
+  point_cloud.y.resize(beam_count);
+  point_cloud.intensities = scan_frame.layers[0].intensities;
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const int* r = ranges.data();
+  const float* c = cosines_.data();
+  const float* s = sines_.data();
+  float* x = point_cloud.x.data();
+  float* y = point_cloud.y.data();
+  for (int i = 0; i < beam_count; i++) {
+    float range = r[i] * RANGE_SCALE;
+    x[i] = (r[i] > 0) ? range * c[i] : nan;
+    y[i] = (r[i] > 0) ? range * s[i] : nan;
+  }
+}
+
+}
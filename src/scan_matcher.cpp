@@ -0,0 +1,494 @@
+#include "ldcp/scan_matcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static const int LEVEL_FACTOR = 4;
+static const int MIN_CORRESPONDENCE_COUNT = 20;
+static const int COARSE_POINT_COUNT = 512;
+static const int SUM_COUNT = 6;
+static const double MAX_FLATNESS = 0.1;
+
+static double normalizeAngle(double angle)
+{
+  return angle - 2 * PI * std::floor((angle + PI) / (2 * PI));
+}
+
+static bool solve(const double h[9], const double g[3], double x[3])
+{
+  double a[9];
+  std::copy(h, h + 9, a);
+  double damping = 1e-9 * (a[0] + a[4] + a[8]);
+  a[0] += damping;
+  a[4] += damping;
+  a[8] += damping;
+
+  double c0 = a[4] * a[8] - a[5] * a[7];
+  double c1 = a[5] * a[6] - a[3] * a[8];
+  double c2 = a[3] * a[7] - a[4] * a[6];
+  double det = a[0] * c0 + a[1] * c1 + a[2] * c2;
+  if (!(std::fabs(det) > 0))
+    return false;
+
+  double inverse[9] = {
+    c0, a[2] * a[7] - a[1] * a[8], a[1] * a[5] - a[2] * a[4],
+    c1, a[0] * a[8] - a[2] * a[6], a[2] * a[3] - a[0] * a[5],
+    c2, a[1] * a[6] - a[0] * a[7], a[0] * a[4] - a[1] * a[3]
+  };
+  for (int i = 0; i < 3; i++)
+    x[i] = (inverse[i * 3] * g[0] + inverse[i * 3 + 1] * g[1] + inverse[i * 3 + 2] * g[2]) / det;
+  return true;
+}
+
+ScanMatcher::ScanMatcher()
+  : level_count_(LEVEL_COUNT_MAX)
+  , search_linear_(0.2)
+  , search_angular_(0.1)
+  , search_step_(0.05)
+  , max_distance_(0.1f)
+  , max_iterations_(8)
+  , normal_radius_(0.1f)
+  , built_level_count_(0)
+  , has_reference_(false)
+  , motion_()
+  , pose_()
+{
+}
+
+void ScanMatcher::setLevelCount(int count)
+{
+  level_count_ = (count < 1) ? 1 : (count > LEVEL_COUNT_MAX ? LEVEL_COUNT_MAX : count);
+  has_reference_ = false;
+}
+
+void ScanMatcher::setSearchWindow(double linear, double angular, double linear_step)
+{
+  search_linear_ = std::max(linear, 0.0);
+  search_angular_ = std::max(angular, 0.0);
+  search_step_ = (linear_step > 0) ? linear_step : search_step_;
+}
+
+void ScanMatcher::setMaxCorrespondenceDistance(float distance)
+{
+  max_distance_ = distance;
+}
+
+void ScanMatcher::setNormalRadius(float radius)
+{
+  normal_radius_ = radius;
+}
+
+void ScanMatcher::setMaxIterations(int count)
+{
+  max_iterations_ = std::max(count, 1);
+}
+
+void ScanMatcher::reset()
+{
+  has_reference_ = false;
+  motion_ = Pose2D();
+  pose_ = Pose2D();
+}
+
+const Pose2D& ScanMatcher::pose() const
+{
+  return pose_;
+}
+
+error_t ScanMatcher::process(Device& device, ScanMatch& match)
+{
+  error_t result = device.readScanFrame(frame_);
+  if (result != error_t::no_error)
+    return result;
+  return process(frame_, match);
+}
+
+error_t ScanMatcher::process(const ScanFrame& scan_frame, ScanMatch& match)
+{
+  match = ScanMatch();
+  if (scan_frame.layers.empty() || scan_frame.layers[0].ranges.empty())
+    return error_t::invalid_params;
+
+  int beam_count = (int)scan_frame.layers[0].ranges.size();
+  if (beam_count != geometry_.beamCount() || scan_frame.angular_fov != geometry_.angularFov())
+    has_reference_ = false;
+  geometry_.update(scan_frame.angular_fov, beam_count);
+
+  buildLevels(scan_frame, current_);
+  if (!has_reference_) {
+    std::swap(reference_, current_);
+    has_reference_ = true;
+    motion_ = Pose2D();
+    return error_t::no_error;
+  }
+
+  Pose2D estimate = motion_;
+  correlativeSearch(reference_[built_level_count_ - 1], current_[built_level_count_ - 1], estimate);
+
+  double hessian[9] = {0};
+  double residual_sum = 0;
+  int count = 0;
+  for (int level = built_level_count_ - 1; level >= 0; level--) {
+    float max_distance = max_distance_ * (float)(1 << level);
+    count = refine(reference_[level], current_[level], max_distance, estimate, hessian, residual_sum);
+  }
+
+  if (count >= MIN_CORRESPONDENCE_COUNT) {
+    double variance = residual_sum / std::max(count - 3, 1);
+    double covariance[9];
+    double unit[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    bool solved = true;
+    for (int j = 0; j < 3 && solved; j++) {
+      double column[3];
+      solved = solve(hessian, unit[j], column);
+      for (int i = 0; i < 3; i++)
+        covariance[i * 3 + j] = column[i] * variance;
+    }
+    if (solved) {
+      match.pose = estimate;
+      std::copy(covariance, covariance + 9, match.covariance);
+      match.correspondence_count = count;
+      match.residual = std::sqrt(residual_sum / count);
+      match.valid = true;
+    }
+  }
+
+  if (match.valid) {
+    motion_ = estimate;
+    double c = std::cos(pose_.theta), s = std::sin(pose_.theta);
+    pose_.x += c * estimate.x - s * estimate.y;
+    pose_.y += s * estimate.x + c * estimate.y;
+    pose_.theta = normalizeAngle(pose_.theta + estimate.theta);
+  }
+  else
+    motion_ = Pose2D();
+
+  std::swap(reference_, current_);
+  return error_t::no_error;
+}
+
+void ScanMatcher::buildLevels(const ScanFrame& scan_frame, std::vector<Level>& levels)
+{
+  const int* ranges = scan_frame.layers[0].ranges.data();
+  const int beam_count = geometry_.beamCount();
+  const float* c = geometry_.cosines();
+  const float* s = geometry_.sines();
+  const bool closed = (scan_frame.angular_fov == ANGULAR_FOV_360DEG);
+  const float increment = (float)geometry_.angleIncrement();
+
+  levels.resize(level_count_);
+  built_level_count_ = 0;
+  int decimation = 1;
+  for (Level& level : levels) {
+    int count = (beam_count + decimation - 1) / decimation;
+    level.decimation = decimation;
+    level.x.resize(count);
+    level.y.resize(count);
+    level.normal_x.resize(count);
+    level.normal_y.resize(count);
+    level.valid.resize(count);
+    level.normal_valid.resize(count);
+
+    float* x = level.x.data();
+    float* y = level.y.data();
+    uint8_t* valid = level.valid.data();
+    if (decimation == 1) {
+      for (int i = 0; i < count; i++) {
+        float range = ranges[i] * ScanGeometry::RANGE_SCALE;
+        x[i] = range * c[i];
+        y[i] = range * s[i];
+        valid[i] = (uint8_t)(ranges[i] > 0);
+      }
+    }
+    else {
+      for (int j = 0; j < count; j++) {
+        int begin = j * decimation, end = std::min(begin + decimation, beam_count);
+        int nearest = -1;
+        for (int i = begin; i < end; i++) {
+          if (ranges[i] > 0 && (nearest < 0 || ranges[i] < ranges[nearest]))
+            nearest = i;
+        }
+        float range = (nearest >= 0) ? ranges[nearest] * ScanGeometry::RANGE_SCALE : 0.0f;
+        x[j] = (nearest >= 0) ? range * c[nearest] : 0.0f;
+        y[j] = (nearest >= 0) ? range * s[nearest] : 0.0f;
+        valid[j] = (uint8_t)(nearest >= 0);
+      }
+    }
+
+    computeNormals(level, closed, increment);
+    built_level_count_++;
+    if (count <= COARSE_POINT_COUNT)
+      break;
+    decimation *= LEVEL_FACTOR;
+  }
+}
+
+// Normals are fitted by total least squares to the points within the
+// normal radius on either side. Prefix sums let the window grow with the
+// range at no extra cost, which keeps the fit stable where adjacent beams
+// are closer together than the range noise. Windows straddling a corner or
+// a depth edge are not flat enough and leave the normal invalid.
+void ScanMatcher::computeNormals(Level& level, bool closed, float increment)
+{
+  const int count = (int)level.x.size();
+  const float* x = level.x.data();
+  const float* y = level.y.data();
+  const uint8_t* valid = level.valid.data();
+  float* normal_x = level.normal_x.data();
+  float* normal_y = level.normal_y.data();
+  uint8_t* normal_valid = level.normal_valid.data();
+
+  sums_.resize(SUM_COUNT * (count + 1));
+  double* prefix = sums_.data();
+  std::fill(prefix, prefix + SUM_COUNT, 0.0);
+  for (int j = 0; j < count; j++) {
+    const double* p = prefix + j * SUM_COUNT;
+    double* q = prefix + (j + 1) * SUM_COUNT;
+    double px = valid[j] ? x[j] : 0.0, py = valid[j] ? y[j] : 0.0;
+    q[0] = p[0] + valid[j];
+    q[1] = p[1] + px;
+    q[2] = p[2] + py;
+    q[3] = p[3] + px * px;
+    q[4] = p[4] + px * py;
+    q[5] = p[5] + py * py;
+  }
+
+  const float spacing = increment * level.decimation;
+  const int max_half_window = std::max(count / 8, 1);
+  for (int j = 0; j < count; j++) {
+    normal_valid[j] = 0;
+    if (!valid[j])
+      continue;
+
+    float range = std::sqrt(x[j] * x[j] + y[j] * y[j]);
+    int half_window = (int)(normal_radius_ / (range * spacing));
+    half_window = std::max(1, std::min(half_window, max_half_window));
+    int begin = j - half_window, end = j + half_window + 1;
+    if (!closed) {
+      begin = std::max(begin, 0);
+      end = std::min(end, count);
+    }
+
+    double s[SUM_COUNT];
+    for (int k = 0; k < SUM_COUNT; k++) {
+      if (begin < 0)
+        s[k] = prefix[count * SUM_COUNT + k] - prefix[(begin + count) * SUM_COUNT + k] + prefix[end * SUM_COUNT + k];
+      else if (end > count)
+        s[k] = prefix[count * SUM_COUNT + k] - prefix[begin * SUM_COUNT + k] + prefix[(end - count) * SUM_COUNT + k];
+      else
+        s[k] = prefix[end * SUM_COUNT + k] - prefix[begin * SUM_COUNT + k];
+    }
+    if (s[0] < 3)
+      continue;
+
+    double mean_x = s[1] / s[0], mean_y = s[2] / s[0];
+    double a = s[3] / s[0] - mean_x * mean_x;
+    double b = s[4] / s[0] - mean_x * mean_y;
+    double c = s[5] / s[0] - mean_y * mean_y;
+    double half_difference = (a - c) / 2;
+    double spread = std::sqrt(half_difference * half_difference + b * b);
+    double minor = (a + c) / 2 - spread, major = (a + c) / 2 + spread;
+    if (!(major > 0) || minor > MAX_FLATNESS * major)
+      continue;
+
+    double ex = (a > c) ? b : minor - c;
+    double ey = (a > c) ? minor - a : b;
+    double length = std::sqrt(ex * ex + ey * ey);
+    if (!(length > 0))
+      continue;
+    normal_x[j] = (float)(ex / length);
+    normal_y[j] = (float)(ey / length);
+    normal_valid[j] = 1;
+  }
+}
+
+// Transforms the current points by the pose and finds the reference point
+// at the bearing each one lands on. The pass has no branches and is left
+// to the vectorizer; the indices are -1 for invalid points and bearings
+// outside the field of view.
+void ScanMatcher::project(const Level& reference, const Level& current, const Pose2D& pose)
+{
+  const int count = (int)current.x.size();
+  const float c = (float)std::cos(pose.theta), s = (float)std::sin(pose.theta);
+  const float tx = (float)pose.x, ty = (float)pose.y;
+  const int decimation = reference.decimation;
+
+  projected_x_.resize(count);
+  projected_y_.resize(count);
+  indices_.resize(count);
+  const float* x = current.x.data();
+  const float* y = current.y.data();
+  const uint8_t* valid = current.valid.data();
+  float* qx = projected_x_.data();
+  float* qy = projected_y_.data();
+  int* indices = indices_.data();
+  for (int i = 0; i < count; i++) {
+    float px = c * x[i] - s * y[i] + tx;
+    float py = s * x[i] + c * y[i] + ty;
+    int index = geometry_.beamIndex(py, px, decimation);
+    qx[i] = px;
+    qy[i] = py;
+    indices[i] = valid[i] ? index : -1;
+  }
+}
+
+// Exhaustive search over the window around the predicted pose on the
+// coarsest level. Each candidate is scored by how close the projected
+// points land to the reference points in the beams they fall on.
+void ScanMatcher::correlativeSearch(const Level& reference, const Level& current, Pose2D& pose)
+{
+  if (search_linear_ <= 0 && search_angular_ <= 0)
+    return;
+
+  const int count = (int)current.x.size();
+  const float* x = current.x.data();
+  const float* y = current.y.data();
+  const uint8_t* valid = current.valid.data();
+  double range_sum = 0;
+  int valid_count = 0;
+  for (int i = 0; i < count; i++) {
+    range_sum += valid[i] ? std::sqrt(x[i] * x[i] + y[i] * y[i]) : 0.0f;
+    valid_count += valid[i];
+  }
+  if (valid_count == 0)
+    return;
+
+  // Rotating by one angular step moves a point at the mean range by about
+  // one linear step.
+  double angular_step = search_step_ / std::max(range_sum / valid_count, 1.0);
+  int angular_steps = (int)std::ceil(search_angular_ / angular_step);
+  int linear_steps = (int)std::ceil(search_linear_ / search_step_);
+  float sigma = (float)(2 * search_step_);
+  float inverse_sigma_squared = 1.0f / (sigma * sigma);
+
+  const float* rx = reference.x.data();
+  const float* ry = reference.y.data();
+  const uint8_t* reference_valid = reference.valid.data();
+
+  double best_score = -1;
+  Pose2D best = pose;
+  for (int a = -angular_steps; a <= angular_steps; a++) {
+    for (int u = -linear_steps; u <= linear_steps; u++) {
+      for (int v = -linear_steps; v <= linear_steps; v++) {
+        Pose2D candidate;
+        candidate.x = pose.x + u * search_step_;
+        candidate.y = pose.y + v * search_step_;
+        candidate.theta = pose.theta + a * angular_step;
+        project(reference, current, candidate);
+
+        const float* qx = projected_x_.data();
+        const float* qy = projected_y_.data();
+        const int* indices = indices_.data();
+        float score = 0;
+        for (int i = 0; i < count; i++) {
+          int j = indices[i];
+          if (j < 0 || !reference_valid[j])
+            continue;
+          float dx = qx[i] - rx[j], dy = qy[i] - ry[j];
+          score += std::max(0.0f, 1.0f - (dx * dx + dy * dy) * inverse_sigma_squared);
+        }
+        if (score > best_score) {
+          best_score = score;
+          best = candidate;
+        }
+      }
+    }
+  }
+  pose = best;
+}
+
+// Gauss-Newton on the point-to-line distances with Huber weights. Each
+// point is paired with the nearest of the three reference points around
+// the beam it projects onto. Returns the number of correspondences of the
+// last iteration, whose normal matrix and weighted squared residuals are
+// left in hessian and residual_sum.
+int ScanMatcher::refine(const Level& reference, const Level& current, float max_distance, Pose2D& pose,
+                        double hessian[9], double& residual_sum)
+{
+  const int count = (int)current.x.size();
+  const int reference_count = (int)reference.x.size();
+  const bool closed = (geometry_.angularFov() == ANGULAR_FOV_360DEG);
+  const float max_distance_squared = max_distance * max_distance;
+  const float huber = max_distance / 2;
+  const float* rx = reference.x.data();
+  const float* ry = reference.y.data();
+  const float* nx = reference.normal_x.data();
+  const float* ny = reference.normal_y.data();
+  const uint8_t* normal_valid = reference.normal_valid.data();
+
+  int correspondence_count = 0;
+  for (int iteration = 0; iteration < max_iterations_; iteration++) {
+    double h[9] = {0}, g[3] = {0};
+    double sum = 0;
+    correspondence_count = 0;
+
+    project(reference, current, pose);
+    const float* projected_x = projected_x_.data();
+    const float* projected_y = projected_y_.data();
+    const int* indices = indices_.data();
+    const float tx = (float)pose.x, ty = (float)pose.y;
+    for (int i = 0; i < count; i++) {
+      int center = indices[i];
+      if (center < 0)
+        continue;
+
+      float qx = projected_x[i], qy = projected_y[i];
+      float px = qx - tx, py = qy - ty;
+      int nearest = -1;
+      float nearest_distance = max_distance_squared;
+      for (int k = center - 1; k <= center + 1; k++) {
+        int j = k;
+        if (closed)
+          j = (j < 0) ? j + reference_count : (j >= reference_count ? j - reference_count : j);
+        else if (j < 0 || j >= reference_count)
+          continue;
+        if (!normal_valid[j])
+          continue;
+        float dx = qx - rx[j], dy = qy - ry[j];
+        float distance = dx * dx + dy * dy;
+        if (distance < nearest_distance) {
+          nearest_distance = distance;
+          nearest = j;
+        }
+      }
+      if (nearest < 0)
+        continue;
+
+      float r = nx[nearest] * (qx - rx[nearest]) + ny[nearest] * (qy - ry[nearest]);
+      float w = (std::fabs(r) <= huber) ? 1.0f : huber / std::fabs(r);
+      double j0 = nx[nearest], j1 = ny[nearest];
+      double j2 = ny[nearest] * px - nx[nearest] * py;
+      h[0] += w * j0 * j0;
+      h[1] += w * j0 * j1;
+      h[2] += w * j0 * j2;
+      h[4] += w * j1 * j1;
+      h[5] += w * j1 * j2;
+      h[8] += w * j2 * j2;
+      g[0] -= w * j0 * r;
+      g[1] -= w * j1 * r;
+      g[2] -= w * j2 * r;
+      sum += w * r * r;
+      correspondence_count++;
+    }
+    h[3] = h[1];
+    h[6] = h[2];
+    h[7] = h[5];
+
+    std::copy(h, h + 9, hessian);
+    residual_sum = sum;
+    double step[3];
+    if (correspondence_count < MIN_CORRESPONDENCE_COUNT || !solve(h, g, step))
+      break;
+    pose.x += step[0];
+    pose.y += step[1];
+    pose.theta = normalizeAngle(pose.theta + step[2]);
+    if (std::fabs(step[0]) + std::fabs(step[1]) < 1e-4 && std::fabs(step[2]) < 1e-5)
+      break;
+  }
+  return correspondence_count;
+}
+
+}
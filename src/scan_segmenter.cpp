@@ -0,0 +1,156 @@
+#include "ldcp/scan_segmenter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ldcp_sdk
+{
+
+static void beginSegment(ScanSegment& segment, int beam_index, float x, float y)
+{
+  segment.begin = beam_index;
+  segment.end = beam_index + 1;
+  segment.point_count = 1;
+  segment.centroid_x = x;
+  segment.centroid_y = y;
+  segment.min_x = segment.max_x = segment.first_x = segment.last_x = x;
+  segment.min_y = segment.max_y = segment.first_y = segment.last_y = y;
+}
+
+static void extendSegment(ScanSegment& segment, int beam_index, float x, float y)
+{
+  segment.end = beam_index + 1;
+  segment.point_count++;
+  segment.centroid_x += x;
+  segment.centroid_y += y;
+  segment.min_x = std::min(segment.min_x, x);
+  segment.min_y = std::min(segment.min_y, y);
+  segment.max_x = std::max(segment.max_x, x);
+  segment.max_y = std::max(segment.max_y, y);
+  segment.last_x = x;
+  segment.last_y = y;
+}
+
+ScanSegmenter::ScanSegmenter()
+  : lambda_(10 * 3.14159265358979323846 / 180)
+  , sigma_(0.01)
+  , min_point_count_(3)
+  , max_gap_(2)
+  , neighbour_ratio_(0)
+{
+}
+
+void ScanSegmenter::setBreakpointThreshold(double lambda, double sigma)
+{
+  lambda_ = lambda;
+  sigma_ = sigma;
+  neighbour_ratio_ = 0;
+}
+
+void ScanSegmenter::setMinPointCount(int count)
+{
+  min_point_count_ = std::max(count, 1);
+}
+
+void ScanSegmenter::setMaxGap(int gap)
+{
+  max_gap_ = std::max(gap, 0);
+}
+
+bool ScanSegmenter::connected(int previous_range, int gap, float distance_squared) const
+{
+  float ratio = neighbour_ratio_;
+  if (gap > 1) {
+    double angle = gap * geometry_.angleIncrement();
+    if (angle >= lambda_)
+      return false;
+    ratio = (float)(std::sin(angle) / std::sin(lambda_ - angle));
+  }
+  float threshold = previous_range * ScanGeometry::RANGE_SCALE * ratio + 3 * (float)sigma_;
+  return distance_squared <= threshold * threshold;
+}
+
+void ScanSegmenter::process(const ScanFrame& scan_frame, std::vector<ScanSegment>& segments)
+{
+  segments.clear();
+  if (scan_frame.layers.empty())
+    return;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  if (geometry_.beamCount() != beam_count || geometry_.angularFov() != scan_frame.angular_fov ||
+      neighbour_ratio_ == 0) {
+    geometry_.update(scan_frame.angular_fov, beam_count);
+    double increment = geometry_.angleIncrement();
+    neighbour_ratio_ = (increment < lambda_) ? (float)(std::sin(increment) / std::sin(lambda_ - increment)) : 0;
+  }
+
+  const int* r = ranges.data();
+  const float* c = geometry_.cosines();
+  const float* s = geometry_.sines();
+  ScanSegment segment;
+  int previous = -1;
+  float previous_x = 0, previous_y = 0;
+  for (int i = 0; i < beam_count; i++) {
+    if (r[i] <= 0)
+      continue;
+
+    float range = r[i] * ScanGeometry::RANGE_SCALE;
+    float x = range * c[i], y = range * s[i];
+    if (previous >= 0) {
+      int gap = i - previous;
+      float dx = x - previous_x, dy = y - previous_y;
+      if (gap <= max_gap_ + 1 && connected(r[previous], gap, dx * dx + dy * dy))
+        extendSegment(segment, i, x, y);
+      else {
+        segments.push_back(segment);
+        beginSegment(segment, i, x, y);
+      }
+    }
+    else
+      beginSegment(segment, i, x, y);
+
+    previous = i;
+    previous_x = x;
+    previous_y = y;
+  }
+  if (previous < 0)
+    return;
+  segments.push_back(segment);
+
+  if (scan_frame.angular_fov == ANGULAR_FOV_360DEG) {
+    ScanSegment& first = segments.front();
+    ScanSegment& last = segments.back();
+    int gap = first.begin + beam_count - previous;
+    float dx = first.first_x - last.last_x, dy = first.first_y - last.last_y;
+    bool seam_connected = gap <= max_gap_ + 1 && connected(r[previous], gap, dx * dx + dy * dy);
+    if (seam_connected && segments.size() == 1)
+      last.end = last.begin + beam_count;
+    else if (seam_connected) {
+      last.end = first.end + beam_count;
+      last.point_count += first.point_count;
+      last.centroid_x += first.centroid_x;
+      last.centroid_y += first.centroid_y;
+      last.min_x = std::min(last.min_x, first.min_x);
+      last.min_y = std::min(last.min_y, first.min_y);
+      last.max_x = std::max(last.max_x, first.max_x);
+      last.max_y = std::max(last.max_y, first.max_y);
+      last.last_x = first.last_x;
+      last.last_y = first.last_y;
+      first.point_count = 0;
+    }
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < segments.size(); i++) {
+    ScanSegment& candidate = segments[i];
+    if (candidate.point_count < min_point_count_)
+      continue;
+    candidate.centroid_x /= candidate.point_count;
+    candidate.centroid_y /= candidate.point_count;
+    segments[count++] = candidate;
+  }
+  segments.resize(count);
+}
+
+}
@@ -1,4 +1,6 @@
 #include "ldcp/session.h"
+#include "ldcp/trace.h"
+#include "ldcp/utility.h"
 
 #include <algorithm>
 
@@ -18,7 +20,11 @@ typedef enum {
 
 Session::Session()
   : timeout_(DEFAULT_TIMEOUT)
+  , oob_receive_mode_(OOB_RECEIVE_MODE_REACTOR)
+  , busy_poll_timeout_(0)
+  , oob_receive_buffer_size_(0)
   , id_(-1)
+  , scan_block_queue_drops_(0)
 {
 }
 
@@ -27,17 +33,25 @@ void Session::setTimeout(int timeout)
   timeout_ = timeout;
 }
 
+int Session::timeout() const
+{
+  return timeout_;
+}
+
 error_t Session::open(const Location& location)
 {
   transport_ = Transport::create(location);
+  transport_->setDocumentPool(&document_pool_);
+  transport_->setFlightRecorder(flight_recorder_);
 #if defined(_MSC_VER) && (_MSC_VER <= 1800)
   transport_->setReceivedMessageCallback(
-    [this](rapidjson::Document message) { onMessageReceived(std::move(message)); }
+    [this](PooledDocument message) { onMessageReceived(std::move(message)); }
   );
 #else
   transport_->setReceivedMessageCallback(std::bind(&Session::onMessageReceived, this, std::placeholders::_1));
 #endif
-  transport_->setReceivedOobPacketCallback(std::bind(&Session::onOobPacketReceived, this, std::placeholders::_1));
+  transport_->setReceivedOobPacketCallback(std::bind(&Session::onOobPacketReceived, this,
+                                                     std::placeholders::_1, std::placeholders::_2));
   error_t connect_result = transport_->connect(timeout_);
   if (connect_result != error_t::no_error)
     transport_ = nullptr;
@@ -62,41 +76,37 @@ bool Session::isOpened() const
   return (transport_ && transport_->isConnected());
 }
 
-rapidjson::Document Session::createEmptyRequestObject()
+PooledDocument Session::createEmptyRequestObject()
 {
-  rapidjson::Document request;
-  rapidjson::Document::AllocatorType& allocator = request.GetAllocator();
-
-  request.SetObject()
-      .AddMember("jsonrpc", "2.0", allocator)
-      .AddMember("method", rapidjson::Value(), allocator);
-
-  return request;
+  return document_pool_.createRequest();
 }
 
-void Session::executeCommand(rapidjson::Document request)
+void Session::executeCommand(PooledDocument request)
 {
   std::lock_guard<std::mutex> command_lock(command_mutex_);
   request.AddMember("id", ++id_, request.GetAllocator());
+  LDCP_TRACE(TRACE_EVENT_COMMAND_SEND, id_);
   transport_->transmitMessage(std::move(request));
 }
 
-error_t Session::executeCommand(rapidjson::Document request, rapidjson::Document& response)
+error_t Session::executeCommand(PooledDocument request, PooledDocument& response)
 {
   std::lock_guard<std::mutex> command_lock(command_mutex_);
   std::unique_lock<std::mutex> response_queue_lock(response_queue_mutex_);
 
   request.AddMember("id", ++id_, request.GetAllocator());
+  LDCP_TRACE(TRACE_EVENT_COMMAND_SEND, id_);
   transport_->transmitMessage(std::move(request));
 
   bool wait_result = response_queue_cv_.wait_for(response_queue_lock, std::chrono::milliseconds(timeout_), [&]() {
-    std::remove_if(response_queue_.begin(), response_queue_.end(), [&](const rapidjson::Document& document) {
+    std::remove_if(response_queue_.begin(), response_queue_.end(), [&](const PooledDocument& document) {
       return (document["id"].GetInt() < id_);
     });
     return (response_queue_.size() > 0 && response_queue_.front()["id"] == id_);
   });
   if (wait_result) {
-    rapidjson::Document& message = response_queue_.front();
+    PooledDocument& message = response_queue_.front();
+    LDCP_TRACE(TRACE_EVENT_COMMAND_RESPONSE, id_);
 
     if (message.HasMember("result")) {
       response = std::move(response_queue_.front());
@@ -129,12 +139,56 @@ error_t Session::executeCommand(rapidjson::Document request, rapidjson::Document
     return error_t::timed_out;
 }
 
+void Session::setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout)
+{
+  oob_receive_mode_ = mode;
+  busy_poll_timeout_ = busy_poll_timeout;
+}
+
+void Session::setOobReceiveBufferSize(int size)
+{
+  oob_receive_buffer_size_ = size;
+}
+
+// Takes effect immediately when the session is already open
+void Session::setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder)
+{
+  flight_recorder_ = flight_recorder;
+  if (transport_)
+    transport_->setFlightRecorder(flight_recorder);
+}
+
+// The stream verifies packets itself, so the transport stops verifying them
+// while one is set. The receive thread reads the stream concurrently.
+void Session::setDecodeStream(std::shared_ptr<DecodeStream> decode_stream)
+{
+  std::atomic_store(&decode_stream_, decode_stream);
+  if (transport_)
+    transport_->setOobPacketVerification(!decode_stream);
+}
+
 error_t Session::enableOobTransport(const Location& location)
 {
+  transport_->setOobReceiveMode(oob_receive_mode_, busy_poll_timeout_);
+  transport_->setOobReceiveBufferSize(oob_receive_buffer_size_);
+  transport_->setOobPacketVerification(!std::atomic_load(&decode_stream_));
   return transport_->enableOob(location);
 }
 
-error_t Session::pollForScanBlock(rapidjson::Document& notification, std::vector<uint8_t>& oob_data)
+error_t Session::getOobStatistics(OobStatistics& statistics)
+{
+  error_t result = transport_->getOobStatistics(statistics);
+  if (result == error_t::no_error) {
+    std::lock_guard<std::mutex> scan_block_queue_lock(scan_block_queue_mutex_);
+    statistics.queue_drops = scan_block_queue_drops_;
+    std::shared_ptr<DecodeStream> decode_stream = std::atomic_load(&decode_stream_);
+    if (decode_stream)
+      statistics.queue_drops += decode_stream->droppedPackets();
+  }
+  return result;
+}
+
+error_t Session::pollForScanBlock(PooledDocument& notification, std::vector<uint8_t>& oob_data)
 {
   std::unique_lock<std::mutex> scan_block_queue_lock(scan_block_queue_mutex_);
   bool wait_result = scan_block_queue_cv_.wait_for(scan_block_queue_lock, std::chrono::milliseconds(timeout_), [&]() {
@@ -149,13 +203,14 @@ error_t Session::pollForScanBlock(rapidjson::Document& notification, std::vector
       oob_data = std::move(scan_block_queue_oob_.front());
       scan_block_queue_oob_.pop_front();
     }
+    LDCP_TRACE(TRACE_EVENT_BLOCK_DEQUEUE, scan_block_queue_primary_.size() + scan_block_queue_oob_.size());
     return error_t::no_error;
   }
   else
     return error_t::timed_out;
 }
 
-void Session::onMessageReceived(rapidjson::Document message)
+void Session::onMessageReceived(PooledDocument message)
 {
   if (!(message.HasMember("jsonrpc") && message["jsonrpc"] == "2.0"))
     return;
@@ -172,19 +227,34 @@ void Session::onMessageReceived(rapidjson::Document message)
   else if ((message.HasMember("method") && message["method"] == "notification/laserScan") &&
            message.HasMember("params") && !message.HasMember("id")) {
     std::lock_guard<std::mutex> scan_block_queue_lock(scan_block_queue_mutex_);
-    if (scan_block_queue_primary_.size() == SCAN_BLOCK_BUFFERING_COUNT)
+    if (scan_block_queue_primary_.size() == SCAN_BLOCK_BUFFERING_COUNT) {
       scan_block_queue_primary_.pop_front();
+      scan_block_queue_drops_++;
+    }
     scan_block_queue_primary_.push_back(std::move(message));
+    LDCP_TRACE(TRACE_EVENT_BLOCK_ENQUEUE, scan_block_queue_primary_.size());
     scan_block_queue_cv_.notify_one();
   }
 }
 
-void Session::onOobPacketReceived(std::vector<uint8_t> oob_packet)
+void Session::onOobPacketReceived(std::vector<uint8_t> oob_packet, bool verified)
 {
+  std::shared_ptr<DecodeStream> decode_stream = std::atomic_load(&decode_stream_);
+  if (decode_stream) {
+    decode_stream->submit(std::move(oob_packet));
+    return;
+  }
+  // Left unverified for a stream that has been removed since
+  if (!verified && !Utility::VerifyOobPacket(oob_packet.data(), oob_packet.size()))
+    return;
+
   std::lock_guard<std::mutex> scan_block_queue_lock(scan_block_queue_mutex_);
-  if (scan_block_queue_oob_.size() == SCAN_BLOCK_BUFFERING_COUNT)
+  if (scan_block_queue_oob_.size() == SCAN_BLOCK_BUFFERING_COUNT) {
     scan_block_queue_oob_.pop_front();
+    scan_block_queue_drops_++;
+  }
   scan_block_queue_oob_.push_back(std::move(oob_packet));
+  LDCP_TRACE(TRACE_EVENT_BLOCK_ENQUEUE, scan_block_queue_oob_.size());
   scan_block_queue_cv_.notify_one();
 }
 
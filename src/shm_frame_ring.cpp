@@ -0,0 +1,428 @@
+#include "ldcp/shm_frame_ring.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <climits>
+#endif
+
+namespace ldcp_sdk
+{
+
+static const uint32_t SHM_RING_MAGIC = 0x4C444350;
+static const uint32_t SHM_RING_VERSION = 1;
+static const int SHM_BLOCK_COUNT_MAX = 256;
+
+struct alignas(64) ShmRingHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t beam_count_max;
+  uint64_t slot_size;
+  std::atomic<uint32_t> write_count;
+};
+
+struct alignas(64) ShmSlotHeader
+{
+  std::atomic<uint32_t> sequence;
+  uint32_t frame_number;
+  uint32_t timestamp;
+  uint32_t angular_fov;
+  int64_t host_timestamp;
+  uint32_t block_count;
+  uint32_t beam_count;
+};
+
+static size_t alignedSize(size_t size)
+{
+  return (size + 63) & ~(size_t)63;
+}
+
+static size_t slotSize(size_t beam_count_max)
+{
+  return alignedSize(sizeof(ShmSlotHeader)) +
+         alignedSize(SHM_BLOCK_COUNT_MAX * sizeof(uint32_t)) +
+         alignedSize(SHM_BLOCK_COUNT_MAX * sizeof(int64_t)) +
+         2 * alignedSize(beam_count_max * sizeof(uint16_t));
+}
+
+static ShmSlotHeader* slotHeader(const uint8_t* mapping, int slot_index)
+{
+  const ShmRingHeader* ring_header = reinterpret_cast<const ShmRingHeader*>(mapping);
+  return reinterpret_cast<ShmSlotHeader*>(const_cast<uint8_t*>(mapping) +
+    alignedSize(sizeof(ShmRingHeader)) + slot_index * ring_header->slot_size);
+}
+
+static void slotArrays(ShmSlotHeader* slot_header, uint32_t beam_count_max, uint32_t*& block_timestamps,
+                       int64_t*& block_host_timestamps, uint16_t*& ranges, uint16_t*& intensities)
+{
+  uint8_t* base = reinterpret_cast<uint8_t*>(slot_header) + alignedSize(sizeof(ShmSlotHeader));
+  block_timestamps = reinterpret_cast<uint32_t*>(base);
+  base += alignedSize(SHM_BLOCK_COUNT_MAX * sizeof(uint32_t));
+  block_host_timestamps = reinterpret_cast<int64_t*>(base);
+  base += alignedSize(SHM_BLOCK_COUNT_MAX * sizeof(int64_t));
+  ranges = reinterpret_cast<uint16_t*>(base);
+  base += alignedSize(beam_count_max * sizeof(uint16_t));
+  intensities = reinterpret_cast<uint16_t*>(base);
+}
+
+ShmFramePublisher::ShmFramePublisher()
+  : mapping_(NULL)
+  , mapping_size_(0)
+{
+}
+
+ShmFramePublisher::~ShmFramePublisher()
+{
+  close();
+}
+
+#ifdef __linux__
+
+error_t ShmFramePublisher::open(const std::string& name, int beam_count_max, int slot_count)
+{
+  if (isOpened() || beam_count_max <= 0 || slot_count < 2)
+    return error_t::invalid_params;
+
+  size_t slot_size = slotSize(beam_count_max);
+  size_t mapping_size = alignedSize(sizeof(ShmRingHeader)) + slot_count * slot_size;
+
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return error_t::unknown;
+  if (ftruncate(fd, mapping_size) != 0) {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return error_t::unknown;
+  }
+  void* mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    return error_t::unknown;
+  }
+
+  name_ = name;
+  mapping_ = static_cast<uint8_t*>(mapping);
+  mapping_size_ = mapping_size;
+
+  ShmRingHeader* ring_header = new (mapping_) ShmRingHeader();
+  ring_header->slot_count = slot_count;
+  ring_header->beam_count_max = beam_count_max;
+  ring_header->slot_size = slot_size;
+  ring_header->write_count.store(0);
+  for (int i = 0; i < slot_count; i++)
+    new (slotHeader(mapping_, i)) ShmSlotHeader();
+  ring_header->version = SHM_RING_VERSION;
+  std::atomic_thread_fence(std::memory_order_release);
+  ring_header->magic = SHM_RING_MAGIC;
+
+  return error_t::no_error;
+}
+
+void ShmFramePublisher::close()
+{
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+    shm_unlink(name_.c_str());
+    mapping_ = NULL;
+    mapping_size_ = 0;
+  }
+}
+
+error_t ShmFramePublisher::publish(const ScanFrame& scan_frame)
+{
+  if (!mapping_)
+    return error_t::unknown;
+
+  ShmRingHeader* ring_header = reinterpret_cast<ShmRingHeader*>(mapping_);
+  int beam_count = scan_frame.layers.empty() ? 0 : (int)scan_frame.layers[0].ranges.size();
+  int block_count = (int)scan_frame.block_timestamps.size();
+  if (beam_count > (int)ring_header->beam_count_max || block_count > SHM_BLOCK_COUNT_MAX)
+    return error_t::invalid_params;
+
+  uint32_t write_count = ring_header->write_count.load(std::memory_order_relaxed);
+  ShmSlotHeader* slot_header = slotHeader(mapping_, write_count % ring_header->slot_count);
+
+  uint32_t sequence = slot_header->sequence.load(std::memory_order_relaxed);
+  slot_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint32_t* block_timestamps;
+  int64_t* block_host_timestamps;
+  uint16_t *ranges, *intensities;
+  slotArrays(slot_header, ring_header->beam_count_max, block_timestamps, block_host_timestamps, ranges, intensities);
+
+  slot_header->frame_number = write_count;
+  slot_header->timestamp = scan_frame.timestamp;
+  slot_header->host_timestamp = scan_frame.host_timestamp;
+  slot_header->angular_fov = scan_frame.angular_fov;
+  slot_header->block_count = block_count;
+  slot_header->beam_count = beam_count;
+  for (int i = 0; i < block_count; i++) {
+    block_timestamps[i] = scan_frame.block_timestamps[i];
+    block_host_timestamps[i] = (i < (int)scan_frame.block_host_timestamps.size()) ?
+      scan_frame.block_host_timestamps[i] : 0;
+  }
+  if (beam_count > 0) {
+    const int* source_ranges = scan_frame.layers[0].ranges.data();
+    const int* source_intensities = scan_frame.layers[0].intensities.data();
+    for (int i = 0; i < beam_count; i++) {
+      ranges[i] = (uint16_t)source_ranges[i];
+      intensities[i] = (uint16_t)source_intensities[i];
+    }
+  }
+
+  slot_header->sequence.store(sequence + 2, std::memory_order_release);
+  ring_header->write_count.store(write_count + 1, std::memory_order_release);
+  syscall(SYS_futex, &ring_header->write_count, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+  return error_t::no_error;
+}
+
+ShmFrameReader::ShmFrameReader()
+  : mapping_(NULL)
+  , mapping_size_(0)
+  , last_write_count_(0)
+{
+}
+
+ShmFrameReader::~ShmFrameReader()
+{
+  close();
+}
+
+error_t ShmFrameReader::open(const std::string& name)
+{
+  if (isOpened())
+    return error_t::invalid_params;
+
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return error_t::connection_refused;
+
+  struct stat file_status;
+  if (fstat(fd, &file_status) != 0 || file_status.st_size < (off_t)sizeof(ShmRingHeader)) {
+    ::close(fd);
+    return error_t::protocol_error;
+  }
+  void* mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return error_t::unknown;
+
+  // The slots are addressed with the layout in the header, so it has to
+  // match the one the publisher computes and fit in the mapping
+  const ShmRingHeader* ring_header = static_cast<const ShmRingHeader*>(mapping);
+  size_t slots_size = (size_t)file_status.st_size - alignedSize(sizeof(ShmRingHeader));
+  if (ring_header->magic != SHM_RING_MAGIC || ring_header->version != SHM_RING_VERSION ||
+      (size_t)file_status.st_size < alignedSize(sizeof(ShmRingHeader)) ||
+      ring_header->slot_count == 0 || ring_header->beam_count_max == 0 ||
+      ring_header->slot_size != slotSize(ring_header->beam_count_max) ||
+      ring_header->slot_size > slots_size / ring_header->slot_count) {
+    munmap(mapping, file_status.st_size);
+    return error_t::protocol_error;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  mapping_ = static_cast<const uint8_t*>(mapping);
+  mapping_size_ = file_status.st_size;
+  last_write_count_ = ring_header->write_count.load(std::memory_order_acquire);
+
+  return error_t::no_error;
+}
+
+void ShmFrameReader::close()
+{
+  if (mapping_) {
+    munmap(const_cast<uint8_t*>(mapping_), mapping_size_);
+    mapping_ = NULL;
+    mapping_size_ = 0;
+  }
+}
+
+error_t ShmFrameReader::waitForFrame(int timeout)
+{
+  if (!mapping_)
+    return error_t::unknown;
+
+  const ShmRingHeader* ring_header = reinterpret_cast<const ShmRingHeader*>(mapping_);
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+  while (true) {
+    uint32_t write_count = ring_header->write_count.load(std::memory_order_acquire);
+    if (write_count != last_write_count_)
+      return error_t::no_error;
+
+    std::chrono::nanoseconds remaining = deadline - std::chrono::steady_clock::now();
+    if (remaining.count() <= 0)
+      return error_t::timed_out;
+    struct timespec relative_timeout;
+    relative_timeout.tv_sec = remaining.count() / 1000000000;
+    relative_timeout.tv_nsec = remaining.count() % 1000000000;
+    syscall(SYS_futex, &ring_header->write_count, FUTEX_WAIT, write_count, &relative_timeout, NULL, 0);
+  }
+}
+
+error_t ShmFrameReader::acquireLatest(ShmFrameView& view)
+{
+  if (!mapping_)
+    return error_t::unknown;
+
+  const ShmRingHeader* ring_header = reinterpret_cast<const ShmRingHeader*>(mapping_);
+  uint32_t write_count = ring_header->write_count.load(std::memory_order_acquire);
+  if (write_count == 0)
+    return error_t::timed_out;
+
+  int slot_index = (write_count - 1) % ring_header->slot_count;
+  ShmSlotHeader* slot_header = slotHeader(mapping_, slot_index);
+  uint32_t sequence = slot_header->sequence.load(std::memory_order_acquire);
+  if (sequence & 1)
+    return error_t::timed_out;
+
+  uint32_t* block_timestamps;
+  int64_t* block_host_timestamps;
+  uint16_t *ranges, *intensities;
+  slotArrays(slot_header, ring_header->beam_count_max, block_timestamps, block_host_timestamps, ranges, intensities);
+
+  view.frame_number = slot_header->frame_number;
+  view.timestamp = slot_header->timestamp;
+  view.host_timestamp = slot_header->host_timestamp;
+  view.angular_fov = (angular_fov_t)slot_header->angular_fov;
+  view.block_count = slot_header->block_count;
+  view.beam_count = slot_header->beam_count;
+  view.block_timestamps = block_timestamps;
+  view.block_host_timestamps = block_host_timestamps;
+  view.ranges = ranges;
+  view.intensities = intensities;
+  view.slot_index = slot_index;
+  view.sequence = sequence;
+
+  last_write_count_ = write_count;
+  if (!isValid(view))
+    return error_t::timed_out;
+  if (view.block_count < 0 || view.block_count > SHM_BLOCK_COUNT_MAX ||
+      view.beam_count < 0 || (uint32_t)view.beam_count > ring_header->beam_count_max)
+    return error_t::protocol_error;
+  return error_t::no_error;
+}
+
+bool ShmFrameReader::isValid(const ShmFrameView& view) const
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slotHeader(mapping_, view.slot_index)->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+#else
+
+error_t ShmFramePublisher::open(const std::string& name, int beam_count_max, int slot_count)
+{
+  return error_t::not_supported;
+}
+
+void ShmFramePublisher::close()
+{
+}
+
+error_t ShmFramePublisher::publish(const ScanFrame& scan_frame)
+{
+  return error_t::not_supported;
+}
+
+ShmFrameReader::ShmFrameReader()
+  : mapping_(NULL)
+  , mapping_size_(0)
+  , last_write_count_(0)
+{
+}
+
+ShmFrameReader::~ShmFrameReader()
+{
+}
+
+error_t ShmFrameReader::open(const std::string& name)
+{
+  return error_t::not_supported;
+}
+
+void ShmFrameReader::close()
+{
+}
+
+error_t ShmFrameReader::waitForFrame(int timeout)
+{
+  return error_t::not_supported;
+}
+
+error_t ShmFrameReader::acquireLatest(ShmFrameView& view)
+{
+  return error_t::not_supported;
+}
+
+bool ShmFrameReader::isValid(const ShmFrameView& view) const
+{
+  return false;
+}
+
+#endif
+
+bool ShmFramePublisher::isOpened() const
+{
+  return (mapping_ != NULL);
+}
+
+bool ShmFrameReader::isOpened() const
+{
+  return (mapping_ != NULL);
+}
+
+error_t ShmFrameReader::readScanFrame(ScanFrame& scan_frame, int timeout)
+{
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  error_t result = waitForFrame(timeout);
+  if (result != error_t::no_error)
+    return result;
+
+  // The latest slot may be overwritten while it is copied, or be left odd
+  // by a publisher that died while writing it, so retries end at the
+  // deadline. A malformed slot is reported at once.
+  ShmFrameView view;
+  while (true) {
+    result = acquireLatest(view);
+    if (result == error_t::no_error) {
+      scan_frame.timestamp = view.timestamp;
+      scan_frame.host_timestamp = view.host_timestamp;
+      scan_frame.angular_fov = view.angular_fov;
+      scan_frame.block_timestamps.assign(view.block_timestamps, view.block_timestamps + view.block_count);
+      scan_frame.block_host_timestamps.assign(view.block_host_timestamps,
+                                              view.block_host_timestamps + view.block_count);
+      scan_frame.layers.resize(1);
+      scan_frame.layers[0].ranges.assign(view.ranges, view.ranges + view.beam_count);
+      scan_frame.layers[0].intensities.assign(view.intensities, view.intensities + view.beam_count);
+      if (isValid(view))
+        return error_t::no_error;
+      result = error_t::timed_out;
+    }
+    else if (result != error_t::timed_out)
+      return result;
+
+    if (std::chrono::steady_clock::now() >= deadline)
+      return result;
+    std::this_thread::yield();
+  }
+}
+
+}
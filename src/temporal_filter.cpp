@@ -0,0 +1,168 @@
+#include "ldcp/temporal_filter.h"
+
+#include <algorithm>
+
+namespace ldcp_sdk
+{
+
+TemporalFilter::TemporalFilter(int depth)
+  : depth_(std::min(std::max(depth, 1), (int)DEPTH_MAX))
+  , estimate_(TEMPORAL_ESTIMATE_MEAN)
+  , min_valid_count_(1)
+  , beam_count_(0)
+  , frame_count_(0)
+  , slot_(0)
+{
+}
+
+void TemporalFilter::setEstimate(temporal_estimate_t estimate)
+{
+  estimate_ = estimate;
+}
+
+void TemporalFilter::setMinValidCount(int count)
+{
+  min_valid_count_ = std::min(std::max(count, 1), depth_);
+}
+
+void TemporalFilter::reset()
+{
+  frame_count_ = 0;
+  slot_ = 0;
+  std::fill(history_.begin(), history_.end(), 0);
+  std::fill(sums_.begin(), sums_.end(), 0);
+  std::fill(square_sums_.begin(), square_sums_.end(), 0);
+  std::fill(valid_counts_.begin(), valid_counts_.end(), 0);
+  std::fill(means_.begin(), means_.end(), 0.0f);
+  std::fill(variances_.begin(), variances_.end(), 0.0f);
+}
+
+void TemporalFilter::update(const ScanFrame& scan_frame)
+{
+  if (scan_frame.layers.empty())
+    return;
+
+  const std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  int beam_count = (int)ranges.size();
+  if (beam_count != beam_count_) {
+    beam_count_ = beam_count;
+    history_.resize(beam_count * depth_);
+    sums_.resize(beam_count);
+    square_sums_.resize(beam_count);
+    valid_counts_.resize(beam_count);
+    means_.resize(beam_count);
+    variances_.resize(beam_count);
+    reset();
+  }
+
+  const int* r = ranges.data();
+  uint16_t* history = history_.data() + slot_;
+  int32_t* sums = sums_.data();
+  int64_t* square_sums = square_sums_.data();
+  uint8_t* valid_counts = valid_counts_.data();
+  float* means = means_.data();
+  float* variances = variances_.data();
+  const int depth = depth_;
+  for (int i = 0; i < beam_count; i++) {
+    int oldest = history[i * depth];
+    int newest = std::min(std::max(r[i], 0), 0xFFFF);
+    history[i * depth] = (uint16_t)newest;
+    sums[i] += newest - oldest;
+    square_sums[i] += (int64_t)newest * newest - (int64_t)oldest * oldest;
+    valid_counts[i] += (uint8_t)((newest > 0) - (oldest > 0));
+  }
+  for (int i = 0; i < beam_count; i++) {
+    double count = std::max((double)valid_counts[i], 1.0);
+    double mean = sums[i] / count;
+    means[i] = (float)mean;
+    variances[i] = (float)std::max(square_sums[i] / count - mean * mean, 0.0);
+  }
+
+  slot_ = (slot_ + 1) % depth_;
+  frame_count_ = std::min(frame_count_ + 1, depth_);
+}
+
+void TemporalFilter::apply(ScanFrame& scan_frame)
+{
+  update(scan_frame);
+  if (scan_frame.layers.empty())
+    return;
+
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  int* r = ranges.data();
+  const uint8_t* valid_counts = valid_counts_.data();
+  const float* means = means_.data();
+  const int min_valid_count = min_valid_count_;
+
+  if (estimate_ == TEMPORAL_ESTIMATE_MEDIAN)
+    estimateMedians(r);
+  else {
+    for (int i = 0; i < beam_count_; i++)
+      r[i] = (int)(means[i] + 0.5f);
+  }
+  for (int i = 0; i < beam_count_; i++)
+    r[i] = (valid_counts[i] >= min_valid_count) ? r[i] : 0;
+
+  if (intensities.size() == ranges.size()) {
+    for (int i = 0; i < beam_count_; i++)
+      intensities[i] = (r[i] > 0) ? intensities[i] : 0;
+  }
+}
+
+void TemporalFilter::estimateMedians(int* ranges)
+{
+  // Beams are sorted LANE_COUNT at a time by an odd-even transposition
+  // network run on slot-major copies of their windows. Dropouts sort
+  // first, so the valid samples of a beam occupy its top ranks.
+  uint16_t lanes[DEPTH_MAX][LANE_COUNT];
+  const int depth = depth_;
+  for (int base = 0; base < beam_count_; base += LANE_COUNT) {
+    int lane_count = std::min((int)LANE_COUNT, beam_count_ - base);
+    const uint16_t* history = &history_[base * depth];
+    for (int j = 0; j < depth; j++) {
+      for (int b = 0; b < lane_count; b++)
+        lanes[j][b] = history[b * depth + j];
+      for (int b = lane_count; b < LANE_COUNT; b++)
+        lanes[j][b] = 0;
+    }
+
+    for (int pass = 0; pass < depth; pass++) {
+      for (int j = pass % 2; j + 1 < depth; j += 2) {
+        for (int b = 0; b < LANE_COUNT; b++) {
+          uint16_t low = std::min(lanes[j][b], lanes[j + 1][b]);
+          uint16_t high = std::max(lanes[j][b], lanes[j + 1][b]);
+          lanes[j][b] = low;
+          lanes[j + 1][b] = high;
+        }
+      }
+    }
+
+    for (int b = 0; b < lane_count; b++) {
+      int count = valid_counts_[base + b];
+      ranges[base + b] = (count > 0) ? lanes[depth - count + count / 2][b] : 0;
+    }
+  }
+}
+
+int TemporalFilter::beamCount() const
+{
+  return beam_count_;
+}
+
+int TemporalFilter::frameCount() const
+{
+  return frame_count_;
+}
+
+const std::vector<float>& TemporalFilter::means() const
+{
+  return means_;
+}
+
+const std::vector<float>& TemporalFilter::variances() const
+{
+  return variances_;
+}
+
+}
@@ -0,0 +1,186 @@
+#include "ldcp/thread_config.h"
+#include "ldcp/trace.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <alloca.h>
+#include <sys/mman.h>
+#elif _WIN32
+#include <Windows.h>
+#endif
+
+namespace ldcp_sdk
+{
+
+static const size_t PAGE_SIZE_MIN = 4096;
+
+ThreadConfig::ThreadConfig()
+  : scheduling_policy(SCHEDULING_POLICY_DEFAULT)
+  , priority(0)
+  , prefault_stack_size(0)
+{
+}
+
+ThreadManager& ThreadManager::instance()
+{
+  static ThreadManager instance;
+  return instance;
+}
+
+ThreadManager::ThreadManager()
+  : memory_locked_(false)
+  , configuration_failures_(0)
+{
+}
+
+void ThreadManager::setThreadConfig(const ThreadConfig& config)
+{
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  for (int i = 0; i < THREAD_ROLE_COUNT; i++)
+    configs_[i] = config;
+}
+
+void ThreadManager::setThreadConfig(thread_role_t role, const ThreadConfig& config)
+{
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  configs_[role] = config;
+}
+
+ThreadConfig ThreadManager::threadConfig(thread_role_t role)
+{
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  return configs_[role];
+}
+
+error_t ThreadManager::lockMemory()
+{
+#ifdef __linux__
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    return error_t::unknown;
+  memory_locked_ = true;
+  return error_t::no_error;
+#else
+  return error_t::not_supported;
+#endif
+}
+
+void ThreadManager::unlockMemory()
+{
+#ifdef __linux__
+  if (memory_locked_) {
+    munlockall();
+    memory_locked_ = false;
+  }
+#endif
+}
+
+bool ThreadManager::isMemoryLocked() const
+{
+  return memory_locked_;
+}
+
+int ThreadManager::configurationFailures() const
+{
+  return configuration_failures_;
+}
+
+std::thread ThreadManager::createThread(thread_role_t role, const std::string& name, std::function<void()> function)
+{
+  ThreadConfig config = threadConfig(role);
+  return std::thread([this, config, name, function]() {
+    if (applyThreadConfig(config, name) != error_t::no_error)
+      configuration_failures_++;
+    LDCP_TRACE_THREAD_NAME(name);
+    if (config.prefault_stack_size > 0)
+      prefaultStack(config.prefault_stack_size);
+    function();
+  });
+}
+
+void ThreadManager::prefault(void* data, size_t size)
+{
+  volatile uint8_t* bytes = static_cast<volatile uint8_t*>(data);
+  for (size_t i = 0; i < size; i += PAGE_SIZE_MIN)
+    bytes[i] = bytes[i];
+  if (size > 0)
+    bytes[size - 1] = bytes[size - 1];
+}
+
+#ifdef __linux__
+
+error_t ThreadManager::applyThreadConfig(const ThreadConfig& config, const std::string& name)
+{
+  error_t result = error_t::no_error;
+  pthread_t thread = pthread_self();
+
+  pthread_setname_np(thread, name.substr(0, 15).c_str());
+
+  if (!config.cpu_affinity.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : config.cpu_affinity)
+      CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set) != 0)
+      result = error_t::invalid_params;
+  }
+
+  if (config.scheduling_policy != SCHEDULING_POLICY_DEFAULT) {
+    struct sched_param param;
+    param.sched_priority = config.priority;
+    int policy = (config.scheduling_policy == SCHEDULING_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+    if (pthread_setschedparam(thread, policy, &param) != 0)
+      result = error_t::invalid_params;
+  }
+
+  return result;
+}
+
+void ThreadManager::prefaultStack(size_t size)
+{
+  volatile uint8_t* stack = static_cast<volatile uint8_t*>(alloca(size));
+  for (size_t i = 0; i < size; i += PAGE_SIZE_MIN)
+    stack[i] = 0;
+}
+
+#elif _WIN32
+
+// Windows has no real-time policies, so the POSIX priority range 1-99 is
+// split into bands of the levels above normal
+static int win32Priority(int priority)
+{
+  if (priority >= 67)
+    return THREAD_PRIORITY_TIME_CRITICAL;
+  if (priority >= 34)
+    return THREAD_PRIORITY_HIGHEST;
+  return THREAD_PRIORITY_ABOVE_NORMAL;
+}
+
+error_t ThreadManager::applyThreadConfig(const ThreadConfig& config, const std::string& name)
+{
+  error_t result = error_t::no_error;
+  HANDLE thread = GetCurrentThread();
+
+  if (!config.cpu_affinity.empty()) {
+    DWORD_PTR mask = 0;
+    for (int cpu : config.cpu_affinity)
+      mask |= (DWORD_PTR)1 << cpu;
+    if (SetThreadAffinityMask(thread, mask) == 0)
+      result = error_t::invalid_params;
+  }
+
+  if (config.scheduling_policy != SCHEDULING_POLICY_DEFAULT) {
+    if (!SetThreadPriority(thread, win32Priority(config.priority)))
+      result = error_t::invalid_params;
+  }
+
+  return result;
+}
+
+void ThreadManager::prefaultStack(size_t size)
+{
+}
+
+#endif
+
+}
@@ -0,0 +1,180 @@
+#include "ldcp/trace.h"
+#include "ldcp/clock_sync.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace ldcp_sdk
+{
+
+static const char* const EVENT_NAMES[TRACE_EVENT_COUNT] = {
+  "packet_receive",
+  "crc_verify",
+  "block_enqueue",
+  "block_dequeue",
+  "block_decode",
+  "frame_complete",
+  "command_send",
+  "command_response"
+};
+
+static void writeJsonString(std::ostream& stream, const char* value)
+{
+  stream << '"';
+  for (; *value != '\0'; value++) {
+    char character = *value;
+    if (character == '"' || character == '\\')
+      stream << '\\' << character;
+    else if ((unsigned char)character < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)character);
+      stream << escaped;
+    }
+    else
+      stream << character;
+  }
+  stream << '"';
+}
+
+Tracer& Tracer::instance()
+{
+  static Tracer instance;
+  return instance;
+}
+
+bool Tracer::isEnabled()
+{
+#ifdef LDCP_SDK_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+Tracer::LocalRing::LocalRing()
+  : ring(nullptr)
+{
+}
+
+Tracer::LocalRing::~LocalRing()
+{
+  if (ring)
+    Tracer::instance().releaseRing(ring);
+}
+
+Tracer::Tracer()
+  : next_thread_id_(1)
+{
+}
+
+void Tracer::record(trace_event_t event, uint64_t argument)
+{
+  Ring* ring = localRing();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  Event& entry = ring->events[head % RING_SIZE];
+  entry.time = ClockSync::hostTime();
+  entry.argument = argument;
+  entry.event = event;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+  Ring* ring = localRing();
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  ring->thread_name = name;
+}
+
+void Tracer::clear()
+{
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  for (std::unique_ptr<Ring>& ring : rings_)
+    ring->tail.store(ring->head.load(std::memory_order_acquire));
+}
+
+error_t Tracer::exportChromeTrace(std::ostream& stream)
+{
+  std::vector<Event> events;
+
+  stream << "{\"traceEvents\":[";
+  bool first = true;
+
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  for (std::unique_ptr<Ring>& ring : rings_) {
+    stream << (first ? "" : ",")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->thread_id
+           << ",\"args\":{\"name\":";
+    writeJsonString(stream, ring->thread_name.c_str());
+    stream << "}}";
+    first = false;
+
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(ring->tail.load(), (head > RING_SIZE) ? head - RING_SIZE : 0);
+    events.clear();
+    for (uint64_t i = begin; i < head; i++)
+      events.push_back(ring->events[i % RING_SIZE]);
+
+    // Entries the writer has wrapped around onto during the copy are stale,
+    // including the one it may be writing at the head
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t overwritten = ring->head.load(std::memory_order_relaxed);
+    uint64_t valid_begin = (overwritten + 1 > RING_SIZE) ? overwritten + 1 - RING_SIZE : 0;
+    for (uint64_t i = std::max(begin, valid_begin); i < head; i++) {
+      const Event& event = events[i - begin];
+      stream << ",{\"name\":";
+      writeJsonString(stream, EVENT_NAMES[event.event]);
+      stream << ",\"ph\":\"i\",\"s\":\"t\""
+             << ",\"ts\":" << event.time / 1000 << "." << (event.time % 1000) / 100
+             << ",\"pid\":1,\"tid\":" << ring->thread_id
+             << ",\"args\":{\"value\":" << event.argument << "}}";
+    }
+  }
+
+  stream << "],\"displayTimeUnit\":\"ns\"}";
+  return stream.good() ? error_t::no_error : error_t::unknown;
+}
+
+error_t Tracer::exportChromeTrace(const std::string& file_name)
+{
+  std::ofstream stream(file_name);
+  if (!stream.is_open())
+    return error_t::invalid_params;
+  return exportChromeTrace(stream);
+}
+
+Tracer::Ring* Tracer::localRing()
+{
+  thread_local LocalRing local_ring;
+  if (!local_ring.ring)
+    local_ring.ring = acquireRing();
+  return local_ring.ring;
+}
+
+Tracer::Ring* Tracer::acquireRing()
+{
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  Ring* ring;
+  if (!free_rings_.empty()) {
+    ring = free_rings_.back();
+    free_rings_.pop_back();
+    ring->tail.store(ring->head.load());
+  }
+  else {
+    rings_.emplace_back(new Ring());
+    ring = rings_.back().get();
+    ring->head = 0;
+    ring->tail = 0;
+  }
+  ring->thread_id = next_thread_id_++;
+  ring->thread_name = "thread-" + std::to_string(ring->thread_id);
+  return ring;
+}
+
+void Tracer::releaseRing(Ring* ring)
+{
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  free_rings_.push_back(ring);
+}
+
+}
@@ -1,17 +1,22 @@
 #include "ldcp/transport.h"
 #include "ldcp/utility.h"
 #include "ldcp/data_types.h"
+#include "ldcp/oob_receiver.h"
+#include "ldcp/thread_config.h"
+#include "ldcp/trace.h"
 
-#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <rapidjson/istreamwrapper.h>
 
 #include <asio.hpp>
 
 #include <thread>
+#include <array>
 #include <condition_variable>
+#include <cstdio>
 #include <deque>
-#include <iomanip>
+#include <mutex>
 
 namespace ldcp_sdk
 {
@@ -20,23 +25,25 @@ class NetworkTransport : public Transport
 {
 public:
   NetworkTransport(const NetworkLocation& location);
+  virtual ~NetworkTransport();
 
   virtual error_t connect(int timeout);
   virtual void disconnect();
   virtual bool isConnected() const;
 
-  virtual void transmitMessage(rapidjson::Document message);
+  virtual void transmitMessage(PooledDocument message);
 
   virtual error_t enableOob(const Location& location);
+  virtual error_t getOobStatistics(OobStatistics& statistics);
 
 private:
   void incomingMessageHandler(const asio::error_code& error, size_t bytes_transferred);
   void outgoingMessageHandler(const asio::error_code& error, size_t);
-  void oobPacketHandler(const asio::error_code& error, size_t bytes_transferred);
+  void oobPacketHandler(uint8_t* data, size_t length);
 
-  rapidjson::Document parseIncomingMessage(size_t length);
+  PooledDocument parseIncomingMessage(size_t length);
   void encapsulateOutgoingMessage(rapidjson::Document& message);
-  bool verifyOobPacket(uint8_t* data, int length);
+  void transmitFrontMessage();
 
 private:
   std::thread worker_thread_;
@@ -47,20 +54,32 @@ private:
   asio::ip::tcp::endpoint device_address_;
 
   asio::streambuf incoming_message_buffer_;
-  asio::streambuf outgoing_message_buffers_[3];
-  std::deque<rapidjson::Document> outgoing_message_queue_;
-
-  asio::ip::udp::socket oob_socket_;
-  asio::ip::udp::endpoint sender_address_;
-
-  std::array<uint8_t, OOB_PACKET_LENGTH_MAX> oob_packet_buffer_;
+  // The serialized front message of the queue. The buffer and the writer's
+  // stack keep their capacity from one message to the next.
+  char outgoing_message_header_[64];
+  size_t outgoing_message_header_length_;
+  rapidjson::StringBuffer outgoing_message_body_;
+  rapidjson::Writer<rapidjson::StringBuffer> outgoing_message_writer_;
+  std::mutex outgoing_message_mutex_;
+  std::deque<PooledDocument> outgoing_message_queue_;
+
+  NetworkLocation device_location_;
+  std::shared_ptr<OobReceiver> oob_receiver_;
 };
 
 NetworkTransport::NetworkTransport(const NetworkLocation& location)
   : device_address_(asio::ip::address_v4(ntohl(location.address())), ntohs(location.port()))
   , primary_socket_(io_service_)
-  , oob_socket_(io_service_)
+  , outgoing_message_header_length_(0)
+  , outgoing_message_writer_(outgoing_message_body_)
+  , device_location_(location)
+{
+}
+
+NetworkTransport::~NetworkTransport()
 {
+  if (oob_receiver_)
+    oob_receiver_->unregisterSender(device_location_);
 }
 
 error_t NetworkTransport::connect(int timeout)
@@ -87,7 +106,7 @@ error_t NetworkTransport::connect(int timeout)
       }
     });
 
-    worker_thread_ = std::thread([&]() {
+    worker_thread_ = ThreadManager::instance().createThread(THREAD_ROLE_TRANSPORT, "ldcp-io", [&]() {
       io_service_.run();
     });
 
@@ -122,11 +141,14 @@ void NetworkTransport::disconnect()
     io_service_.dispatch([&]() {
       primary_socket_.shutdown(asio::ip::tcp::socket::shutdown_both);
       primary_socket_.close();
-      if (oob_socket_.is_open())
-        oob_socket_.close();
     });
     worker_thread_.join();
   }
+
+  if (oob_receiver_) {
+    oob_receiver_->unregisterSender(device_location_);
+    oob_receiver_ = nullptr;
+  }
 }
 
 bool NetworkTransport::isConnected() const
@@ -134,59 +156,69 @@ bool NetworkTransport::isConnected() const
   return primary_socket_.is_open();
 }
 
-void NetworkTransport::transmitMessage(rapidjson::Document message)
+// Messages are queued here rather than moved into the handler, so the
+// document is not wrapped in a shared_ptr for every message. Only the
+// caller that finds the queue empty starts a transmission; the I/O thread
+// carries on with the rest from outgoingMessageHandler().
+void NetworkTransport::transmitMessage(PooledDocument message)
 {
-  std::shared_ptr<rapidjson::Document> wrapped_message = std::make_shared<rapidjson::Document>(std::move(message));
-  io_service_.dispatch([this, wrapped_message]() {
-    bool transmit_in_progress = !outgoing_message_queue_.empty();
-    outgoing_message_queue_.push_back(std::move(*wrapped_message));
-    if (!transmit_in_progress) {
-      rapidjson::Document& document = outgoing_message_queue_.front();
-      encapsulateOutgoingMessage(document);
-
-      std::vector<asio::streambuf::const_buffers_type> buffers = { outgoing_message_buffers_[0].data(),
-                                                                   outgoing_message_buffers_[1].data(),
-                                                                   outgoing_message_buffers_[2].data() };
-      asio::async_write(primary_socket_, buffers,
-                        std::bind(&NetworkTransport::outgoingMessageHandler,
-                                  this, std::placeholders::_1, std::placeholders::_2));
-    }
-  });
+  bool transmit_in_progress;
+  {
+    std::lock_guard<std::mutex> lock(outgoing_message_mutex_);
+    transmit_in_progress = !outgoing_message_queue_.empty();
+    outgoing_message_queue_.push_back(std::move(message));
+  }
+  if (!transmit_in_progress)
+    io_service_.dispatch([this]() { transmitFrontMessage(); });
 }
 
-error_t NetworkTransport::enableOob(const Location& location)
+// References to deque elements survive push_back() from other threads, so
+// the front message is serialized outside the lock.
+void NetworkTransport::transmitFrontMessage()
 {
-  oob_socket_.open(asio::ip::udp::v4());
-  oob_socket_.set_option(asio::ip::udp::socket::reuse_address(true));
-
-  const NetworkLocation& network_location = dynamic_cast<const NetworkLocation&>(location);
-  asio::ip::udp::endpoint local_address(asio::ip::address_v4(ntohl(network_location.address())),
-                                        ntohs(network_location.port()));
-  asio::error_code bind_result;
-  oob_socket_.bind(local_address, bind_result);
-
-  if (!bind_result) {
-    oob_socket_.async_receive_from(asio::buffer(oob_packet_buffer_),
-                                   sender_address_,
-                                   std::bind(&NetworkTransport::oobPacketHandler,
-                                             this, std::placeholders::_1, std::placeholders::_2));
-    return error_t::no_error;
+  PooledDocument* message;
+  {
+    std::lock_guard<std::mutex> lock(outgoing_message_mutex_);
+    message = &outgoing_message_queue_.front();
   }
-  else {
-    oob_socket_.close();
+  encapsulateOutgoingMessage(*message);
+
+  std::array<asio::const_buffer, 3> buffers = { {
+    asio::buffer(outgoing_message_header_, outgoing_message_header_length_),
+    asio::buffer(outgoing_message_body_.GetString(), outgoing_message_body_.GetSize()),
+    asio::buffer(",\r\n", 3)
+  } };
+  asio::async_write(primary_socket_, buffers,
+                    std::bind(&NetworkTransport::outgoingMessageHandler,
+                              this, std::placeholders::_1, std::placeholders::_2));
+}
 
-    if (bind_result == asio::error::address_in_use)
-      return error_t::address_in_use;
-    else
-      return error_t::unknown;
-  }
+error_t NetworkTransport::enableOob(const Location& location)
+{
+  error_t result = error_t::no_error;
+  oob_receiver_ = OobReceiver::acquire(dynamic_cast<const NetworkLocation&>(location),
+                                       oob_receive_mode_, busy_poll_timeout_, result);
+  if (result == error_t::no_error)
+    oob_receiver_->registerSender(device_location_,
+                                  std::bind(&NetworkTransport::oobPacketHandler,
+                                            this, std::placeholders::_1, std::placeholders::_2),
+                                  oob_receive_buffer_size_);
+  return result;
+}
+
+error_t NetworkTransport::getOobStatistics(OobStatistics& statistics)
+{
+  if (!oob_receiver_)
+    return error_t::not_supported;
+  oob_receiver_->getStatistics(device_location_, statistics);
+  return error_t::no_error;
 }
 
 void NetworkTransport::incomingMessageHandler(const asio::error_code& error, size_t bytes_transferred)
 {
   if (!error) {
     if (received_message_callback_) {
-      rapidjson::Document message = parseIncomingMessage(bytes_transferred);
+      PooledDocument message = parseIncomingMessage(bytes_transferred);
       if (!message.IsNull())
         received_message_callback_(std::move(message));
     }
@@ -201,57 +233,56 @@ void NetworkTransport::incomingMessageHandler(const asio::error_code& error, siz
 void NetworkTransport::outgoingMessageHandler(const asio::error_code& error, size_t)
 {
   if (!error) {
-    for (int i = 0; i < 3; i++) {
-      asio::streambuf& streambuf = outgoing_message_buffers_[i];
-      streambuf.consume(streambuf.size());
-    }
-    outgoing_message_queue_.pop_front();
-
-    if (!outgoing_message_queue_.empty()) {
-      rapidjson::Document& document = outgoing_message_queue_.front();
-      encapsulateOutgoingMessage(document);
-
-      std::vector<asio::streambuf::const_buffers_type> buffers = { outgoing_message_buffers_[0].data(),
-                                                                   outgoing_message_buffers_[1].data(),
-                                                                   outgoing_message_buffers_[2].data() };
-      asio::async_write(primary_socket_, buffers,
-                        std::bind(&NetworkTransport::outgoingMessageHandler,
-                                  this, std::placeholders::_1, std::placeholders::_2));
+    bool queue_empty;
+    {
+      std::lock_guard<std::mutex> lock(outgoing_message_mutex_);
+      outgoing_message_queue_.pop_front();
+      queue_empty = outgoing_message_queue_.empty();
     }
+    if (!queue_empty)
+      transmitFrontMessage();
   }
   else if (error != asio::error::operation_aborted && transmit_error_callback_)
     transmit_error_callback_(error_t::unknown);
 }
 
-void NetworkTransport::oobPacketHandler(const asio::error_code& error, size_t bytes_transferred)
+void NetworkTransport::oobPacketHandler(uint8_t* data, size_t length)
 {
-  if (!error) {
-    if ((sender_address_.address() == device_address_.address() &&
-         sender_address_.port() == device_address_.port()) &&
-        received_oob_packet_callback_) {
-      if (verifyOobPacket(oob_packet_buffer_.data(), bytes_transferred)) {
-        std::vector<uint8_t> oob_data(oob_packet_buffer_.data(),
-                                      oob_packet_buffer_.data() + bytes_transferred);
-        received_oob_packet_callback_(std::move(oob_data));
-      }
-    }
-    oob_socket_.async_receive_from(asio::buffer(oob_packet_buffer_),
-                                   sender_address_,
-                                   std::bind(&NetworkTransport::oobPacketHandler,
-                                             this, std::placeholders::_1, std::placeholders::_2));
+  if (!received_oob_packet_callback_)
+    return;
+
+  // Unverified packets are verified and recorded by whoever consumes them
+  if (!verify_oob_packets_) {
+    received_oob_packet_callback_(std::vector<uint8_t>(data, data + length), false);
+    return;
+  }
+
+  bool verified = Utility::VerifyOobPacket(data, length);
+  LDCP_TRACE(TRACE_EVENT_CRC_VERIFY, verified);
+  std::shared_ptr<FlightRecorder> flight_recorder = std::atomic_load(&flight_recorder_);
+  if (flight_recorder)
+    flight_recorder->recordOobPacket(data, length, verified);
+  if (verified) {
+    std::vector<uint8_t> oob_data(data, data + length);
+    received_oob_packet_callback_(std::move(oob_data), true);
   }
 }
 
-rapidjson::Document NetworkTransport::parseIncomingMessage(size_t length)
+PooledDocument NetworkTransport::parseIncomingMessage(size_t length)
 {
-  rapidjson::Document message;
+  PooledDocument message = document_pool_->createDocument();
 
   size_t bytes_buffered = incoming_message_buffer_.size();
+  std::shared_ptr<FlightRecorder> flight_recorder = std::atomic_load(&flight_recorder_);
+  if (flight_recorder)
+    flight_recorder->record(FLIGHT_RECORD_MESSAGE_RECEIVED,
+                             asio::buffer_cast<const uint8_t*>(incoming_message_buffer_.data()), length);
 
+  bool parsed = false;
   std::istream istream(&incoming_message_buffer_);
   if (istream.peek() == '{') {
     rapidjson::IStreamWrapper istream_wrapper(istream);
-    message.ParseStream<rapidjson::kParseStopWhenDoneFlag>(istream_wrapper);
+    parsed = document_pool_->parse<rapidjson::kParseStopWhenDoneFlag>(istream_wrapper, message);
   }
   else {
     try {
@@ -302,7 +333,7 @@ rapidjson::Document NetworkTransport::parseIncomingMessage(size_t length)
         }
         else {
           rapidjson::IStreamWrapper istream_wrapper(istream);
-          message.ParseStream<rapidjson::kParseStopWhenDoneFlag>(istream_wrapper);
+          parsed = document_pool_->parse<rapidjson::kParseStopWhenDoneFlag>(istream_wrapper, message);
           break;
         }
       }
@@ -316,7 +347,7 @@ rapidjson::Document NetworkTransport::parseIncomingMessage(size_t length)
   istream.clear();
   istream.ignore(length - bytes_consumed);
 
-  if (message.HasParseError() || !message.IsObject())
+  if (!parsed || !message.IsObject())
     message.SetNull();
 
   return message;
@@ -324,38 +355,29 @@ rapidjson::Document NetworkTransport::parseIncomingMessage(size_t length)
 
 void NetworkTransport::encapsulateOutgoingMessage(rapidjson::Document& message)
 {
-  std::ostream ostream_main_part(&outgoing_message_buffers_[1]);
-  rapidjson::OStreamWrapper ostream_wrapper(ostream_main_part);
-  rapidjson::Writer<rapidjson::OStreamWrapper> writer(ostream_wrapper);
-  message.Accept(writer);
-
-  size_t length = outgoing_message_buffers_[1].size();
-  uint16_t checksum = Utility::CalculateCRC16(asio::buffers_begin(outgoing_message_buffers_[1].data()),
-      asio::buffers_end(outgoing_message_buffers_[1].data()));
-
-  std::ostream ostream_leading_part(&outgoing_message_buffers_[0]);
-  ostream_leading_part << "15:checksum=0x"
-                       << std::hex << std::setw(4) << std::setfill('0') << std::uppercase
-                       << checksum << ",";
-  ostream_leading_part << "0:,";
-  ostream_leading_part << std::dec << length << ":";
-
-  std::ostream ostream_trailing_part(&outgoing_message_buffers_[2]);
-  ostream_trailing_part << ",\r\n";
+  outgoing_message_body_.Clear();
+  outgoing_message_writer_.Reset(outgoing_message_body_);
+  message.Accept(outgoing_message_writer_);
+
+  const char* body = outgoing_message_body_.GetString();
+  size_t length = outgoing_message_body_.GetSize();
+  std::shared_ptr<FlightRecorder> flight_recorder = std::atomic_load(&flight_recorder_);
+  if (flight_recorder)
+    flight_recorder->record(FLIGHT_RECORD_MESSAGE_TRANSMITTED, reinterpret_cast<const uint8_t*>(body), length);
+  uint16_t checksum = Utility::CalculateCRC16(body, body + length);
+
+  int header_length = std::snprintf(outgoing_message_header_, sizeof(outgoing_message_header_),
+                                    "15:checksum=0x%04X,0:,%u:", checksum, (unsigned int)length);
+  outgoing_message_header_length_ = (size_t)header_length;
 }
 
-bool NetworkTransport::verifyOobPacket(uint8_t* data, int length)
+Transport::Transport()
+  : document_pool_(nullptr)
+  , oob_receive_mode_(OOB_RECEIVE_MODE_REACTOR)
+  , busy_poll_timeout_(0)
+  , oob_receive_buffer_size_(0)
+  , verify_oob_packets_(true)
 {
-  OobPacketHeader* oob_packet_header = reinterpret_cast<OobPacketHeader*>(data);
-
-  if (length < sizeof(OobPacketHeader) || oob_packet_header->signature != 0xFFFF)
-    return false;
-
-  uint16_t saved_checksum = oob_packet_header->checksum;
-  oob_packet_header->checksum = 0;
-  bool packet_valid = (Utility::CalculateCRC16(data, data + length) == saved_checksum);
-  oob_packet_header->checksum = saved_checksum;
-  return packet_valid;
 }
 
 std::unique_ptr<Transport> Transport::create(const Location& location)
@@ -367,6 +389,11 @@ std::unique_ptr<Transport> Transport::create(const Location& location)
     return nullptr;
 }
 
+void Transport::setDocumentPool(DocumentPool* document_pool)
+{
+  document_pool_ = document_pool;
+}
+
 void Transport::setReceivedMessageCallback(Transport::ReceivedMessageCallback callback)
 {
   received_message_callback_ = callback;
@@ -387,4 +414,25 @@ void Transport::setReceivedOobPacketCallback(Transport::ReceivedOobPacketCallbac
   received_oob_packet_callback_ = callback;
 }
 
+void Transport::setOobReceiveMode(oob_receive_mode_t mode, int busy_poll_timeout)
+{
+  oob_receive_mode_ = mode;
+  busy_poll_timeout_ = busy_poll_timeout;
+}
+
+void Transport::setOobReceiveBufferSize(int size)
+{
+  oob_receive_buffer_size_ = size;
+}
+
+void Transport::setOobPacketVerification(bool enabled)
+{
+  verify_oob_packets_ = enabled;
+}
+
+void Transport::setFlightRecorder(std::shared_ptr<FlightRecorder> flight_recorder)
+{
+  std::atomic_store(&flight_recorder_, flight_recorder);
+}
+
 }
@@ -0,0 +1,92 @@
+#include "ldcp/background_model.h"
+#include "scene.h"
+#include "test.h"
+
+#include <vector>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 1000;
+static const int LEARNING_FRAMES = 20;
+
+static int foregroundCount(const BackgroundModel& model)
+{
+  int count = 0;
+  for (uint8_t foreground : model.foregroundMask())
+    count += foreground;
+  return count;
+}
+
+// A static scene has no foreground, including beams that only start to
+// return after learning once they have been seen.
+static void testStaticScene()
+{
+  BackgroundModel model;
+  model.setLearningFrames(LEARNING_FRAMES);
+  ScanFrame scan_frame;
+  std::vector<ForegroundSegment> segments;
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 4000, scan_frame);
+  for (int i = 10; i < 15; i++)
+    scan_frame.layers[0].ranges[i] = 0;
+  for (int k = 0; k < LEARNING_FRAMES; k++)
+    model.process(scan_frame, segments);
+  EXPECT_TRUE(model.isLearned());
+
+  model.process(scan_frame, segments);
+  EXPECT_EQ(0u, segments.size());
+  EXPECT_EQ(0, foregroundCount(model));
+
+  // The open beams are foreground the first time they return
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 4000, scan_frame);
+  model.process(scan_frame, segments);
+  EXPECT_EQ(1u, segments.size());
+  if (segments.size() == 1) {
+    EXPECT_EQ(10, segments[0].begin);
+    EXPECT_EQ(15, segments[0].end);
+  }
+
+  for (int k = 0; k < LEARNING_FRAMES; k++)
+    model.process(scan_frame, segments);
+  EXPECT_EQ(0u, segments.size());
+  EXPECT_EQ(0, foregroundCount(model));
+}
+
+// An object placed in front of the background is reported, and so is the
+// background it uncovers once a learned object leaves.
+static void testArrivingAndDepartingObjects()
+{
+  BackgroundModel model;
+  model.setLearningFrames(LEARNING_FRAMES);
+  ScanFrame scan_frame;
+  std::vector<ForegroundSegment> segments;
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 4000, scan_frame);
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  for (int i = 200; i < 220; i++)
+    ranges[i] = 2500;
+  for (int k = 0; k < LEARNING_FRAMES; k++)
+    model.process(scan_frame, segments);
+
+  for (int i = 100; i < 120; i++)
+    ranges[i] = 2000;
+  for (int i = 200; i < 220; i++)
+    ranges[i] = 4000;
+  model.process(scan_frame, segments);
+  EXPECT_EQ(2u, segments.size());
+  if (segments.size() == 2) {
+    EXPECT_EQ(100, segments[0].begin);
+    EXPECT_EQ(120, segments[0].end);
+    EXPECT_EQ(2000, segments[0].min_range);
+    EXPECT_EQ(200, segments[1].begin);
+    EXPECT_EQ(220, segments[1].end);
+    EXPECT_NEAR(4000.0, segments[1].mean_range, 1e-3);
+  }
+  EXPECT_EQ(40, foregroundCount(model));
+}
+
+int main()
+{
+  testStaticScene();
+  testArrivingAndDepartingObjects();
+  return ldcp_sdk::test::testResult();
+}
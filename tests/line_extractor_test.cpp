@@ -0,0 +1,101 @@
+#include "ldcp/line_extractor.h"
+#include "scene.h"
+#include "test.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 7200;
+
+// Walls at x = 5, y = 4, x = -3 and y = -2 around the sensor. The x = -3
+// wall straddles the seam of the 360 degree frame.
+static const Room ROOM = { -3, 5, -2, 4, {} };
+
+static bool hasLine(const std::vector<LineFeature>& lines, double rho, double alpha)
+{
+  for (const LineFeature& line : lines) {
+    double difference = std::remainder(line.alpha - alpha, 2 * PI);
+    if (std::fabs(line.rho - rho) < 0.01 && std::fabs(difference) < 0.01)
+      return true;
+  }
+  return false;
+}
+
+static bool hasCorner(const std::vector<CornerFeature>& corners, double x, double y)
+{
+  for (const CornerFeature& corner : corners) {
+    if (std::fabs(corner.x - x) < 0.01 && std::fabs(corner.y - y) < 0.01 && std::fabs(corner.angle - PI / 2) < 0.01)
+      return true;
+  }
+  return false;
+}
+
+// A room seen all around is one closed contour: the wall across the seam
+// is a single line and the corner between the last and the first line is
+// found like the others.
+static void testClosedContour()
+{
+  ScanFrame scan_frame;
+  scanRoom(ROOM, Pose2D(), BEAM_COUNT, scan_frame);
+
+  LineExtractor extractor;
+  std::vector<LineFeature> lines;
+  std::vector<CornerFeature> corners;
+  extractor.process(scan_frame, lines, corners);
+
+  EXPECT_EQ(4u, lines.size());
+  EXPECT_TRUE(hasLine(lines, 5, 0));
+  EXPECT_TRUE(hasLine(lines, 4, PI / 2));
+  EXPECT_TRUE(hasLine(lines, 3, PI));
+  EXPECT_TRUE(hasLine(lines, 2, -PI / 2));
+
+  EXPECT_EQ(4u, corners.size());
+  EXPECT_TRUE(hasCorner(corners, 5, 4));
+  EXPECT_TRUE(hasCorner(corners, -3, 4));
+  EXPECT_TRUE(hasCorner(corners, -3, -2));
+  EXPECT_TRUE(hasCorner(corners, 5, -2));
+
+  // Consecutive lines share their corner point, the last one with the first
+  for (size_t i = 0; i < lines.size(); i++) {
+    const LineFeature& line = lines[i];
+    const LineFeature& next = lines[(i + 1) % lines.size()];
+    EXPECT_TRUE(line.begin >= 0 && line.begin < BEAM_COUNT);
+    EXPECT_EQ(next.begin, (line.end - 1) % BEAM_COUNT);
+  }
+}
+
+// Cut open across the seam, the wall there is two lines and the ends of the
+// contour are not joined by a corner.
+static void testOpenContour()
+{
+  ScanFrame scan_frame;
+  scanRoom(ROOM, Pose2D(), BEAM_COUNT, scan_frame);
+  for (int i = 0; i < 40; i++) {
+    scan_frame.layers[0].ranges[i] = 0;
+    scan_frame.layers[0].ranges[BEAM_COUNT - 1 - i] = 0;
+  }
+
+  LineExtractor extractor;
+  std::vector<LineFeature> lines;
+  std::vector<CornerFeature> corners;
+  extractor.process(scan_frame, lines, corners);
+
+  EXPECT_EQ(5u, lines.size());
+  if (lines.size() == 5) {
+    EXPECT_TRUE(hasLine(lines, 3, PI));
+    EXPECT_EQ(40, lines.front().begin);
+    EXPECT_EQ(BEAM_COUNT - 40, lines.back().end);
+  }
+  for (const CornerFeature& corner : corners)
+    EXPECT_TRUE(corner.second_line == corner.first_line + 1);
+}
+
+int main()
+{
+  testClosedContour();
+  testOpenContour();
+  return ldcp_sdk::test::testResult();
+}
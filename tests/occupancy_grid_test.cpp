@@ -0,0 +1,101 @@
+#include "ldcp/occupancy_grid.h"
+#include "scene.h"
+#include "test.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 7200;
+static const int FRAME_COUNT = 12;
+
+// A 14 m x 9 m room with a pillar in it
+static const Room ROOM = { -6, 8, -4, 5, { { 2, 1.5, 0.3 } } };
+
+static Pose2D sensorPose(int k)
+{
+  Pose2D pose;
+  pose.x = -2 + 0.3 * k;
+  pose.y = 0.1 * std::sin((double)k);
+  pose.theta = 0.3 * k;
+  return pose;
+}
+
+static void buildGrid(OccupancyGrid& grid, OccupancyGridSnapshot* first_snapshot)
+{
+  ScanFrame scan_frame;
+  for (int k = 0; k < FRAME_COUNT; k++) {
+    Pose2D pose = sensorPose(k);
+    scanRoom(ROOM, pose, BEAM_COUNT, scan_frame);
+    EXPECT_TRUE(grid.update(scan_frame, pose) == ldcp_sdk::error_t::no_error);
+    if (k == 0 && first_snapshot)
+      grid.snapshot(*first_snapshot);
+  }
+}
+
+// Walls and the pillar end up occupied, the room free and the outside
+// unknown.
+static void testMapsRoom()
+{
+  OccupancyGrid grid(0.05, 1);
+  OccupancyGridSnapshot first;
+  buildGrid(grid, &first);
+  OccupancyGridSnapshot snapshot;
+  grid.snapshot(snapshot);
+
+  EXPECT_TRUE(snapshot.probability(7.99, 0.5) > 0.9);
+  EXPECT_TRUE(snapshot.probability(-5.99, -1) > 0.9);
+  EXPECT_TRUE(snapshot.probability(1, -3.99) > 0.9);
+  EXPECT_TRUE(snapshot.probability(0, 4.99) > 0.9);
+  EXPECT_TRUE(snapshot.probability(1.72, 1.5) > 0.9);
+  EXPECT_EQ(-1.0f, snapshot.probability(10, 0));
+  EXPECT_EQ(-1.0f, snapshot.probability(2, 1.5));
+
+  // Inside the room only cells in the shadow of the pillar stay unknown
+  int occupied = 0, unknown = 0, cell_count = 0;
+  for (double x = -5.8; x < 7.8; x += 0.05) {
+    for (double y = -3.8; y < 4.8; y += 0.05) {
+      if (std::hypot(x - 2, y - 1.5) < 0.45)
+        continue;
+      float probability = snapshot.probability(x, y);
+      occupied += (probability >= 0.5);
+      unknown += (probability < 0);
+      cell_count++;
+    }
+  }
+  EXPECT_EQ(0, occupied);
+  EXPECT_TRUE(unknown < cell_count / 500);
+
+  // The snapshot taken after the first frame does not see later updates
+  EXPECT_TRUE(first.probability(5, 3) != snapshot.probability(5, 3));
+  EXPECT_NEAR(0.7, first.probability(-5.99, 0), 0.01);
+}
+
+// Splitting the frame into sectors over several workers gives the same map.
+static void testWorkersAgree()
+{
+  OccupancyGrid single(0.05, 1), multiple(0.05, 3);
+  buildGrid(single, nullptr);
+  buildGrid(multiple, nullptr);
+  EXPECT_EQ(single.tileCount(), multiple.tileCount());
+
+  OccupancyGridSnapshot single_snapshot, multiple_snapshot;
+  single.snapshot(single_snapshot);
+  multiple.snapshot(multiple_snapshot);
+  std::vector<int8_t> single_cells, multiple_cells;
+  int width, height;
+  double origin_x, origin_y;
+  single_snapshot.exportCells(single_cells, width, height, origin_x, origin_y);
+  EXPECT_EQ((size_t)width * height, single_cells.size());
+  multiple_snapshot.exportCells(multiple_cells, width, height, origin_x, origin_y);
+  EXPECT_TRUE(single_cells == multiple_cells);
+}
+
+int main()
+{
+  testMapsRoom();
+  testWorkersAgree();
+  return ldcp_sdk::test::testResult();
+}
@@ -0,0 +1,223 @@
+#include "ldcp/reflector_detector.h"
+#include "scene.h"
+#include "test.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 3600;
+
+static void markReflector(ScanFrame& scan_frame, int begin, int end, int intensity)
+{
+  int beam_count = (int)scan_frame.layers[0].intensities.size();
+  for (int i = begin; i < end; i++)
+    scan_frame.layers[0].intensities[i % beam_count] = intensity;
+}
+
+// A reflector straddling beam 0 of a 360 degree frame is one run whose
+// indices go past the beam count, centred on the seam.
+static void testSeamMerge()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 2000, scan_frame);
+  markReflector(scan_frame, BEAM_COUNT - 5, BEAM_COUNT + 5, 250);
+
+  ScanGeometry geometry;
+  geometry.update(ANGULAR_FOV_360DEG, BEAM_COUNT);
+  double first_angle = geometry.angle(BEAM_COUNT - 5), last_angle = geometry.angle(4);
+  double width = std::hypot(2.0 * (std::cos(first_angle) - std::cos(last_angle)),
+                            2.0 * (std::sin(first_angle) - std::sin(last_angle)));
+
+  ReflectorDetector detector;
+  std::vector<Reflector> reflectors;
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(1u, reflectors.size());
+  if (reflectors.size() == 1) {
+    const Reflector& reflector = reflectors[0];
+    EXPECT_EQ(BEAM_COUNT - 5, reflector.begin);
+    EXPECT_EQ(BEAM_COUNT + 5, reflector.end);
+    EXPECT_NEAR(BEAM_COUNT - 0.5, reflector.beam_index, 1e-3);
+    EXPECT_NEAR(2.0, reflector.range, 1e-4);
+    EXPECT_NEAR(2.0 * std::cos(geometry.angle(0) - geometry.angleIncrement() / 2), reflector.x, 1e-4);
+    EXPECT_NEAR(2.0 * std::sin(geometry.angle(0) - geometry.angleIncrement() / 2), reflector.y, 1e-4);
+    EXPECT_NEAR(width, reflector.width, 1e-4);
+    EXPECT_EQ(250, reflector.peak_intensity);
+  }
+
+  // A range jump across the seam keeps the two ends apart
+  for (int i = 0; i < 5; i++)
+    scan_frame.layers[0].ranges[i] = 3000;
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(2u, reflectors.size());
+  if (reflectors.size() == 2) {
+    EXPECT_EQ(0, reflectors[0].begin);
+    EXPECT_EQ(5, reflectors[0].end);
+    EXPECT_EQ(BEAM_COUNT - 5, reflectors[1].begin);
+    EXPECT_EQ(BEAM_COUNT, reflectors[1].end);
+  }
+
+  // The ends of a 270 degree frame are not neighbours
+  scan_frame.angular_fov = ANGULAR_FOV_270DEG;
+  for (int i = 0; i < 5; i++)
+    scan_frame.layers[0].ranges[i] = 2000;
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(2u, reflectors.size());
+}
+
+// A range jump inside a bright run splits it into two reflectors.
+static void testRangeJumpSplit()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 2000, scan_frame);
+  markReflector(scan_frame, 1000, 1010, 250);
+  for (int i = 1005; i < 1010; i++)
+    scan_frame.layers[0].ranges[i] = 2500;
+
+  ReflectorDetector detector;
+  std::vector<Reflector> reflectors;
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(2u, reflectors.size());
+  if (reflectors.size() == 2) {
+    EXPECT_EQ(1000, reflectors[0].begin);
+    EXPECT_EQ(1005, reflectors[0].end);
+    EXPECT_NEAR(2.0, reflectors[0].range, 1e-4);
+    EXPECT_EQ(1005, reflectors[1].begin);
+    EXPECT_EQ(1010, reflectors[1].end);
+    EXPECT_NEAR(2.5, reflectors[1].range, 1e-4);
+  }
+
+  // Within the jump limit the run stays whole
+  detector.setMaxRangeJump(500);
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(1u, reflectors.size());
+}
+
+// The centre is weighted by how far each beam exceeds the threshold, and the
+// radius of a cylindrical reflector is added to its range.
+static void testSubBeamCentre()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 2000, scan_frame);
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  intensities[2000] = 300;
+  intensities[2001] = 300;
+  intensities[2002] = 200;
+
+  ReflectorDetector detector;
+  detector.setReflectorRadius(0.05f);
+  std::vector<Reflector> reflectors;
+  detector.process(scan_frame, reflectors);
+  EXPECT_EQ(1u, reflectors.size());
+  if (reflectors.size() == 1) {
+    const Reflector& reflector = reflectors[0];
+    double beam_index = (101.0 * 2000 + 101.0 * 2001 + 1.0 * 2002) / 203;
+    ScanGeometry geometry;
+    geometry.update(ANGULAR_FOV_360DEG, BEAM_COUNT);
+    double angle = ScanGeometry::startAngle(ANGULAR_FOV_360DEG) + beam_index * geometry.angleIncrement();
+    EXPECT_NEAR(beam_index, reflector.beam_index, 1e-3);
+    EXPECT_NEAR(angle, reflector.angle, 1e-5);
+    EXPECT_NEAR(2.05, reflector.range, 1e-4);
+    EXPECT_NEAR(2.05 * std::cos(angle), reflector.x, 1e-4);
+    EXPECT_NEAR(2.05 * std::sin(angle), reflector.y, 1e-4);
+    EXPECT_EQ(300, reflector.peak_intensity);
+  }
+}
+
+// 16-bit intensities need the threshold on their own scale; scaled by 257
+// it finds the same reflector as the default does on 8-bit intensities.
+static void testIntensityWidth()
+{
+  ScanFrame frame_8bit, frame_16bit;
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 2000, frame_8bit);
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 2000, frame_16bit);
+  for (int i = 0; i < BEAM_COUNT; i++)
+    frame_16bit.layers[0].intensities[i] = 100 * 257;
+  markReflector(frame_8bit, 500, 506, 250);
+  markReflector(frame_16bit, 500, 506, 250 * 257);
+
+  ReflectorDetector detector;
+  std::vector<Reflector> reflectors_8bit, reflectors_16bit;
+  detector.process(frame_8bit, reflectors_8bit);
+  EXPECT_EQ(1u, reflectors_8bit.size());
+
+  // Every 16-bit beam clears the 8-bit threshold, so the whole frame is one
+  // run, far too wide for a reflector
+  detector.process(frame_16bit, reflectors_16bit);
+  EXPECT_TRUE(reflectors_16bit.empty());
+
+  detector.setIntensityThreshold(200 * 257);
+  detector.process(frame_16bit, reflectors_16bit);
+  EXPECT_EQ(1u, reflectors_16bit.size());
+  if (reflectors_8bit.size() == 1 && reflectors_16bit.size() == 1) {
+    EXPECT_EQ(reflectors_8bit[0].begin, reflectors_16bit[0].begin);
+    EXPECT_EQ(reflectors_8bit[0].end, reflectors_16bit[0].end);
+    EXPECT_NEAR(reflectors_8bit[0].beam_index, reflectors_16bit[0].beam_index, 1e-3);
+    EXPECT_EQ(250 * 257, reflectors_16bit[0].peak_intensity);
+  }
+}
+
+// The word-at-a-time skip finds every run a beam-by-beam scan finds,
+// including single beams, runs off word boundaries and runs ending on the
+// last beam of a frame whose length is not a multiple of the word size.
+static void testWordSkip()
+{
+  const int beam_count = 1083;
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_270DEG, beam_count, 2000, scan_frame);
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+
+  ReflectorDetector detector;
+  detector.setBeamCountLimits(1, INT_MAX);
+  detector.setWidthLimits(0, 1e9f);
+  std::vector<Reflector> reflectors;
+  for (int round = 0; round < 20; round++) {
+    std::srand(round);
+    for (int i = 0; i < beam_count; i++) {
+      int event = std::rand() % 100;
+      intensities[i] = (event < 5 + round) ? 250 : 100;
+      ranges[i] = (event == 99) ? 0 : 2000;
+    }
+    if (round % 2 == 0) {
+      intensities[beam_count - 1] = 250;
+      ranges[beam_count - 1] = 2000;
+    }
+
+    std::vector<int> begins, ends;
+    bool in_run = false;
+    for (int i = 0; i < beam_count; i++) {
+      bool bright = intensities[i] >= 200 && ranges[i] > 0;
+      if (bright && !in_run)
+        begins.push_back(i);
+      if (!bright && in_run)
+        ends.push_back(i);
+      in_run = bright;
+    }
+    if (in_run)
+      ends.push_back(beam_count);
+
+    detector.process(scan_frame, reflectors);
+    EXPECT_EQ(begins.size(), reflectors.size());
+    if (begins.size() == reflectors.size()) {
+      for (size_t i = 0; i < reflectors.size(); i++) {
+        EXPECT_EQ(begins[i], reflectors[i].begin);
+        EXPECT_EQ(ends[i], reflectors[i].end);
+      }
+    }
+  }
+}
+
+int main()
+{
+  testSeamMerge();
+  testRangeJumpSplit();
+  testSubBeamCentre();
+  testIntensityWidth();
+  testWordSkip();
+  return testResult();
+}
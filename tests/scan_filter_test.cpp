@@ -0,0 +1,141 @@
+#include "ldcp/scan_filter.h"
+#include "ldcp/scan_geometry.h"
+#include "scene.h"
+#include "test.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace ldcp_sdk;
+
+static const int BEAM_COUNT = 2600;
+static const double ANGLE_INCREMENT = 2 * PI / 120000;
+
+// Straightforward per-beam version of the filter chain over the whole frame,
+// without tiles, used as the reference for the fused implementation.
+static void referenceFilter(std::vector<int>& ranges, std::vector<int>& intensities, int min_range,
+                            int max_range, int min_intensity, double shadow_angle, int window)
+{
+  const int beam_count = (int)ranges.size();
+  const float sin_increment = (float)std::sin(ANGLE_INCREMENT);
+  const float cos_increment = (float)std::cos(ANGLE_INCREMENT);
+  const float tan_shadow_angle = (float)std::tan(shadow_angle);
+
+  std::vector<int> kept(beam_count);
+  for (int i = 0; i < beam_count; i++) {
+    int range = ranges[i];
+    bool keep = range > 0 && range >= min_range && range <= max_range && intensities[i] >= min_intensity;
+    for (int j = i - 1; j <= i + 1; j += 2) {
+      int neighbour = (j >= 0 && j < beam_count) ? ranges[j] : 0;
+      float y = neighbour * sin_increment;
+      float x = range - neighbour * cos_increment;
+      if (neighbour > 0 && y < tan_shadow_angle * std::fabs(x))
+        keep = false;
+    }
+    kept[i] = keep ? range : 0;
+  }
+
+  const int radius = window / 2;
+  for (int i = 0; i < beam_count; i++) {
+    int center = kept[i];
+    if (center == 0) {
+      ranges[i] = 0;
+      intensities[i] = 0;
+      continue;
+    }
+    std::vector<int> values;
+    for (int j = i - radius; j <= i + radius; j++) {
+      int value = (j >= 0 && j < beam_count) ? kept[j] : 0;
+      values.push_back((value > 0) ? value : center);
+    }
+    std::nth_element(values.begin(), values.begin() + radius, values.end());
+    ranges[i] = values[radius];
+  }
+}
+
+static void makeRandomFrame(unsigned int seed, ScanFrame& scan_frame)
+{
+  std::srand(seed);
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 0, scan_frame);
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  std::vector<int>& intensities = scan_frame.layers[0].intensities;
+  int range = 5000;
+  for (int i = 0; i < BEAM_COUNT; i++) {
+    // Smooth walls with occasional jumps, spikes and dropouts
+    int event = std::rand() % 100;
+    if (event < 3)
+      range = 500 + std::rand() % 20000;
+    else
+      range += std::rand() % 21 - 10;
+    ranges[i] = (event == 3) ? range + 3000 : (event == 4) ? 0 : range;
+    intensities[i] = std::rand() % 256;
+  }
+}
+
+static void testMatchesReference()
+{
+  const int windows[] = { 1, 3, 5 };
+  for (int window : windows) {
+    for (unsigned int seed = 1; seed <= 5; seed++) {
+      ScanFrame scan_frame;
+      makeRandomFrame(seed, scan_frame);
+      std::vector<int> ranges = scan_frame.layers[0].ranges;
+      std::vector<int> intensities = scan_frame.layers[0].intensities;
+
+      ScanFilter filter;
+      filter.setRangeLimits(300, 18000);
+      filter.setIntensityLimits(10, INT_MAX);
+      filter.setShadowAngle(0.1);
+      filter.setMedianWindow(window);
+      filter.apply(scan_frame.layers[0].ranges.data(), scan_frame.layers[0].intensities.data(), BEAM_COUNT,
+                   ANGLE_INCREMENT);
+      referenceFilter(ranges, intensities, 300, 18000, 10, 0.1, window);
+
+      int mismatches = 0;
+      for (int i = 0; i < BEAM_COUNT; i++) {
+        mismatches += (scan_frame.layers[0].ranges[i] != ranges[i]);
+        mismatches += (scan_frame.layers[0].intensities[i] != intensities[i]);
+      }
+      EXPECT_EQ(0, mismatches);
+    }
+  }
+}
+
+// Beams on either side of a tile boundary see their neighbours across it,
+// both for the shadow test and for the median.
+static void testTileBoundary()
+{
+  const int boundary = 1024;
+  std::vector<int> ranges(2 * boundary, 4000);
+  std::vector<int> intensities(2 * boundary, 100);
+
+  ranges[boundary - 1] = 9000;
+  ranges[boundary + 1] = 8000;
+
+  ScanFilter filter;
+  filter.setMedianWindow(5);
+  filter.apply(ranges.data(), intensities.data(), (int)ranges.size(), ANGLE_INCREMENT);
+  EXPECT_EQ(4000, ranges[boundary - 1]);
+  EXPECT_EQ(4000, ranges[boundary + 1]);
+
+  std::vector<int> shadowed(2 * boundary, 4000);
+  shadowed[boundary] = 9000;
+  filter.setMedianWindow(1);
+  filter.setShadowAngle(0.1);
+  filter.apply(shadowed.data(), nullptr, (int)shadowed.size(), ANGLE_INCREMENT);
+  EXPECT_EQ(0, shadowed[boundary - 1]);
+  EXPECT_EQ(0, shadowed[boundary]);
+  EXPECT_EQ(0, shadowed[boundary + 1]);
+  EXPECT_EQ(4000, shadowed[boundary - 2]);
+  EXPECT_EQ(4000, shadowed[boundary + 2]);
+}
+
+int main()
+{
+  testMatchesReference();
+  testTileBoundary();
+  return ldcp_sdk::test::testResult();
+}
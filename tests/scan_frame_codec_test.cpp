@@ -0,0 +1,126 @@
+#include "ldcp/scan_frame_codec.h"
+#include "scene.h"
+#include "test.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace ldcp_sdk;
+
+// Not a multiple of the chunk length
+static const int BEAM_COUNT = 1000;
+// Offset of the first channel's value count in a frame without blocks
+static const size_t FIRST_COUNT_OFFSET = 24;
+
+static void makeRandomFrame(unsigned int seed, ScanFrame& scan_frame)
+{
+  std::srand(seed);
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 0, scan_frame);
+  scan_frame.layers.resize(2);
+  scan_frame.timestamp = 123456;
+  scan_frame.host_timestamp = 9876543210;
+  for (ScanFrame::FrameData& layer : scan_frame.layers) {
+    layer.ranges.resize(BEAM_COUNT);
+    layer.intensities.resize(BEAM_COUNT);
+    int range = 5000;
+    for (int i = 0; i < BEAM_COUNT; i++) {
+      int event = std::rand() % 100;
+      range = (event < 3) ? std::rand() % 60000 : range + std::rand() % 41 - 20;
+      layer.ranges[i] = (event == 3) ? 0 : range;
+      layer.intensities[i] = std::rand() % 256;
+    }
+  }
+  for (int i = 0; i < 5; i++) {
+    scan_frame.block_timestamps.push_back(1000 * i);
+    scan_frame.block_host_timestamps.push_back(2000000 * (int64_t)i);
+  }
+}
+
+static void testRoundTrip()
+{
+  ScanFrameCodec codec;
+  for (unsigned int seed = 1; seed <= 5; seed++) {
+    ScanFrame scan_frame;
+    makeRandomFrame(seed, scan_frame);
+    std::vector<uint8_t> data;
+    codec.encode(scan_frame, data);
+    EXPECT_TRUE(data.size() < (size_t)BEAM_COUNT * 2 * 2 * sizeof(int));
+
+    ScanFrame decoded;
+    EXPECT_TRUE(codec.decode(data.data(), data.size(), decoded) == ldcp_sdk::error_t::no_error);
+    EXPECT_EQ(scan_frame.timestamp, decoded.timestamp);
+    EXPECT_EQ(scan_frame.host_timestamp, decoded.host_timestamp);
+    EXPECT_EQ(scan_frame.angular_fov, decoded.angular_fov);
+    EXPECT_TRUE(scan_frame.block_timestamps == decoded.block_timestamps);
+    EXPECT_TRUE(scan_frame.block_host_timestamps == decoded.block_host_timestamps);
+    EXPECT_EQ(scan_frame.layers.size(), decoded.layers.size());
+    for (size_t j = 0; j < scan_frame.layers.size() && j < decoded.layers.size(); j++) {
+      EXPECT_TRUE(scan_frame.layers[j].ranges == decoded.layers[j].ranges);
+      EXPECT_TRUE(scan_frame.layers[j].intensities == decoded.layers[j].intensities);
+    }
+  }
+
+  // An empty layer round-trips as well
+  ScanFrame scan_frame, decoded;
+  test::makeFrame(ANGULAR_FOV_270DEG, 0, 0, scan_frame);
+  std::vector<uint8_t> data;
+  codec.encode(scan_frame, data);
+  EXPECT_TRUE(codec.decode(data.data(), data.size(), decoded) == ldcp_sdk::error_t::no_error);
+  EXPECT_EQ(1u, decoded.layers.size());
+  EXPECT_TRUE(decoded.layers[0].ranges.empty());
+}
+
+// Every truncation of a valid frame is rejected.
+static void testTruncated()
+{
+  ScanFrame scan_frame;
+  makeRandomFrame(1, scan_frame);
+  ScanFrameCodec codec;
+  std::vector<uint8_t> data;
+  codec.encode(scan_frame, data);
+
+  int accepted = 0;
+  for (size_t length = 0; length < data.size(); length++) {
+    std::vector<uint8_t> truncated(data.begin(), data.begin() + length);
+    ScanFrame decoded;
+    accepted += (codec.decode(truncated.data(), truncated.size(), decoded) == ldcp_sdk::error_t::no_error);
+  }
+  EXPECT_EQ(0, accepted);
+}
+
+// Value counts that would overflow the chunk count or exceed a revolution,
+// bit widths over 32 and a wrong signature are rejected.
+static void testCorrupt()
+{
+  ScanFrame scan_frame;
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 4000, scan_frame);
+  ScanFrameCodec codec;
+  std::vector<uint8_t> data;
+  codec.encode(scan_frame, data);
+
+  const uint32_t counts[] = { 0xffffffff, 0xffffff81, ScanFrameCodec::BEAM_COUNT_MAX + 1 };
+  for (uint32_t count : counts) {
+    std::vector<uint8_t> corrupt = data;
+    std::memcpy(&corrupt[FIRST_COUNT_OFFSET], &count, sizeof(count));
+    ScanFrame decoded;
+    EXPECT_TRUE(codec.decode(corrupt.data(), corrupt.size(), decoded) == ldcp_sdk::error_t::invalid_params);
+  }
+
+  std::vector<uint8_t> corrupt = data;
+  corrupt[FIRST_COUNT_OFFSET + sizeof(uint32_t)] = 33;
+  ScanFrame decoded;
+  EXPECT_TRUE(codec.decode(corrupt.data(), corrupt.size(), decoded) == ldcp_sdk::error_t::invalid_params);
+
+  corrupt = data;
+  corrupt[0] ^= 0xff;
+  EXPECT_TRUE(codec.decode(corrupt.data(), corrupt.size(), decoded) == ldcp_sdk::error_t::invalid_params);
+}
+
+int main()
+{
+  testRoundTrip();
+  testTruncated();
+  testCorrupt();
+  return ldcp_sdk::test::testResult();
+}
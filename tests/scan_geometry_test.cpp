@@ -0,0 +1,69 @@
+#include "ldcp/scan_geometry.h"
+#include "test.h"
+
+#include <cmath>
+
+using namespace ldcp_sdk;
+
+
+// fastAtan2 stays within its documented 2e-6 radians in every quadrant.
+static void testFastAtan2Accuracy()
+{
+  double max_error = 0;
+  const int steps = 1000000;
+  for (int i = 0; i <= steps; i++) {
+    double angle = -PI + 2 * PI * i / steps;
+    for (double radius = 0.01; radius < 100; radius *= 10) {
+      float x = (float)(radius * std::cos(angle)), y = (float)(radius * std::sin(angle));
+      double error = std::fabs(ScanGeometry::fastAtan2(y, x) - std::atan2((double)y, (double)x));
+      max_error = std::max(max_error, std::min(error, 2 * PI - error));
+    }
+  }
+  EXPECT_TRUE(max_error < 2e-6);
+  EXPECT_EQ(0.0f, ScanGeometry::fastAtan2(0, 1));
+  EXPECT_NEAR(PI / 2, ScanGeometry::fastAtan2(1, 0), 1e-6);
+  EXPECT_NEAR(-PI / 2, ScanGeometry::fastAtan2(-1, 0), 1e-6);
+}
+
+// A point anywhere within the middle of a beam at 120K maps back to that
+// beam, the lookup the scan matcher and the occupancy grid rely on, and to
+// its group at a decimated level.
+static void testBeamLookup()
+{
+  ScanGeometry geometry;
+  geometry.update(ANGULAR_FOV_360DEG, ScanGeometry::beamCount(SCAN_RESOLUTION_120K, ANGULAR_FOV_360DEG));
+  const int beam_count = geometry.beamCount();
+  const double increment = geometry.angleIncrement();
+  int mismatches = 0, decimated_mismatches = 0;
+  for (int i = 0; i < beam_count; i++) {
+    for (double offset = -0.4; offset <= 0.4; offset += 0.4) {
+      double angle = geometry.angle(i) + offset * increment;
+      float x = (float)(5 * std::cos(angle)), y = (float)(5 * std::sin(angle));
+      mismatches += (geometry.beamIndex(y, x) != i);
+      if (i % 4 != 0 && i % 4 != 3)
+        decimated_mismatches += (geometry.beamIndex(y, x, 4) != i / 4);
+    }
+  }
+  EXPECT_EQ(0, mismatches);
+  EXPECT_EQ(0, decimated_mismatches);
+}
+
+// Bearings outside a 270 degree field of view map to no beam.
+static void testBeamLookupOutsideFieldOfView()
+{
+  ScanGeometry geometry;
+  geometry.update(ANGULAR_FOV_270DEG, 2700);
+  EXPECT_EQ(-1, geometry.beamIndex(0.0f, -1.0f));
+  EXPECT_EQ(-1, geometry.beamIndex(-0.5f, -1.0f));
+  EXPECT_EQ(0, geometry.beamIndex((float)std::sin(-0.75 * PI), (float)std::cos(-0.75 * PI)));
+  EXPECT_EQ(1350, geometry.beamIndex(0.0f, 1.0f));
+  EXPECT_EQ(675, geometry.beamIndex(0.0f, 1.0f, 2));
+}
+
+int main()
+{
+  testFastAtan2Accuracy();
+  testBeamLookup();
+  testBeamLookupOutsideFieldOfView();
+  return ldcp_sdk::test::testResult();
+}
@@ -0,0 +1,66 @@
+#include "ldcp/scan_matcher.h"
+#include "scene.h"
+#include "test.h"
+
+#include <cmath>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 7200;
+static const int FRAME_COUNT = 16;
+
+// A 14 m x 9 m room with pillars in it
+static const Room ROOM = { -6, 8, -4, 5, { { 2, 1.5, 0.3 }, { -3, -2, 0.5 }, { 5, -2.5, 0.2 }, { -1, 3, 0.4 } } };
+
+// Drives through the room with a known motion, including two sudden jumps
+// that only the correlative search recovers, and checks every match and
+// the accumulated pose.
+static void testTracksKnownMotion()
+{
+  ScanFrame scan_frame;
+  ScanMatcher matcher;
+  double x = 0, y = 0, theta = 0;
+  unsigned int noise = 1;
+  for (int k = 0; k < FRAME_COUNT; k++) {
+    double velocity = 0.05 + 0.02 * std::sin(k * 0.3), turn_rate = 0.03 * std::cos(k * 0.2);
+    if (k % 8 == 5) {
+      velocity += 0.15;
+      turn_rate -= 0.06;
+    }
+    if (k > 0) {
+      x += std::cos(theta) * velocity;
+      y += std::sin(theta) * velocity;
+      theta += turn_rate;
+    }
+    Pose2D pose = { x, y, theta };
+    scanRoom(ROOM, pose, BEAM_COUNT, scan_frame);
+    for (int i = 0; i < BEAM_COUNT; i++) {
+      noise = noise * 1103515245 + 12345;
+      scan_frame.layers[0].ranges[i] += (int)((noise >> 16) % 21) - 10;
+    }
+
+    ScanMatch match;
+    EXPECT_TRUE(matcher.process(scan_frame, match) == ldcp_sdk::error_t::no_error);
+    if (k == 0) {
+      EXPECT_TRUE(!match.valid);
+      continue;
+    }
+    EXPECT_TRUE(match.valid);
+    EXPECT_NEAR(velocity, match.pose.x, 2e-3);
+    EXPECT_NEAR(0.0, match.pose.y, 2e-3);
+    EXPECT_NEAR(turn_rate, match.pose.theta, 5e-4);
+    EXPECT_TRUE(match.correspondence_count > BEAM_COUNT / 2);
+    EXPECT_TRUE(match.residual < 0.01);
+  }
+
+  EXPECT_NEAR(x, matcher.pose().x, 0.01);
+  EXPECT_NEAR(y, matcher.pose().y, 0.01);
+  EXPECT_NEAR(theta, matcher.pose().theta, 2e-3);
+}
+
+int main()
+{
+  testTracksKnownMotion();
+  return ldcp_sdk::test::testResult();
+}
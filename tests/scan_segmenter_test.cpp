@@ -0,0 +1,113 @@
+#include "ldcp/scan_segmenter.h"
+#include "scene.h"
+#include "test.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace ldcp_sdk;
+using namespace ldcp_sdk::test;
+
+static const int BEAM_COUNT = 3600;
+
+// An object straddling beam 0 of a 360 degree frame is one segment whose
+// indices run past the beam count.
+static void testSeamMerge()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 0, scan_frame);
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  for (int i = 0; i < 10; i++) {
+    ranges[i] = 2000;
+    ranges[BEAM_COUNT - 1 - i] = 2000;
+  }
+  ranges[1800] = ranges[1801] = ranges[1802] = 3000;
+
+  ScanGeometry geometry;
+  geometry.update(ANGULAR_FOV_360DEG, BEAM_COUNT);
+  double centroid_x = 0, centroid_y = 0;
+  for (int i = -10; i < 10; i++) {
+    double angle = geometry.angle((i + BEAM_COUNT) % BEAM_COUNT);
+    centroid_x += 2.0 * std::cos(angle) / 20;
+    centroid_y += 2.0 * std::sin(angle) / 20;
+  }
+
+  ScanSegmenter segmenter;
+  std::vector<ScanSegment> segments;
+  segmenter.process(scan_frame, segments);
+  EXPECT_EQ(2u, segments.size());
+  if (segments.size() == 2) {
+    EXPECT_EQ(1800, segments[0].begin);
+    EXPECT_EQ(1803, segments[0].end);
+    const ScanSegment& merged = segments[1];
+    EXPECT_EQ(BEAM_COUNT - 10, merged.begin);
+    EXPECT_EQ(BEAM_COUNT + 10, merged.end);
+    EXPECT_EQ(20, merged.point_count);
+    EXPECT_NEAR(centroid_x, merged.centroid_x, 1e-4);
+    EXPECT_NEAR(centroid_y, merged.centroid_y, 1e-4);
+  }
+
+  // Dropouts at the seam up to the gap limit do not split the object
+  ranges[BEAM_COUNT - 1] = ranges[0] = 0;
+  segmenter.setMaxGap(2);
+  segmenter.process(scan_frame, segments);
+  EXPECT_EQ(2u, segments.size());
+  if (segments.size() == 2) {
+    EXPECT_EQ(BEAM_COUNT - 10, segments[1].begin);
+    EXPECT_EQ(BEAM_COUNT + 10, segments[1].end);
+    EXPECT_EQ(18, segments[1].point_count);
+  }
+
+  segmenter.setMaxGap(1);
+  segmenter.process(scan_frame, segments);
+  EXPECT_EQ(3u, segments.size());
+}
+
+// The ends of a 270 degree frame are not neighbours.
+static void testNoMergeWithoutFullCircle()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 0, scan_frame);
+  std::vector<int>& ranges = scan_frame.layers[0].ranges;
+  for (int i = 0; i < 10; i++) {
+    ranges[i] = 2000;
+    ranges[BEAM_COUNT - 1 - i] = 2000;
+  }
+
+  ScanSegmenter segmenter;
+  std::vector<ScanSegment> segments;
+  segmenter.process(scan_frame, segments);
+  EXPECT_EQ(2u, segments.size());
+  if (segments.size() == 2) {
+    EXPECT_EQ(0, segments[0].begin);
+    EXPECT_EQ(10, segments[0].end);
+    EXPECT_EQ(BEAM_COUNT - 10, segments[1].begin);
+    EXPECT_EQ(BEAM_COUNT, segments[1].end);
+  }
+}
+
+// A wall all around the sensor is one closed contour.
+static void testClosedContour()
+{
+  ScanFrame scan_frame;
+  makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 5000, scan_frame);
+
+  ScanSegmenter segmenter;
+  std::vector<ScanSegment> segments;
+  segmenter.process(scan_frame, segments);
+  EXPECT_EQ(1u, segments.size());
+  if (segments.size() == 1) {
+    EXPECT_EQ(BEAM_COUNT, segments[0].end - segments[0].begin);
+    EXPECT_EQ(BEAM_COUNT, segments[0].point_count);
+    EXPECT_NEAR(0.0, segments[0].centroid_x, 1e-3);
+    EXPECT_NEAR(0.0, segments[0].centroid_y, 1e-3);
+  }
+}
+
+int main()
+{
+  testSeamMerge();
+  testNoMergeWithoutFullCircle();
+  testClosedContour();
+  return ldcp_sdk::test::testResult();
+}
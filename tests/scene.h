@@ -0,0 +1,80 @@
+#ifndef LDCP_SDK_TESTS_SCENE_H_
+#define LDCP_SDK_TESTS_SCENE_H_
+
+#include "ldcp/scan_geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Synthetic scenes for the processing stage tests: a rectangular room with
+// optional round pillars, scanned from a sensor pose into a single layer
+// frame.
+namespace ldcp_sdk
+{
+namespace test
+{
+
+struct Pillar
+{
+  double x, y, radius;
+};
+
+struct Room
+{
+  double min_x, max_x, min_y, max_y;
+  std::vector<Pillar> pillars;
+};
+
+// Distance from (x, y) along the unit direction (c, s) to the nearest wall
+// or pillar in front of it.
+inline double castRay(const Room& room, double x, double y, double c, double s)
+{
+  double range = 1e9;
+  if (c > 1e-9)
+    range = std::min(range, (room.max_x - x) / c);
+  if (c < -1e-9)
+    range = std::min(range, (room.min_x - x) / c);
+  if (s > 1e-9)
+    range = std::min(range, (room.max_y - y) / s);
+  if (s < -1e-9)
+    range = std::min(range, (room.min_y - y) / s);
+  for (const Pillar& pillar : room.pillars) {
+    double dx = pillar.x - x, dy = pillar.y - y;
+    double along = dx * c + dy * s;
+    double offset_squared = dx * dx + dy * dy - along * along;
+    if (offset_squared < pillar.radius * pillar.radius) {
+      double distance = along - std::sqrt(pillar.radius * pillar.radius - offset_squared);
+      if (distance > 0)
+        range = std::min(range, distance);
+    }
+  }
+  return range;
+}
+
+// Frame of beam_count beams all reading range, with intensity 100.
+inline void makeFrame(angular_fov_t angular_fov, int beam_count, int range, ScanFrame& scan_frame)
+{
+  scan_frame.angular_fov = angular_fov;
+  scan_frame.layers.resize(1);
+  scan_frame.layers[0].ranges.assign(beam_count, range);
+  scan_frame.layers[0].intensities.assign(beam_count, 100);
+}
+
+// The room as seen from the pose over a full circle, in millimetres.
+inline void scanRoom(const Room& room, const Pose2D& pose, int beam_count, ScanFrame& scan_frame)
+{
+  ScanGeometry geometry;
+  geometry.update(ANGULAR_FOV_360DEG, beam_count);
+  makeFrame(ANGULAR_FOV_360DEG, beam_count, 0, scan_frame);
+  for (int i = 0; i < beam_count; i++) {
+    double angle = geometry.angle(i) + pose.theta;
+    double range = castRay(room, pose.x, pose.y, std::cos(angle), std::sin(angle));
+    scan_frame.layers[0].ranges[i] = (int)(range * 1000 + 0.5);
+  }
+}
+
+}
+}
+
+#endif
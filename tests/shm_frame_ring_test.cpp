@@ -0,0 +1,153 @@
+#include "ldcp/shm_frame_ring.h"
+#include "scene.h"
+#include "test.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace ldcp_sdk;
+
+#ifdef __linux__
+
+static const int BEAM_COUNT = 1000;
+static const int TIMEOUT = 50;
+// Layout of the ring the tests tamper with: a 64 byte ring header followed
+// by the slots, each starting with its sequence counter, and the beam count
+// 28 bytes into the slot header.
+static const size_t SLOT_OFFSET = 64;
+static const size_t BEAM_COUNT_OFFSET = 28;
+
+static std::string ringName()
+{
+  return "/ldcp_sdk_shm_frame_ring_test_" + std::to_string(getpid());
+}
+
+// Writable mapping of the whole ring, as a crashed or hostile publisher
+// would leave it.
+class RingMapping
+{
+public:
+  explicit RingMapping(const std::string& name)
+    : data(NULL), size(0)
+  {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+      return;
+    off_t length = lseek(fd, 0, SEEK_END);
+    void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping != MAP_FAILED) {
+      data = static_cast<uint8_t*>(mapping);
+      size = length;
+    }
+  }
+
+  ~RingMapping()
+  {
+    if (data)
+      munmap(data, size);
+  }
+
+  uint32_t& word(size_t offset)
+  {
+    return *reinterpret_cast<uint32_t*>(data + offset);
+  }
+
+  uint8_t* data;
+  size_t size;
+};
+
+static int elapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+  return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void testPublishAndRead()
+{
+  ShmFramePublisher publisher;
+  EXPECT_TRUE(publisher.open(ringName(), BEAM_COUNT) == ldcp_sdk::error_t::no_error);
+  ShmFrameReader reader;
+  EXPECT_TRUE(reader.open(ringName()) == ldcp_sdk::error_t::no_error);
+
+  ScanFrame scan_frame, read_frame;
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 4000, scan_frame);
+  scan_frame.timestamp = 42;
+  EXPECT_TRUE(publisher.publish(scan_frame) == ldcp_sdk::error_t::no_error);
+  EXPECT_TRUE(reader.readScanFrame(read_frame, TIMEOUT) == ldcp_sdk::error_t::no_error);
+  EXPECT_EQ(42u, read_frame.timestamp);
+  EXPECT_TRUE(read_frame.layers[0].ranges == scan_frame.layers[0].ranges);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(reader.readScanFrame(read_frame, TIMEOUT) == ldcp_sdk::error_t::timed_out);
+  EXPECT_TRUE(elapsedMilliseconds(start) >= TIMEOUT - 1);
+}
+
+// A slot left mid-write by a publisher that died is given up on at the
+// deadline instead of being retried forever.
+static void testOddSequenceTimesOut()
+{
+  ShmFramePublisher publisher;
+  EXPECT_TRUE(publisher.open(ringName(), BEAM_COUNT) == ldcp_sdk::error_t::no_error);
+  ShmFrameReader reader;
+  EXPECT_TRUE(reader.open(ringName()) == ldcp_sdk::error_t::no_error);
+
+  ScanFrame scan_frame;
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 4000, scan_frame);
+  EXPECT_TRUE(publisher.publish(scan_frame) == ldcp_sdk::error_t::no_error);
+  RingMapping ring(ringName());
+  EXPECT_TRUE(ring.data != NULL);
+  if (!ring.data)
+    return;
+  ring.word(SLOT_OFFSET) |= 1;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(reader.readScanFrame(scan_frame, TIMEOUT) == ldcp_sdk::error_t::timed_out);
+  int elapsed = elapsedMilliseconds(start);
+  EXPECT_TRUE(elapsed >= TIMEOUT - 1 && elapsed < 10 * TIMEOUT);
+}
+
+// A slot claiming more beams than the ring holds is reported at once, and a
+// ring with a corrupt header is not opened.
+static void testCorruptHeader()
+{
+  ShmFramePublisher publisher;
+  EXPECT_TRUE(publisher.open(ringName(), BEAM_COUNT) == ldcp_sdk::error_t::no_error);
+  ShmFrameReader reader;
+  EXPECT_TRUE(reader.open(ringName()) == ldcp_sdk::error_t::no_error);
+
+  ScanFrame scan_frame;
+  test::makeFrame(ANGULAR_FOV_360DEG, BEAM_COUNT, 4000, scan_frame);
+  EXPECT_TRUE(publisher.publish(scan_frame) == ldcp_sdk::error_t::no_error);
+  RingMapping ring(ringName());
+  EXPECT_TRUE(ring.data != NULL);
+  if (!ring.data)
+    return;
+  ring.word(SLOT_OFFSET + BEAM_COUNT_OFFSET) = 0xffffff;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(reader.readScanFrame(scan_frame, 10 * TIMEOUT) == ldcp_sdk::error_t::protocol_error);
+  EXPECT_TRUE(elapsedMilliseconds(start) < TIMEOUT);
+
+  ring.word(0) = 0;
+  ShmFrameReader other_reader;
+  EXPECT_TRUE(other_reader.open(ringName()) == ldcp_sdk::error_t::protocol_error);
+}
+
+#endif
+
+int main()
+{
+#ifdef __linux__
+  testPublishAndRead();
+  testOddSequenceTimesOut();
+  testCorruptHeader();
+#endif
+  return ldcp_sdk::test::testResult();
+}
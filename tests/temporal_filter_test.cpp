@@ -0,0 +1,82 @@
+#include "ldcp/temporal_filter.h"
+#include "scene.h"
+#include "test.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+using namespace ldcp_sdk;
+
+// Not a multiple of the 16 lanes the median sorts at a time
+static const int BEAM_COUNT = 37;
+
+static void makeRandomFrame(ScanFrame& scan_frame)
+{
+  test::makeFrame(ANGULAR_FOV_270DEG, BEAM_COUNT, 0, scan_frame);
+  for (int i = 0; i < BEAM_COUNT; i++)
+    scan_frame.layers[0].ranges[i] = (std::rand() % 4 == 0) ? 0 : 1000 + std::rand() % 3000;
+}
+
+// Each beam reads the median of its valid samples over the last depth
+// frames, the upper one for an even count, or 0 with too few of them.
+static void testMedianMatchesReference()
+{
+  std::srand(7);
+  for (int depth = 1; depth <= TemporalFilter::DEPTH_MAX; depth++) {
+    for (int min_valid_count = 1; min_valid_count <= std::min(depth, 3); min_valid_count++) {
+      TemporalFilter filter(depth);
+      filter.setEstimate(TEMPORAL_ESTIMATE_MEDIAN);
+      filter.setMinValidCount(min_valid_count);
+
+      std::deque<std::vector<int>> window;
+      int mismatches = 0;
+      for (int frame = 0; frame < 3 * depth + 2; frame++) {
+        ScanFrame scan_frame;
+        makeRandomFrame(scan_frame);
+        window.push_back(scan_frame.layers[0].ranges);
+        if ((int)window.size() > depth)
+          window.pop_front();
+
+        filter.apply(scan_frame);
+        for (int i = 0; i < BEAM_COUNT; i++) {
+          std::vector<int> samples;
+          for (const std::vector<int>& ranges : window) {
+            if (ranges[i] > 0)
+              samples.push_back(ranges[i]);
+          }
+          std::sort(samples.begin(), samples.end());
+          int expected = ((int)samples.size() >= min_valid_count) ? samples[samples.size() / 2] : 0;
+          mismatches += (scan_frame.layers[0].ranges[i] != expected);
+          mismatches += (scan_frame.layers[0].intensities[i] != (expected > 0 ? 100 : 0));
+        }
+      }
+      EXPECT_EQ(0, mismatches);
+      EXPECT_EQ(depth, filter.frameCount());
+    }
+  }
+}
+
+static void testMeanAndVariance()
+{
+  TemporalFilter filter(4);
+  const int samples[] = { 1000, 0, 1200, 1400, 1600, 0 };
+  for (int sample : samples) {
+    ScanFrame scan_frame;
+    scan_frame.layers.resize(1);
+    scan_frame.layers[0].ranges.assign(1, sample);
+    filter.update(scan_frame);
+  }
+
+  // The last 4 frames hold 1200, 1400, 1600 and a dropout
+  EXPECT_NEAR(1400.0, filter.means()[0], 1e-3);
+  EXPECT_NEAR(80000.0 / 3, filter.variances()[0], 1e-1);
+}
+
+int main()
+{
+  testMedianMatchesReference();
+  testMeanAndVariance();
+  return ldcp_sdk::test::testResult();
+}
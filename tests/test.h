@@ -0,0 +1,42 @@
+#ifndef LDCP_SDK_TESTS_TEST_H_
+#define LDCP_SDK_TESTS_TEST_H_
+
+#include <cmath>
+#include <cstdio>
+
+// Minimal checks for the SDK tests. A failed check prints its location and
+// is counted; main() returns testResult() so ctest sees the failure.
+namespace ldcp_sdk
+{
+namespace test
+{
+
+inline int& failureCount()
+{
+  static int count = 0;
+  return count;
+}
+
+inline int testResult()
+{
+  if (failureCount() > 0)
+    std::fprintf(stderr, "%d check(s) failed\n", failureCount());
+  return (failureCount() == 0) ? 0 : 1;
+}
+
+}
+}
+
+#define EXPECT_TRUE(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+      ldcp_sdk::test::failureCount()++; \
+    } \
+  } while (0)
+
+#define EXPECT_EQ(expected, actual) EXPECT_TRUE((expected) == (actual))
+#define EXPECT_NEAR(expected, actual, tolerance) \
+  EXPECT_TRUE(std::fabs((double)(expected) - (double)(actual)) <= (tolerance))
+
+#endif